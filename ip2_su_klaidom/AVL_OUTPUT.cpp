@@ -0,0 +1,33 @@
+#include "AVL_OUTPUT.h"
+#include <cerrno>
+#include <ostream>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace AVLProject {
+
+    void OStreamSink::write(const char* data, std::size_t size) {
+        os.write(data, static_cast<std::streamsize>(size));
+    }
+
+    void FileDescriptorSink::write(const char* data, std::size_t size) {
+        while (size > 0) {
+#if defined(_WIN32)
+            int written = ::_write(fd, data, static_cast<unsigned int>(size));
+#else
+            ssize_t written = ::write(fd, data, size);
+#endif
+            if (written < 0) {
+                if (errno == EINTR) continue;
+                throw std::system_error(errno, std::generic_category(), "FileDescriptorSink::write");
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+}
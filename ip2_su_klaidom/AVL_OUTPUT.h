@@ -0,0 +1,190 @@
+#ifndef AVL_OUTPUT_H
+#define AVL_OUTPUT_H
+
+#include <charconv>
+#include <cstddef>
+#include <iosfwd>
+#include <string>
+#include <system_error>
+
+namespace AVLProject {
+
+    /**
+     * @brief Controls how values are rendered as text.
+     */
+    struct FormatOptions {
+        std::string separator = " ";  ///< Written between consecutive values.
+        int precision = 6;            ///< Significant digits; negative means shortest round-trip form.
+        std::chars_format format = std::chars_format::general;  ///< Notation, as for printf %g/%f/%e.
+        bool trailingSeparator = true;  ///< Whether the last value is followed by the separator too.
+    };
+
+    /**
+     * @brief Destination for formatted text, written to in large chunks.
+     */
+    class OutputSink {
+    public:
+        virtual ~OutputSink() = default;
+
+        /**
+         * @brief Consumes a chunk of text.
+         * @param data The characters to write.
+         * @param size Number of characters.
+         */
+        virtual void write(const char* data, std::size_t size) = 0;
+    };
+
+    /**
+     * @brief Sink that appends to a string.
+     */
+    class StringSink : public OutputSink {
+    private:
+        std::string& target;  ///< String receiving the text.
+
+    public:
+        /**
+         * @brief Constructs a sink appending to @p target.
+         * @param target The string to append to.
+         */
+        explicit StringSink(std::string& target) : target(target) {}
+
+        void write(const char* data, std::size_t size) override { target.append(data, size); }
+    };
+
+    /**
+     * @brief Sink that forwards chunks to an output stream with unformatted writes.
+     */
+    class OStreamSink : public OutputSink {
+    private:
+        std::ostream& os;  ///< Stream receiving the text.
+
+    public:
+        /**
+         * @brief Constructs a sink writing to @p os.
+         * @param os The output stream.
+         */
+        explicit OStreamSink(std::ostream& os) : os(os) {}
+
+        void write(const char* data, std::size_t size) override;
+    };
+
+    /**
+     * @brief Sink that writes chunks straight to a file descriptor, bypassing stdio.
+     */
+    class FileDescriptorSink : public OutputSink {
+    private:
+        int fd;  ///< Descriptor receiving the text; not closed by the sink.
+
+    public:
+        /**
+         * @brief Constructs a sink writing to @p fd.
+         * @param fd An open, writable file descriptor.
+         */
+        explicit FileDescriptorSink(int fd) : fd(fd) {}
+
+        /**
+         * @brief Writes the whole chunk, retrying on short writes.
+         * @param data The characters to write.
+         * @param size Number of characters.
+         * @throws std::system_error If the descriptor reports an error.
+         */
+        void write(const char* data, std::size_t size) override;
+    };
+
+    /**
+     * @brief Formats doubles with std::to_chars into a fixed buffer and flushes it to a sink.
+     *
+     * No locale is consulted and nothing is allocated per value; the sink sees one write
+     * per filled buffer. Call finish() once all values are appended.
+     */
+    class ValueFormatter {
+    private:
+        static constexpr std::size_t kBufferSize = 16384;  ///< Bytes gathered per sink write.
+        static constexpr std::size_t kMaxValueChars = 32;  ///< Longest %g/%e rendering of a double.
+
+        OutputSink& sink;              ///< Destination of the text.
+        const FormatOptions& options;  ///< Formatting settings.
+        std::size_t used = 0;          ///< Bytes of the buffer in use.
+        bool pendingSeparator = false; ///< A separator is owed before the next value.
+        char buffer[kBufferSize];      ///< Text waiting to be flushed.
+
+        void reserve(std::size_t bytes) {
+            if (used + bytes > kBufferSize) flush();
+        }
+
+        void appendText(const char* data, std::size_t size) {
+            if (size > kBufferSize) {
+                flush();
+                sink.write(data, size);
+                return;
+            }
+            reserve(size);
+            for (std::size_t i = 0; i < size; ++i) buffer[used++] = data[i];
+        }
+
+        void appendSeparator() {
+            appendText(options.separator.data(), options.separator.size());
+        }
+
+        std::to_chars_result render(char* first, char* last, double val) const {
+            if (options.precision >= 0)
+                return std::to_chars(first, last, val, options.format, options.precision);
+            // Shortest round-trip form; in general notation, whichever of fixed and scientific is shorter
+            if (options.format == std::chars_format::general)
+                return std::to_chars(first, last, val);
+            return std::to_chars(first, last, val, options.format);
+        }
+
+    public:
+        /**
+         * @brief Constructs a formatter writing to @p sink.
+         * @param sink The destination.
+         * @param options Formatting settings; must outlive the formatter.
+         */
+        ValueFormatter(OutputSink& sink, const FormatOptions& options) : sink(sink), options(options) {}
+
+        ValueFormatter(const ValueFormatter&) = delete;
+        ValueFormatter& operator=(const ValueFormatter&) = delete;
+
+        /**
+         * @brief Formats one value; separators are placed between consecutive values.
+         * @param val The value to format.
+         */
+        void append(double val) {
+            if (pendingSeparator) appendSeparator();
+            pendingSeparator = true;
+
+            reserve(kMaxValueChars);
+            std::to_chars_result result = render(buffer + used, buffer + kBufferSize, val);
+            if (result.ec == std::errc()) {
+                used = static_cast<std::size_t>(result.ptr - buffer);
+                return;
+            }
+
+            // Only fixed notation of huge values or very high precisions get here
+            std::string wide(512, '\0');
+            while ((result = render(&wide[0], &wide[0] + wide.size(), val)).ec != std::errc())
+                wide.resize(wide.size() * 2);
+            appendText(wide.data(), static_cast<std::size_t>(result.ptr - wide.data()));
+        }
+
+        /**
+         * @brief Writes the trailing separator, if enabled, and flushes everything to the sink.
+         */
+        void finish() {
+            if (pendingSeparator && options.trailingSeparator) appendSeparator();
+            pendingSeparator = false;
+            flush();
+        }
+
+        /**
+         * @brief Hands the buffered text to the sink.
+         */
+        void flush() {
+            if (used > 0) sink.write(buffer, used);
+            used = 0;
+        }
+    };
+
+}
+#endif // AVL_OUTPUT_H
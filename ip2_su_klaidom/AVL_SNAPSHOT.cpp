@@ -0,0 +1,223 @@
+#include "AVL_SNAPSHOT.h"
+#include "AVL_TREE.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <system_error>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define AVL_SNAPSHOT_MMAP 1
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace AVLProject {
+
+    namespace {
+
+        constexpr std::size_t kWriteChunk = 8192;  ///< Values buffered per write while saving.
+
+        void validateHeader(const std::string& path, const SnapshotHeader& header, std::size_t fileBytes) {
+            if (std::memcmp(header.magic, SnapshotHeader::kMagic, sizeof(header.magic)) != 0)
+                throw SnapshotException(path, "not a snapshot file");
+            if (header.version != SnapshotHeader::kVersion)
+                throw SnapshotException(path, "unsupported format version " + std::to_string(header.version));
+            if (header.byteOrder != SnapshotHeader::kByteOrderMark)
+                throw SnapshotException(path, "written on a machine with a different byte order");
+            if (header.flags != 0)
+                throw SnapshotException(path, "unknown format flags");
+            // Divides instead of multiplying, so that a corrupt count cannot wrap around into a match
+            if (header.payloadBytes != fileBytes - sizeof(SnapshotHeader) ||
+                header.payloadBytes % sizeof(double) != 0 ||
+                header.count != header.payloadBytes / sizeof(double))
+                throw SnapshotException(path, "truncated or oversized payload");
+        }
+
+        void validatePayload(const std::string& path, const SnapshotHeader& header, const double* values) {
+            if (snapshotChecksum(values, header.count) != header.checksum)
+                throw SnapshotException(path, "checksum mismatch");
+            for (std::size_t i = 1; i < header.count; ++i) {
+                if (!(values[i - 1] < values[i]))
+                    throw SnapshotException(path, "values are not strictly increasing");
+            }
+        }
+
+    }
+
+    std::uint64_t snapshotChecksum(const double* values, std::size_t count, std::uint64_t seed) {
+        std::uint64_t hash = seed;
+        for (std::size_t i = 0; i < count; ++i) {
+            std::uint64_t word;
+            std::memcpy(&word, values + i, sizeof(word));
+            hash = (hash ^ word) * 0x100000001b3ULL;
+        }
+        return hash;
+    }
+
+    MappedSnapshot::MappedSnapshot(const std::string& path) : path(path) {
+        SnapshotHeader header;
+#ifdef AVL_SNAPSHOT_MMAP
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw SnapshotException(path, std::strerror(errno));
+        struct stat info;
+        if (::fstat(fd, &info) != 0) {
+            int error = errno;
+            ::close(fd);
+            throw SnapshotException(path, std::strerror(error));
+        }
+        std::size_t fileBytes = static_cast<std::size_t>(info.st_size);
+        if (fileBytes < sizeof(SnapshotHeader)) {
+            ::close(fd);
+            throw SnapshotException(path, "file is too small");
+        }
+
+        void* address = ::mmap(nullptr, fileBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);  // The mapping keeps the file referenced
+        if (address == MAP_FAILED)
+            throw SnapshotException(path, std::strerror(errno));
+        mapping = address;
+        mappingBytes = fileBytes;
+
+        try {
+            std::memcpy(&header, mapping, sizeof(header));
+            validateHeader(path, header, fileBytes);
+            values = reinterpret_cast<const double*>(static_cast<const char*>(mapping) + sizeof(SnapshotHeader));
+            count = static_cast<std::size_t>(header.count);
+            validatePayload(path, header, values);
+        } catch (...) {
+            release();
+            throw;
+        }
+#else
+        std::ifstream in(path, std::ios::binary | std::ios::ate);
+        if (!in)
+            throw SnapshotException(path, "cannot open file");
+        std::size_t fileBytes = static_cast<std::size_t>(in.tellg());
+        if (fileBytes < sizeof(SnapshotHeader))
+            throw SnapshotException(path, "file is too small");
+        in.seekg(0);
+        in.read(reinterpret_cast<char*>(&header), sizeof(header));
+        validateHeader(path, header, fileBytes);
+        fallback.resize(static_cast<std::size_t>(header.count));
+        in.read(reinterpret_cast<char*>(fallback.data()), static_cast<std::streamsize>(header.payloadBytes));
+        if (!in)
+            throw SnapshotException(path, "read failed");
+        values = fallback.data();
+        count = fallback.size();
+        validatePayload(path, header, values);
+#endif
+    }
+
+    MappedSnapshot::~MappedSnapshot() {
+        release();
+    }
+
+    MappedSnapshot::MappedSnapshot(MappedSnapshot&& other) noexcept
+        : path(std::move(other.path)), values(other.values), count(other.count),
+          mapping(other.mapping), mappingBytes(other.mappingBytes), fallback(std::move(other.fallback)) {
+        other.values = nullptr;
+        other.count = 0;
+        other.mapping = nullptr;
+        other.mappingBytes = 0;
+    }
+
+    MappedSnapshot& MappedSnapshot::operator=(MappedSnapshot&& other) noexcept {
+        if (this != &other) {
+            release();
+            path = std::move(other.path);
+            values = other.values;
+            count = other.count;
+            mapping = other.mapping;
+            mappingBytes = other.mappingBytes;
+            fallback = std::move(other.fallback);
+            other.values = nullptr;
+            other.count = 0;
+            other.mapping = nullptr;
+            other.mappingBytes = 0;
+        }
+        return *this;
+    }
+
+    void MappedSnapshot::release() noexcept {
+#ifdef AVL_SNAPSHOT_MMAP
+        if (mapping)
+            ::munmap(mapping, mappingBytes);
+#endif
+        mapping = nullptr;
+        mappingBytes = 0;
+        values = nullptr;
+        count = 0;
+        fallback.clear();
+    }
+
+    bool MappedSnapshot::search(double val) const {
+        return std::binary_search(begin(), end(), val);
+    }
+
+    std::size_t MappedSnapshot::rank(double val) const {
+        return static_cast<std::size_t>(std::lower_bound(begin(), end(), val) - begin());
+    }
+
+    std::size_t MappedSnapshot::range_count(double lo, double hi) const {
+        if (!(lo <= hi)) return 0;
+        return static_cast<std::size_t>(std::upper_bound(begin(), end(), hi) - std::lower_bound(begin(), end(), lo));
+    }
+
+    void AVLTree::save(const std::string& path) const {
+        // Write next to the target and rename, so a crash never leaves a half-written snapshot behind
+        std::string temporary = path + ".tmp";
+        if (duplicatePolicy == DuplicatePolicy::Count && std::adjacent_find(begin(), end()) != end())
+            throw SnapshotException(path, "snapshots hold every value once, but this tree repeats values");
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (!file)
+            throw SnapshotException(path, std::strerror(errno));
+
+        SnapshotHeader header = {};
+        std::memcpy(header.magic, SnapshotHeader::kMagic, sizeof(header.magic));
+        header.version = SnapshotHeader::kVersion;
+        header.count = size();
+        header.payloadBytes = header.count * sizeof(double);
+        header.checksum = snapshotChecksum(nullptr, 0);
+        header.byteOrder = SnapshotHeader::kByteOrderMark;
+
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        std::vector<double> chunk;
+        chunk.reserve(kWriteChunk);
+        for (auto it = begin(); ok && it != end();) {
+            chunk.clear();
+            for (; it != end() && chunk.size() < kWriteChunk; ++it)
+                chunk.push_back(*it);
+            header.checksum = snapshotChecksum(chunk.data(), chunk.size(), header.checksum);
+            ok = std::fwrite(chunk.data(), sizeof(double), chunk.size(), file) == chunk.size();
+        }
+
+        ok = ok && std::fseek(file, 0, SEEK_SET) == 0 && std::fwrite(&header, sizeof(header), 1, file) == 1;
+        ok = ok && std::fflush(file) == 0;
+#ifdef AVL_SNAPSHOT_MMAP
+        ok = ok && ::fsync(::fileno(file)) == 0;
+#endif
+        ok = (std::fclose(file) == 0) && ok;
+
+        std::error_code error;
+        if (ok)
+            std::filesystem::rename(temporary, path, error);
+        if (!ok || error) {
+            std::filesystem::remove(temporary, error);
+            throw SnapshotException(path, "write failed");
+        }
+    }
+
+    AVLTree AVLTree::load(const std::string& path) {
+        MappedSnapshot snapshot(path);
+        AVLTree tree;
+        tree.assignSorted(snapshot.data(), snapshot.size());
+        return tree;
+    }
+
+}
@@ -0,0 +1,154 @@
+#ifndef AVL_SNAPSHOT_H
+#define AVL_SNAPSHOT_H
+
+#include <cstddef>
+#include <cstdint>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace AVLProject {
+
+    /**
+     * @brief On-disk header of a binary AVL tree snapshot.
+     *
+     * A snapshot file is this 64-byte header followed by @c count strictly increasing
+     * doubles in native byte order. Because the payload starts on a 64-byte boundary,
+     * a memory-mapped file can be searched in place.
+     */
+    struct SnapshotHeader {
+        static constexpr char kMagic[8] = {'A', 'V', 'L', 'S', 'N', 'A', 'P', '\0'};
+        static constexpr std::uint32_t kVersion = 1;
+        static constexpr std::uint64_t kByteOrderMark = 0x0102030405060708ULL;
+
+        char magic[8];              ///< Always kMagic.
+        std::uint32_t version;      ///< Format version, currently kVersion.
+        std::uint32_t flags;        ///< Reserved for optional sections, must be 0 in version 1.
+        std::uint64_t count;        ///< Number of values in the payload.
+        std::uint64_t payloadBytes; ///< Size of the payload, count * sizeof(double).
+        std::uint64_t checksum;     ///< snapshotChecksum() of the payload.
+        std::uint64_t byteOrder;    ///< kByteOrderMark as written by the saving machine.
+        std::uint8_t reserved[16];  ///< Zero padding up to 64 bytes.
+    };
+    static_assert(sizeof(SnapshotHeader) == 64, "snapshot header must stay 64 bytes");
+
+    /**
+     * @brief Exception thrown when a snapshot cannot be written, read or validated.
+     */
+    class SnapshotException : public std::runtime_error {
+    public:
+        /**
+         * @brief Constructs a SnapshotException for a file.
+         * @param path The snapshot file.
+         * @param reason What went wrong.
+         */
+        SnapshotException(const std::string& path, const std::string& reason)
+            : std::runtime_error("Snapshot " + path + ": " + reason) {}
+    };
+
+    /**
+     * @brief Computes the payload checksum stored in a snapshot header.
+     * @param values The sorted values.
+     * @param count Number of values.
+     * @param seed Checksum of the preceding values, for computing it in chunks.
+     * @return 64-bit FNV-1a checksum over the 64-bit words of the payload.
+     */
+    std::uint64_t snapshotChecksum(const double* values, std::size_t count,
+                                   std::uint64_t seed = 0xcbf29ce484222325ULL);
+
+    /**
+     * @brief Read-only view of a snapshot file mapped into memory.
+     *
+     * The file is validated once when it is opened. Afterwards, queries run by binary
+     * search directly on the mapped pages, with no per-value allocation. The view can be
+     * shared between threads because it is never modified.
+     */
+    class MappedSnapshot {
+    private:
+        std::string path;                ///< File the view was opened from.
+        const double* values = nullptr;  ///< First value of the payload.
+        std::size_t count = 0;           ///< Number of values.
+        void* mapping = nullptr;         ///< Start of the mapped region.
+        std::size_t mappingBytes = 0;    ///< Length of the mapped region.
+        std::vector<double> fallback;    ///< Payload copy on platforms without mmap.
+
+        void release() noexcept;
+
+    public:
+        /**
+         * @brief Maps and validates a snapshot file.
+         * @param path The snapshot file.
+         * @throws SnapshotException If the file cannot be mapped or is not a valid snapshot.
+         */
+        explicit MappedSnapshot(const std::string& path);
+
+        /**
+         * @brief Unmaps the file.
+         */
+        ~MappedSnapshot();
+
+        MappedSnapshot(const MappedSnapshot&) = delete;
+        MappedSnapshot& operator=(const MappedSnapshot&) = delete;
+
+        /**
+         * @brief Takes over the mapping of another view.
+         * @param other The view to move from; it is left empty.
+         */
+        MappedSnapshot(MappedSnapshot&& other) noexcept;
+
+        /**
+         * @brief Takes over the mapping of another view.
+         * @param other The view to move from; it is left empty.
+         * @return Reference to this view.
+         */
+        MappedSnapshot& operator=(MappedSnapshot&& other) noexcept;
+
+        /**
+         * @brief Returns the number of values in the snapshot.
+         * @return The number of values.
+         */
+        std::size_t size() const { return count; }
+
+        /**
+         * @brief Returns the sorted values.
+         * @return Pointer to the first value.
+         */
+        const double* data() const { return values; }
+
+        /**
+         * @brief Returns a pointer to the smallest value.
+         * @return Pointer to the first value.
+         */
+        const double* begin() const { return values; }
+
+        /**
+         * @brief Returns a pointer past the largest value.
+         * @return Pointer past the last value.
+         */
+        const double* end() const { return values + count; }
+
+        /**
+         * @brief Searches for a value in O(log n).
+         * @param val The value to search for.
+         * @return True if the value is stored, false otherwise.
+         */
+        bool search(double val) const;
+
+        /**
+         * @brief Counts the values that are smaller than a given value in O(log n).
+         * @param val The value to rank.
+         * @return The number of stored values less than @p val.
+         */
+        std::size_t rank(double val) const;
+
+        /**
+         * @brief Counts the values in the closed range [lo, hi] in O(log n).
+         * @param lo Lower bound of the range.
+         * @param hi Upper bound of the range.
+         * @return The number of stored values v with lo <= v <= hi.
+         */
+        std::size_t range_count(double lo, double hi) const;
+    };
+
+}
+#endif // AVL_SNAPSHOT_H
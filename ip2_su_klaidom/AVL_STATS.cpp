@@ -0,0 +1,92 @@
+#include "AVL_STATS.h"
+#include <algorithm>
+#include <mutex>
+
+namespace AVLProject {
+
+    namespace {
+
+        constexpr int kCounters = static_cast<int>(Counter::Count);
+
+        struct ThreadSlots;
+
+        /**
+         * The slots of live threads, plus the totals of threads that have exited.
+         */
+        struct Registry {
+            std::mutex mutex;
+            std::vector<ThreadSlots*> live;
+            std::uint64_t exited[kCounters] = {};
+            std::uint64_t baseline[kCounters] = {};  ///< Sums at the last reset.
+
+            static Registry& instance() {
+                // Never destroyed, so threads that exit during static destruction still find it
+                static Registry* registry = new Registry;
+                return *registry;
+            }
+        };
+
+        struct ThreadSlots {
+            std::atomic<std::uint64_t> values[kCounters] = {};
+
+            ThreadSlots() {
+                Registry& registry = Registry::instance();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                registry.live.push_back(this);
+            }
+
+            ~ThreadSlots() {
+                Registry& registry = Registry::instance();
+                std::lock_guard<std::mutex> lock(registry.mutex);
+                for (int i = 0; i < kCounters; ++i)
+                    registry.exited[i] += values[i].load(std::memory_order_relaxed);
+                registry.live.erase(std::find(registry.live.begin(), registry.live.end(), this));
+            }
+        };
+
+        void sumCounters(Registry& registry, std::uint64_t* sums) {
+            for (int i = 0; i < kCounters; ++i) {
+                sums[i] = registry.exited[i];
+                for (const ThreadSlots* slots : registry.live)
+                    sums[i] += slots->values[i].load(std::memory_order_relaxed);
+            }
+        }
+
+    }
+
+    std::atomic<std::uint64_t>* threadCounters() {
+        static thread_local ThreadSlots slots;
+        return slots.values;
+    }
+
+    OperationCounters totalCounters() {
+        std::uint64_t sums[kCounters];
+        Registry& registry = Registry::instance();
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            sumCounters(registry, sums);
+            for (int i = 0; i < kCounters; ++i) sums[i] -= registry.baseline[i];
+        }
+
+        OperationCounters totals;
+        totals.comparisons = sums[static_cast<int>(Counter::Comparisons)];
+        totals.leftRotations = sums[static_cast<int>(Counter::LeftRotations)];
+        totals.rightRotations = sums[static_cast<int>(Counter::RightRotations)];
+        totals.doubleRotations = sums[static_cast<int>(Counter::DoubleRotations)];
+        totals.allocations = sums[static_cast<int>(Counter::Allocations)];
+        totals.frees = sums[static_cast<int>(Counter::Frees)];
+        totals.inserts = sums[static_cast<int>(Counter::Inserts)];
+        totals.insertRetraceSteps = sums[static_cast<int>(Counter::InsertRetraceSteps)];
+        totals.erases = sums[static_cast<int>(Counter::Erases)];
+        totals.eraseRetraceSteps = sums[static_cast<int>(Counter::EraseRetraceSteps)];
+        return totals;
+    }
+
+    void resetCounters() {
+        // Threads keep counting into their own slots, so a reset only moves the baseline
+        Registry& registry = Registry::instance();
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        sumCounters(registry, registry.baseline);
+    }
+
+}
@@ -0,0 +1,95 @@
+#ifndef AVL_STATS_H
+#define AVL_STATS_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace AVLProject {
+
+    /**
+     * @brief Shape and memory of one tree, as returned by AVLTree::stats().
+     */
+    struct TreeStats {
+        std::size_t nodeCount = 0;                ///< Number of stored values.
+        int height = 0;                           ///< Height of the tree; 0 when empty.
+        std::size_t memoryBytes = 0;              ///< Bytes held for the nodes, free pool slots included.
+        std::vector<std::size_t> depthHistogram;  ///< depthHistogram[d] nodes sit at depth d; the root at 0.
+        std::size_t filterBytes = 0;              ///< Bytes held by the lookup filter; 0 when it is off.
+        double filterFalsePositiveRate = 0;       ///< Chance that an absent value gets past the lookup filter.
+        double filterObservedFalsePositiveRate = 0;  ///< Share of the searched absent values that got past it.
+    };
+
+    /**
+     * @brief Work done by all AVLTree instances of the process since the last reset.
+     *
+     * Only counted when the library is built with AVL_ENABLE_STATS (`make STATS=1`).
+     * Otherwise the counting compiles away and every field stays zero.
+     */
+    struct OperationCounters {
+        std::uint64_t comparisons = 0;         ///< Nodes compared against while descending for a value.
+        std::uint64_t leftRotations = 0;       ///< Single left rotations.
+        std::uint64_t rightRotations = 0;      ///< Single right rotations.
+        std::uint64_t doubleRotations = 0;     ///< Left-right and right-left rotations.
+        std::uint64_t allocations = 0;         ///< Nodes created.
+        std::uint64_t frees = 0;               ///< Nodes freed.
+        std::uint64_t inserts = 0;             ///< Values inserted.
+        std::uint64_t insertRetraceSteps = 0;  ///< Ancestors revisited after inserts.
+        std::uint64_t erases = 0;              ///< Values removed.
+        std::uint64_t eraseRetraceSteps = 0;   ///< Ancestors revisited after removals.
+    };
+
+    /**
+     * @brief The events AVLTree counts; one slot per field of OperationCounters.
+     */
+    enum class Counter {
+        Comparisons,
+        LeftRotations,
+        RightRotations,
+        DoubleRotations,
+        Allocations,
+        Frees,
+        Inserts,
+        InsertRetraceSteps,
+        Erases,
+        EraseRetraceSteps,
+        Count
+    };
+
+    /**
+     * @brief Returns the calling thread's counter slots, registering them on first use.
+     *
+     * Each thread writes only its own slots, so counting needs no atomic
+     * read-modify-write. Readers sum the slots of all threads.
+     */
+    std::atomic<std::uint64_t>* threadCounters();
+
+    /**
+     * @brief Sums the counters of every thread, including threads that have exited.
+     * @return The totals since the last resetCounters(), or since the process started.
+     */
+    OperationCounters totalCounters();
+
+    /**
+     * @brief Starts the totals reported by totalCounters() from zero again.
+     */
+    void resetCounters();
+
+    /**
+     * @brief Adds to one of the calling thread's counters; a no-op unless AVL_ENABLE_STATS is set.
+     * @param counter The event to count.
+     * @param amount How many events happened.
+     */
+    inline void countEvent(Counter counter, std::uint64_t amount = 1) {
+#ifdef AVL_ENABLE_STATS
+        std::atomic<std::uint64_t>& slot = threadCounters()[static_cast<int>(counter)];
+        slot.store(slot.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+#else
+        (void)counter;
+        (void)amount;
+#endif
+    }
+
+}
+#endif // AVL_STATS_H
@@ -1,7 +1,23 @@
-#include "AVL_TREE.h"
+#include "AVL_TREE_IMPL.h"
+#include "BASIC_AVL_TREE.h"
+#include "COMPACT_AVL_TREE.h"
+#include "BPLUS_TREE.h"
+#include "LOOKUP_FILTER.h"
+#ifndef AVL_USE_GLOBAL_HEAP
+#include "NODE_POOL.h"
+#endif
 #include <iostream>
 #include <algorithm>
-#include <sstream>
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <limits>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <system_error>
+#include <thread>
 
 namespace AVLProject {
 
@@ -13,7 +29,10 @@ namespace AVLProject {
         AVLNode* left;        ///< Pointer to the left child.
         AVLNode* right;       ///< Pointer to the right child.
         AVLNode* parent;      ///< Pointer to the parent node.
+        std::size_t size;     ///< Number of values in the subtree rooted at this node.
+        double sum;           ///< Sum of the values in the subtree rooted at this node.
         int height;           ///< Height of the node in the tree.
+        std::uint32_t count;  ///< Copies of the value; above 1 only in trees that count duplicates.
 
         /**
          * @brief Constructs an AVLNode with a given value and optional parent.
@@ -21,100 +40,778 @@ namespace AVLProject {
          * @param parent Pointer to the parent node (default is nullptr).
          */
         AVLNode(double val, AVLNode* parent = nullptr)
-            : value(val), left(nullptr), right(nullptr), parent(parent), height(1) {}
+            : value(val), left(nullptr), right(nullptr), parent(parent), size(1), sum(val), height(1), count(1) {}
     };
 
-    class AVLTreeImpl {
+    /**
+     * @brief The AVLCore hooks that keep AVLNode's subtree count and sum and feed the operation counters.
+     */
+    struct LinkedNodeHooks {
+        static constexpr bool kAugmented = true;
+
+        static std::size_t size(const AVLNode* node) { return node ? node->size : 0; }
+        static double sum(const AVLNode* node) { return node ? node->sum : 0; }
+
+        static void update(AVLNode* node) {
+            node->size = node->count + size(node->left) + size(node->right);
+            node->sum = sum(node->left) + node->value * node->count + sum(node->right);
+        }
+
+        static void added(AVLNode* ancestor, const AVLNode* added) {
+            ++ancestor->size;
+            ancestor->sum += added->value;
+        }
+
+        static void count(Counter counter, std::uint64_t amount = 1) { countEvent(counter, amount); }
+    };
+
+    /**
+     * @brief The StorageEngine::Linked implementation: pool-allocated, parent-linked nodes.
+     *
+     * The balancing, searching and iteration are AVLCore's, shared with BasicAVLTree;
+     * this class adds the subtree aggregates, counted copies, the finger, the content
+     * hash, the node pool and the join-based bulk operations.
+     */
+    class LinkedAVLTreeImpl final : public AVLTreeImpl, public AVLCore<AVLNode, std::less<double>, LinkedNodeHooks> {
     public:
-        AVLNode* root;
+        using Core = AVLCore<AVLNode, std::less<double>, LinkedNodeHooks>;
+        using AVLTreeImpl::kMaxHeight;
+
+        static constexpr std::size_t kParallelGrain = 8192;  ///< Smallest merge worth a thread of its own.
+
+        /// A set operation on a subtree of this tree and a subtree of another, see uniteNodes().
+        using Merge = AVLNode* (LinkedAVLTreeImpl::*)(AVLNode* node, const AVLNode* other, int forks);
+
+        AVLNode* finger = nullptr;  ///< Node of the last hinted insert; nullptr once it may be gone.
+        bool fingerIsMax = false;   ///< No stored value is larger than the finger's.
+        bool fingerIsMin = false;   ///< No stored value is smaller than the finger's.
+        std::uint64_t hash = 0;     ///< Content hash of the nodes this tree created and has not freed.
+#ifndef AVL_USE_GLOBAL_HEAP
+        NodePool<AVLNode> pool;  ///< Per-tree slab storage for the nodes.
+#endif
 
-        AVLTreeImpl() : root(nullptr) {}
-        ~AVLTreeImpl() { freeMemory(root); }
+        LinkedAVLTreeImpl() : AVLTreeImpl(StorageEngine::Linked) {}
+        ~LinkedAVLTreeImpl() override { clear(); }
 
-        AVLNode* insertNode(AVLNode* node, const double& val, AVLNode* parent);
-        AVLNode* deleteNode(AVLNode* node, const double& val);
-        AVLNode* minValueNode(AVLNode* node);
+        std::shared_ptr<AVLTreeImpl> clone() const override;
+        void clear() override;
+        void insertValue(double val) override;
+        TreePosition insertNear(TreePosition hint, double val) override;
+        TreePosition insertCopy(double val) override;
+        bool eraseValue(double val) override;
+        void eraseRoot() override;
+        void assignSorted(const double* values, std::size_t count) override;
+        bool contains(double val) const override;
+        void containsMany(const double* keys, std::size_t count, bool* results) const override;
+        std::size_t count() const override { return getSize(root); }
+        double total() const override { return getSum(root); }
+        std::size_t rankOf(double val) const override;
+        const double* selectValue(std::size_t k) const override;
+        std::size_t rangeCount(double lo, double hi) const override;
+        double rangeSum(double lo, double hi) const override;
+        void rangeAggregate(double lo, double hi, std::size_t& count, double& sum) const;
+        TreePosition first() const override;
+        TreePosition last() const override;
+        TreePosition find(double val) const override;
+        TreePosition lowerBound(double val) const override;
+        TreePosition upperBound(double val) const override;
+        TreePosition lastNotAbove(double val) const override;
+        void next(TreePosition& position) const override;
+        void prev(TreePosition& position) const override;
+        const double& valueAt(const TreePosition& position) const override;
+        void writeValues(OutputSink& sink, const FormatOptions& options) const override;
+        std::uint64_t contentHash() const override { return hash; }
+        TreeStats stats() const override;
+        std::size_t memoryBytes() const override;
+
+        AVLNode* insertLeaf(double val, bool countCopies);
+        void changeCopies(AVLNode* node, int delta);
+        void applyCounts(AVLNode* node, const std::uint32_t*& counts);
+        std::uint64_t hashNodes(const AVLNode* node) const;
+        AVLNode* createNode(double val, AVLNode* parent);
+        void destroyNode(AVLNode* node);
+        void eraseNode(AVLNode* node);
         void freeMemory(AVLNode* node);
-        void inOrderTraversal(AVLNode* node, std::ostream& os) const;
-        bool searchNode(AVLNode* node, const double& val) const;
-        int getHeight(const AVLNode* node) const;
-        int getBalanceFactor(const AVLNode* node) const;
-        AVLNode* rotateRight(AVLNode* y);
-        AVLNode* rotateLeft(AVLNode* x);
-        AVLNode* copyTree(const AVLNode* node) const;
-        int countNodes(AVLNode* node) const;
-        double sumValues(AVLNode* node) const;
-        bool compareTrees(const AVLNode* a, const AVLNode* b) const;
+        static std::size_t getSize(const AVLNode* node) { return LinkedNodeHooks::size(node); }
+        static double getSum(const AVLNode* node) { return LinkedNodeHooks::sum(node); }
+        AVLNode* copyTree(const AVLNode* node);
+        AVLNode* buildBalanced(const double* values, std::size_t count);
+        const AVLNode* selectNode(std::size_t k) const;
+        void adoptStorage(LinkedAVLTreeImpl& other);
+        AVLNode* retraceDetached(AVLNode* node, AVLNode* top);
+        AVLNode* joinNodes(AVLNode* left, AVLNode* mid, AVLNode* right);
+        AVLNode* joinTwo(AVLNode* left, AVLNode* right);
+        void splitNodes(AVLNode* node, double key, AVLNode*& left, AVLNode*& found, AVLNode*& right);
+        AVLNode* uniteNodes(AVLNode* node, const AVLNode* other, int forks);
+        AVLNode* intersectNodes(AVLNode* node, const AVLNode* other, int forks);
+        AVLNode* subtractNodes(AVLNode* node, const AVLNode* other, int forks);
+        void mergeChildren(Merge merge, AVLNode* left, AVLNode* right, const AVLNode* other, int forks,
+                           AVLNode*& mergedLeft, AVLNode*& mergedRight);
     };
 
-    AVLTree::AVLTree() : pImpl(std::make_unique<AVLTreeImpl>()) {}
+    namespace {
+
+        /**
+         * Turns a thread budget into the number of times a set operation may fork.
+         */
+        int forkDepth(unsigned threads) {
+            if (threads == 0)
+                threads = std::max(1u, std::thread::hardware_concurrency());
+            int depth = 0;
+            while ((2u << depth) <= threads && depth < 16) ++depth;
+            return depth;
+        }
+
+        /**
+         * Frees the nodes of released trees on a thread of its own, so that dropping a
+         * huge tree does not stall the thread that drops it.
+         */
+        class TreeReclaimer {
+        private:
+            struct Entry {
+                std::shared_ptr<AVLTreeImpl> tree;
+                std::size_t bytes;
+            };
+
+            std::mutex mutex;
+            std::condition_variable work;     ///< Wakes the worker when a tree is queued.
+            std::condition_variable drained;  ///< Wakes wait() when the last tree is freed.
+            std::deque<Entry> queue;
+            std::size_t pendingBytes = 0;  ///< Node memory queued or being freed.
+            std::size_t pendingTrees = 0;  ///< Trees queued or being freed.
+            std::size_t limit = std::numeric_limits<std::size_t>::max();
+            bool started = false;
+
+            void run() {
+                std::unique_lock<std::mutex> lock(mutex);
+                while (true) {
+                    work.wait(lock, [this] { return !queue.empty(); });
+                    Entry entry = std::move(queue.front());
+                    queue.pop_front();
+                    lock.unlock();
+                    entry.tree.reset();
+                    lock.lock();
+                    pendingBytes -= entry.bytes;
+                    if (--pendingTrees == 0)
+                        drained.notify_all();
+                }
+            }
+
+        public:
+            static TreeReclaimer& instance() {
+                // Never destroyed, so trees released during static destruction still find it
+                static TreeReclaimer* reclaimer = new TreeReclaimer;
+                return *reclaimer;
+            }
+
+            void release(std::shared_ptr<AVLTreeImpl> tree) {
+                std::size_t bytes = tree->memoryBytes();
+                std::unique_lock<std::mutex> lock(mutex);
+                if (bytes > limit - pendingBytes) {
+                    lock.unlock();
+                    tree.reset();  // Over the bound, so the caller pays
+                    return;
+                }
+                if (!started) {
+                    try {
+                        std::thread(&TreeReclaimer::run, this).detach();
+                    } catch (const std::system_error&) {
+                        lock.unlock();
+                        tree.reset();
+                        return;
+                    }
+                    started = true;
+                }
+                queue.push_back({std::move(tree), bytes});
+                pendingBytes += bytes;
+                ++pendingTrees;
+                work.notify_one();
+            }
+
+            void wait() {
+                std::unique_lock<std::mutex> lock(mutex);
+                drained.wait(lock, [this] { return pendingTrees == 0; });
+            }
+
+            std::size_t pending() {
+                std::lock_guard<std::mutex> lock(mutex);
+                return pendingBytes;
+            }
+
+            void setLimit(std::size_t bytes) {
+                std::lock_guard<std::mutex> lock(mutex);
+                limit = bytes;
+            }
+        };
+
+        /**
+         * Drops a reference to a tree's nodes. The last reference to a non-empty tree
+         * goes to the background reclaimer if @p background is set.
+         */
+        void releaseNodes(std::shared_ptr<AVLTreeImpl>&& tree, bool background) {
+            if (background && tree && tree.use_count() == 1 && tree->count() != 0)
+                TreeReclaimer::instance().release(std::move(tree));
+            else
+                tree.reset();
+        }
+
+        /**
+         * The implementation behind a tree that uses StorageEngine::Linked.
+         */
+        LinkedAVLTreeImpl& linked(const std::shared_ptr<AVLTreeImpl>& impl) {
+            return static_cast<LinkedAVLTreeImpl&>(*impl);
+        }
+
+        /**
+         * Looks a value up. LinkedAVLTreeImpl is final, so its lookup is called, and
+         * inlined, directly; only the other engines go through the virtual call.
+         */
+        bool containsValue(const std::shared_ptr<AVLTreeImpl>& impl, double val) {
+            if (impl->engine() == StorageEngine::Linked) return linked(impl).contains(val);
+            return impl->contains(val);
+        }
+
+        bool bothLinked(const AVLTreeImpl& a, const AVLTreeImpl& b) {
+            return a.engine() == StorageEngine::Linked && b.engine() == StorageEngine::Linked;
+        }
+
+        /**
+         * Copies the values of any engine into a sorted vector.
+         */
+        std::vector<double> sortedValues(const AVLTreeImpl& impl) {
+            std::vector<double> values;
+            values.reserve(impl.count());
+            for (TreePosition at = impl.first(); at.node; impl.next(at))
+                values.push_back(impl.valueAt(at));
+            return values;
+        }
+
+        /**
+         * Replaces the contents of @p tree with the result of a join-based set operation.
+         */
+        void applySetOperation(LinkedAVLTreeImpl& tree, LinkedAVLTreeImpl::Merge merge, const LinkedAVLTreeImpl& other, unsigned threads) {
+            tree.finger = nullptr;  // Values may be added beyond it
+            try {
+                tree.root = (tree.*merge)(tree.root, other.root, forkDepth(threads));
+            } catch (...) {
+                // The nodes are spread over detached subtrees by now, so the pool is dropped as a whole
+                tree.root = nullptr;
+                tree.clear();
+                throw;
+            }
+        }
+
+    }
+
+    AVLTree::AVLTree() : AVLTree(StorageEngine::Linked) {}
+    AVLTree::AVLTree(StorageEngine engine, DuplicatePolicy duplicates)
+        : pImpl(AVLTreeImpl::create(engine)), duplicatePolicy(duplicates) {
+        if (duplicates == DuplicatePolicy::Count && engine != StorageEngine::Linked)
+            throw std::invalid_argument("AVLTree: only the Linked engine can count duplicate values");
+    }
     AVLTree::~AVLTree() {
-        // No need to manually free memory; unique_ptr handles it
+        // The last shared_ptr owner frees the nodes, possibly on the background reclaimer
+        releaseNodes(std::move(pImpl), reclaimMode == ReclaimMode::Background);
     }
-    AVLTree::AVLTree(const AVLTree& other) : pImpl(std::make_unique<AVLTreeImpl>()) {
-        if (other.pImpl && other.pImpl->root) {
-            pImpl->root = pImpl->copyTree(other.pImpl->root);  // Deep copy of the tree
-        } else {
-            pImpl->root = nullptr;
-        }
+    AVLTree::AVLTree(const AVLTree& other)
+        : pImpl(other.pImpl), reclaimMode(other.reclaimMode), insertMode(other.insertMode),
+          duplicatePolicy(other.duplicatePolicy), filter(other.filter) {
+        // The nodes are copied only when one of the trees is changed, see detach()
     }
 
-    AVLTree::AVLTree(AVLTree&& other) noexcept {
+    AVLTree::AVLTree(AVLTree&& other) noexcept
+        : reclaimMode(other.reclaimMode), insertMode(other.insertMode), duplicatePolicy(other.duplicatePolicy) {
         pImpl = std::move(other.pImpl); // Transfer ownership
-        other.pImpl = std::make_unique<AVLTreeImpl>(); // Reset the moved-from object to a new, empty state
+        filter = std::move(other.filter);
+        other.pImpl = AVLTreeImpl::create(pImpl->engine()); // Reset the moved-from object to a new, empty state
+        if (filter) other.filter = std::make_shared<LookupFilter>(0);
     }
 
     AVLTree& AVLTree::operator=(const AVLTree& other) {
-        if (this != &other) {
-            // Free existing resources
-            pImpl->freeMemory(pImpl->root);
-            pImpl->root = nullptr;
-
-            // Deep copy the other tree
-            if (other.pImpl && other.pImpl->root) {
-                pImpl->root = pImpl->copyTree(other.pImpl->root);
-            }
+        if (pImpl != other.pImpl) {
+            std::shared_ptr<AVLTreeImpl> previous = std::exchange(pImpl, other.pImpl);
+            releaseNodes(std::move(previous), reclaimMode == ReclaimMode::Background);
         }
+        duplicatePolicy = other.duplicatePolicy;  // The contents may repeat values, so the policy goes with them
+        filter = other.filter;
         return *this;
     }
 
     AVLTree& AVLTree::operator=(AVLTree&& other) noexcept {
         if (this != &other) {
             // Release any existing resources
-            pImpl.reset();
+            releaseNodes(std::move(pImpl), reclaimMode == ReclaimMode::Background);
 
             // Transfer ownership of pImpl
             pImpl = std::move(other.pImpl);
+            filter = std::move(other.filter);
+            duplicatePolicy = other.duplicatePolicy;
 
             // Reset the moved-from object to a new, empty state
-            other.pImpl = std::make_unique<AVLTreeImpl>();
+            other.pImpl = AVLTreeImpl::create(pImpl->engine());
+            if (filter) other.filter = std::make_shared<LookupFilter>(0);
         }
         return *this;
     }
 
+    void AVLTree::detach() {
+        if (pImpl.use_count() == 1) {
+            // Pairs with the release in the former co-owners' destructors, so their reads happen before our writes
+            std::atomic_thread_fence(std::memory_order_acquire);
+            return;
+        }
+        pImpl = pImpl->clone();
+    }
+
+    void AVLTree::reset() {
+        if (filter) filter = std::make_shared<LookupFilter>(0);
+        if (pImpl.use_count() == 1 && reclaimMode == ReclaimMode::Immediate) {
+            pImpl->clear();
+            return;
+        }
+        std::shared_ptr<AVLTreeImpl> previous = std::exchange(pImpl, AVLTreeImpl::create(pImpl->engine()));
+        releaseNodes(std::move(previous), reclaimMode == ReclaimMode::Background);
+    }
+
+    void AVLTree::clear_async() {
+        if (filter) filter = std::make_shared<LookupFilter>(0);
+        std::shared_ptr<AVLTreeImpl> previous = std::exchange(pImpl, AVLTreeImpl::create(pImpl->engine()));
+        releaseNodes(std::move(previous), true);
+    }
+
+    void AVLTree::wait_for_reclamation() {
+        TreeReclaimer::instance().wait();
+    }
+
+    std::size_t AVLTree::pending_reclamation_bytes() {
+        return TreeReclaimer::instance().pending();
+    }
+
+    void AVLTree::set_reclamation_limit(std::size_t bytes) {
+        TreeReclaimer::instance().setLimit(bytes);
+    }
+
+    void AVLTree::assignValues(std::vector<double>& values, DuplicatePolicy duplicates) {
+        if (duplicates == DuplicatePolicy::Count && duplicatePolicy != DuplicatePolicy::Count)
+            throw std::invalid_argument("AVLTree: only a tree constructed with DuplicatePolicy::Count can count duplicates");
+        if (!std::is_sorted(values.begin(), values.end()))
+            std::sort(values.begin(), values.end());
+
+        auto duplicate = std::adjacent_find(values.begin(), values.end());
+        if (duplicate != values.end() && duplicatePolicy != DuplicatePolicy::Count) {
+            if (duplicates == DuplicatePolicy::Reject)
+                throw DuplicateValueException(*duplicate);
+            values.erase(std::unique(duplicate, values.end()), values.end());
+        }
+
+        assignSorted(values.data(), values.size());
+    }
+
+    void AVLTree::assignSorted(const double* values, std::size_t count) {
+        // Built first, so that a failed allocation leaves the old contents and filter in place
+        std::shared_ptr<LookupFilter> rebuilt;
+        if (filter) {
+            rebuilt = std::make_shared<LookupFilter>(count);
+            for (std::size_t i = 0; i < count; ++i) rebuilt->add(values[i]);
+        }
+        std::shared_ptr<AVLTreeImpl> built = AVLTreeImpl::create(pImpl->engine());
+        built->assignSorted(values, count);
+        std::shared_ptr<AVLTreeImpl> previous = std::exchange(pImpl, std::move(built));
+        releaseNodes(std::move(previous), reclaimMode == ReclaimMode::Background);
+        if (rebuilt) filter = std::move(rebuilt);
+    }
+
+    void AVLTree::rebuildFilter(std::size_t incoming) {
+        std::shared_ptr<LookupFilter> rebuilt = std::make_shared<LookupFilter>(size() + incoming);
+        for (TreePosition at = pImpl->first(); at.node; pImpl->next(at))
+            rebuilt->add(pImpl->valueAt(at));
+        filter = std::move(rebuilt);
+    }
+
+    void AVLTree::widenFilter(std::size_t incoming) {
+        if (filter->keyCount() + incoming > filter->capacity()) {
+            rebuildFilter(incoming);
+        } else if (filter.use_count() == 1) {
+            std::atomic_thread_fence(std::memory_order_acquire);  // As in detach()
+        } else {
+            filter = std::make_shared<LookupFilter>(*filter);
+        }
+    }
+
+    void AVLTree::trimFilter() {
+        if (!filter || filter->keyCount() <= 2 * size() + LookupFilter::kMinimumCapacity) return;
+        try {
+            rebuildFilter();
+        } catch (const std::bad_alloc&) {
+            // The old filter still passes every stored value; it only lets more misses through
+        }
+    }
+
+    void AVLTree::set_lookup_filter(bool enabled) {
+        if (!enabled)
+            filter.reset();
+        else if (!filter)
+            rebuildFilter();
+    }
+
     void AVLTree::insert(const double& val) {
-        pImpl->root = pImpl->insertNode(pImpl->root, val, nullptr);
+        if (duplicatePolicy == DuplicatePolicy::Ignore && search(val)) return;
+        detach();
+        if (filter) widenFilter(1);
+        if (duplicatePolicy == DuplicatePolicy::Count)
+            pImpl->insertCopy(val);  // A repeat only bumps a count, so the finger has nothing to save
+        else if (pImpl->engine() != StorageEngine::Linked)
+            pImpl->insertValue(val);
+        else if (insertMode == InsertMode::Finger)
+            linked(pImpl).insertNear(TreePosition(), val);
+        else
+            linked(pImpl).insertValue(val);  // Direct call, like containsValue()
+        if (filter) filter->add(val);
+    }
+
+    AVLTree::const_iterator AVLTree::insert(const_iterator hint, double val) {
+        // A hint into another tree, or into nodes that detach() is about to copy, is of no use
+        TreePosition near = hint.tree == pImpl.get() && pImpl.use_count() == 1 ? hint.position : TreePosition();
+        if (duplicatePolicy == DuplicatePolicy::Ignore && search(val)) return find(val);
+        detach();
+        if (filter) widenFilter(1);
+        TreePosition at = duplicatePolicy == DuplicatePolicy::Count ? pImpl->insertCopy(val) : pImpl->insertNear(near, val);
+        if (filter) filter->add(val);
+        return const_iterator(at, pImpl.get());
     }
 
     void AVLTree::remove(double val) {
-        pImpl->root = pImpl->deleteNode(pImpl->root, val);
+        if (filter && !filter->mayContain(val)) return;
+        if (pImpl.use_count() > 1 && !search(val)) return;  // Nothing to remove, so nothing to copy
+        detach();
+        if (pImpl->eraseValue(val)) trimFilter();
+    }
+
+    void AVLTree::search_many(const double* keys, std::size_t keyCount, bool* results) const {
+        if (!filter) {
+            pImpl->containsMany(keys, keyCount, results);
+            return;
+        }
+        // Only the keys that get past the filter go on to the tree
+        std::vector<double> passed;
+        std::vector<std::size_t> positions;
+        for (std::size_t i = 0; i < keyCount; ++i) {
+            results[i] = filter->mayContain(keys[i]);
+            if (results[i]) {
+                passed.push_back(keys[i]);
+                positions.push_back(i);
+            } else {
+                filter->recordRejection();
+            }
+        }
+        std::unique_ptr<bool[]> found(new bool[passed.size()]);
+        pImpl->containsMany(passed.data(), passed.size(), found.get());
+        for (std::size_t i = 0; i < passed.size(); ++i) {
+            results[positions[i]] = found[i];
+            if (!found[i]) filter->recordFalsePositive();
+        }
     }
 
     bool AVLTree::search(double val) const {
-        return pImpl->searchNode(pImpl->root, val);
+        if (!filter) return containsValue(pImpl, val);
+        if (!filter->mayContain(val)) {
+            filter->recordRejection();
+            return false;
+        }
+        bool found = containsValue(pImpl, val);
+        if (!found) filter->recordFalsePositive();
+        return found;
     }
 
     void AVLTree::getInOrderTraversal() const {
-        pImpl->inOrderTraversal(pImpl->root, std::cout);
+        std::cout << *this;
+    }
+
+    StorageEngine AVLTree::storage_engine() const {
+        return pImpl->engine();
+    }
+
+    std::size_t AVLTree::size() const {
+        return pImpl->count();
+    }
+
+    bool AVLTree::empty() const {
+        return pImpl->count() == 0;
+    }
+
+    std::size_t AVLTree::rank(double val) const {
+        return pImpl->rankOf(val);
+    }
+
+    double AVLTree::select(std::size_t k) const {
+        const double* value = pImpl->selectValue(k);
+        if (!value)
+            throw std::out_of_range("select: index " + std::to_string(k) + " is out of range");
+        return *value;
+    }
+
+    double AVLTree::median() const {
+        std::size_t count = size();
+        if (count == 0)
+            throw std::out_of_range("median: the tree is empty");
+        double upper = *pImpl->selectValue(count / 2);
+        if (count % 2 == 1)
+            return upper;
+        return (*pImpl->selectValue(count / 2 - 1) + upper) / 2;
+    }
+
+    std::size_t AVLTree::count(double val) const {
+        return pImpl->rangeCount(val, val);
+    }
+
+    std::size_t AVLTree::range_count(double lo, double hi) const {
+        return pImpl->rangeCount(lo, hi);
+    }
+
+    double AVLTree::range_sum(double lo, double hi) const {
+        return pImpl->rangeSum(lo, hi);
+    }
+
+    std::optional<std::pair<double, double>> AVLTree::range_minmax(double lo, double hi) const {
+        // Subtree minima and maxima are the leftmost and rightmost nodes, so two bound searches suffice
+        TreePosition first = pImpl->lowerBound(lo);
+        TreePosition last = pImpl->lastNotAbove(hi);
+        if (!first.node || !last.node || pImpl->valueAt(first) > hi || pImpl->valueAt(last) < lo)
+            return std::nullopt;
+        return std::make_pair(pImpl->valueAt(first), pImpl->valueAt(last));
+    }
+
+    TreeStats AVLTree::stats() const {
+        TreeStats stats = pImpl->stats();
+        if (filter) {
+            stats.filterBytes = filter->memoryBytes();
+            stats.filterFalsePositiveRate = filter->falsePositiveRate();
+            stats.filterObservedFalsePositiveRate = filter->observedFalsePositiveRate();
+        }
+        return stats;
+    }
+
+    OperationCounters AVLTree::operation_counters() {
+        return totalCounters();
+    }
+
+    void AVLTree::reset_operation_counters() {
+        resetCounters();
+    }
+
+    void AVLTree::join(AVLTree& other) {
+        if (other.empty()) return;
+        bool otherFirst = false;
+        if (!empty() && pImpl->valueAt(pImpl->last()) >= other.pImpl->valueAt(other.pImpl->first())) {
+            if (other.pImpl->valueAt(other.pImpl->last()) >= pImpl->valueAt(pImpl->first()))
+                throw std::invalid_argument("join: the value ranges of the trees overlap");
+            otherFirst = true;
+        }
+        // Counted nodes may only move into a tree that counts duplicates too
+        bool counted = duplicatePolicy != DuplicatePolicy::Count && other.duplicatePolicy == DuplicatePolicy::Count;
+        if (!bothLinked(*pImpl, *other.pImpl) || counted) {
+            std::vector<double> values = sortedValues(otherFirst ? *other.pImpl : *pImpl);
+            std::vector<double> rest = sortedValues(otherFirst ? *pImpl : *other.pImpl);
+            values.insert(values.end(), rest.begin(), rest.end());
+            if (counted) values.erase(std::unique(values.begin(), values.end()), values.end());
+            assignSorted(values.data(), values.size());
+            other.reset();
+            return;
+        }
+        detach();
+        other.detach();
+        if (filter) {
+            widenFilter(other.size());
+            for (double value : other) filter->add(value);
+        }
+        LinkedAVLTreeImpl& mine = linked(pImpl);
+        LinkedAVLTreeImpl& theirs = linked(other.pImpl);
+        AVLNode* left = otherFirst ? theirs.root : mine.root;
+        AVLNode* right = otherFirst ? mine.root : theirs.root;
+        mine.adoptStorage(theirs);
+        theirs.root = nullptr;
+        mine.root = mine.joinTwo(left, right);
+        other.trimFilter();
+    }
+
+    AVLTree AVLTree::split(double key) {
+        AVLTree rest(pImpl->engine(), duplicatePolicy);
+        rest.filter = filter;  // Holds every value of both parts, so both may keep using it
+        if (pImpl->engine() != StorageEngine::Linked) {
+            std::vector<double> values = sortedValues(*pImpl);
+            std::size_t kept = static_cast<std::size_t>(std::lower_bound(values.begin(), values.end(), key) - values.begin());
+            rest.assignSorted(values.data() + kept, values.size() - kept);
+            assignSorted(values.data(), kept);
+            return rest;
+        }
+
+        detach();
+        LinkedAVLTreeImpl& mine = linked(pImpl);
+        mine.finger = nullptr;  // It may end up in the other part
+        AVLNode* left;
+        AVLNode* found;
+        AVLNode* right;
+        mine.splitNodes(mine.root, key, left, found, right);
+        if (found) right = mine.joinNodes(nullptr, found, right);
+
+#ifdef AVL_USE_GLOBAL_HEAP
+        // No node is copied, so the content hash is divided up by walking the smaller part
+        std::uint64_t total = mine.hash;
+        bool leftSmaller = mine.getSize(left) < mine.getSize(right);
+        std::uint64_t smaller = mine.hashNodes(leftSmaller ? left : right);
+        mine.root = left;
+        mine.hash = leftSmaller ? smaller : total - smaller;
+        linked(rest.pImpl).root = right;
+        linked(rest.pImpl).hash = total - mine.hash;
+#else
+        // Both parts still live in this tree's pool, so the smaller one is copied into a pool of its own
+        bool moveLeft = mine.getSize(left) < mine.getSize(right);
+        AVLNode* smaller = moveLeft ? left : right;
+        LinkedAVLTreeImpl& theirs = linked(rest.pImpl);
+        try {
+            theirs.root = theirs.copyTree(smaller);
+        } catch (...) {
+            mine.root = mine.joinTwo(left, right);
+            throw;
+        }
+        mine.freeMemory(smaller);
+        mine.root = moveLeft ? right : left;
+        if (moveLeft) std::swap(pImpl, rest.pImpl);
+#endif
+        return rest;
+    }
+
+    bool AVLTree::countsDuplicates(const AVLTree& other) const {
+        return duplicatePolicy == DuplicatePolicy::Count || other.duplicatePolicy == DuplicatePolicy::Count;
+    }
+
+    AVLTree& AVLTree::set_union(const AVLTree& other, unsigned threads) {
+        if (other.pImpl == pImpl) return *this;  // A tree sharing this one's nodes holds the same values
+        if (bothLinked(*pImpl, *other.pImpl) && !countsDuplicates(other)) {
+            detach();
+            if (filter) {
+                widenFilter(other.size());
+                for (double value : other) filter->add(value);
+            }
+            applySetOperation(linked(pImpl), &LinkedAVLTreeImpl::uniteNodes, linked(other.pImpl), threads);
+        } else {
+            std::vector<double> mine = sortedValues(*pImpl);
+            std::vector<double> theirs = sortedValues(*other.pImpl);
+            std::vector<double> merged;
+            merged.reserve(mine.size() + theirs.size());
+            std::set_union(mine.begin(), mine.end(), theirs.begin(), theirs.end(), std::back_inserter(merged));
+            if (duplicatePolicy != DuplicatePolicy::Count)
+                merged.erase(std::unique(merged.begin(), merged.end()), merged.end());
+            assignSorted(merged.data(), merged.size());
+        }
+        return *this;
+    }
+
+    AVLTree& AVLTree::set_intersection(const AVLTree& other, unsigned threads) {
+        if (other.pImpl == pImpl) return *this;
+        if (bothLinked(*pImpl, *other.pImpl) && !countsDuplicates(other)) {
+            detach();
+            applySetOperation(linked(pImpl), &LinkedAVLTreeImpl::intersectNodes, linked(other.pImpl), threads);
+            trimFilter();
+        } else {
+            std::vector<double> mine = sortedValues(*pImpl);
+            std::vector<double> theirs = sortedValues(*other.pImpl);
+            std::vector<double> merged;
+            std::set_intersection(mine.begin(), mine.end(), theirs.begin(), theirs.end(), std::back_inserter(merged));
+            assignSorted(merged.data(), merged.size());
+        }
+        return *this;
+    }
+
+    AVLTree& AVLTree::set_difference(const AVLTree& other, unsigned threads) {
+        if (other.pImpl == pImpl) {
+            reset();
+        } else if (bothLinked(*pImpl, *other.pImpl) && !countsDuplicates(other)) {
+            detach();
+            applySetOperation(linked(pImpl), &LinkedAVLTreeImpl::subtractNodes, linked(other.pImpl), threads);
+            trimFilter();
+        } else {
+            std::vector<double> mine = sortedValues(*pImpl);
+            std::vector<double> theirs = sortedValues(*other.pImpl);
+            std::vector<double> merged;
+            std::set_difference(mine.begin(), mine.end(), theirs.begin(), theirs.end(), std::back_inserter(merged));
+            assignSorted(merged.data(), merged.size());
+        }
+        return *this;
+    }
+
+    AVLTree::const_iterator::reference AVLTree::const_iterator::operator*() const {
+        return tree->valueAt(position);
+    }
+
+    AVLTree::const_iterator::pointer AVLTree::const_iterator::operator->() const {
+        return &tree->valueAt(position);
+    }
+
+    AVLTree::const_iterator& AVLTree::const_iterator::operator++() {
+        tree->next(position);
+        return *this;
+    }
+
+    AVLTree::const_iterator AVLTree::const_iterator::operator++(int) {
+        const_iterator previous = *this;
+        ++*this;
+        return previous;
+    }
+
+    AVLTree::const_iterator& AVLTree::const_iterator::operator--() {
+        tree->prev(position);
+        return *this;
+    }
+
+    AVLTree::const_iterator AVLTree::const_iterator::operator--(int) {
+        const_iterator previous = *this;
+        --*this;
+        return previous;
+    }
+
+    AVLTree::const_iterator AVLTree::begin() const {
+        return const_iterator(pImpl->first(), pImpl.get());
+    }
+
+    AVLTree::const_iterator AVLTree::end() const {
+        return const_iterator(TreePosition(), pImpl.get());
+    }
+
+    AVLTree::const_iterator AVLTree::find(double val) const {
+        return const_iterator(pImpl->find(val), pImpl.get());
+    }
+
+    AVLTree::const_iterator AVLTree::lower_bound(double val) const {
+        return const_iterator(pImpl->lowerBound(val), pImpl.get());
+    }
+
+    AVLTree::const_iterator AVLTree::upper_bound(double val) const {
+        return const_iterator(pImpl->upperBound(val), pImpl.get());
+    }
+
+    std::pair<AVLTree::const_iterator, AVLTree::const_iterator> AVLTree::equal_range(double val) const {
+        return {lower_bound(val), upper_bound(val)};
     }
 
     std::string AVLTree::toString() const {
-        if (!pImpl || !pImpl->root) {
-            return ""; // Return an empty string if the tree is empty or pImpl is null
+        return toString(FormatOptions());
+    }
+
+    std::string AVLTree::toString(const FormatOptions& options) const {
+        std::string text;
+        if (!pImpl || empty()) {
+            return text; // Return an empty string if the tree is empty or pImpl is null
         }
-        std::ostringstream os;
-        pImpl->inOrderTraversal(pImpl->root, os);
-        return os.str();
+        // Most values print in well under 12 characters at the default precision
+        text.reserve(size() * (options.separator.size() + 12));
+        StringSink sink(text);
+        pImpl->writeValues(sink, options);
+        return text;
+    }
+
+    void AVLTree::write(OutputSink& sink, const FormatOptions& options) const {
+        pImpl->writeValues(sink, options);
     }
 
     AVLTree& AVLTree::operator+=(const double& val) {
@@ -127,26 +824,61 @@ namespace AVLProject {
         return *this;
     }
 
+    AVLTree& AVLTree::operator+=(const AVLTree& other) {
+        return set_union(other);
+    }
+
+    AVLTree& AVLTree::operator&=(const AVLTree& other) {
+        return set_intersection(other);
+    }
+
+    AVLTree& AVLTree::operator-=(const AVLTree& other) {
+        return set_difference(other);
+    }
+
+    AVLTree AVLTree::operator+(const AVLTree& other) const {
+        AVLTree result(*this);
+        result += other;
+        return result;
+    }
+
+    AVLTree AVLTree::operator&(const AVLTree& other) const {
+        AVLTree result(*this);
+        result &= other;
+        return result;
+    }
+
+    AVLTree AVLTree::operator-(const AVLTree& other) const {
+        AVLTree result(*this);
+        result -= other;
+        return result;
+    }
+
     bool AVLTree::operator[](const double& val) const {
         return search(val);
     }
 
     AVLTree& AVLTree::operator--() {
-        if (pImpl->root) {
-            pImpl->root = pImpl->deleteNode(pImpl->root, pImpl->root->value);
+        if (!empty()) {
+            detach();
+            pImpl->eraseRoot();
+            trimFilter();
         }
         return *this;
     }
 
     void AVLTree::operator!() {
         if (pImpl) {
-            pImpl->freeMemory(pImpl->root);
-            pImpl->root = nullptr; // Ensure the tree is properly reset
+            reset(); // Ensure the tree is properly reset
         }
     }
 
     bool AVLTree::operator==(const AVLTree& other) const {
-        return pImpl->compareTrees(pImpl->root, other.pImpl->root); //viskas apie sumas turetu but
+        if (pImpl == other.pImpl) return true;  // Copies that still share their nodes
+        // Both are kept current by every write, so most unequal trees are told apart without reading a node
+        if (size() != other.size() || pImpl->contentHash() != other.pImpl->contentHash())
+            return false;
+        return std::equal(begin(), end(), other.begin());
     }
 
     bool AVLTree::operator!=(const AVLTree& other) const {
@@ -154,11 +886,11 @@ namespace AVLProject {
     }
 
     bool AVLTree::operator>(const AVLTree& other) const {
-        return pImpl->sumValues(pImpl->root) > other.pImpl->sumValues(other.pImpl->root);
+        return pImpl->total() > other.pImpl->total();
     }
 
     bool AVLTree::operator<(const AVLTree& other) const {
-        return pImpl->sumValues(pImpl->root) < other.pImpl->sumValues(other.pImpl->root);
+        return pImpl->total() < other.pImpl->total();
     }
 
     bool AVLTree::operator>=(const AVLTree& other) const {
@@ -170,174 +902,641 @@ namespace AVLProject {
     }
 
     std::ostream& operator<<(std::ostream& os, const AVLTree& tree) {
-        tree.pImpl->inOrderTraversal(tree.pImpl->root, os);
+        FormatOptions options;
+        options.precision = static_cast<int>(os.precision());
+        std::ios_base::fmtflags notation = os.flags() & std::ios_base::floatfield;
+        if (notation == std::ios_base::fixed)
+            options.format = std::chars_format::fixed;
+        else if (notation == std::ios_base::scientific)
+            options.format = std::chars_format::scientific;
+        else if (notation == (std::ios_base::fixed | std::ios_base::scientific))
+            options.format = std::chars_format::hex;
+
+        OStreamSink sink(os);
+        tree.pImpl->writeValues(sink, options);
         return os;
     }
 
-    // AVLTreeImpl Private Methods
-    AVLNode* AVLTreeImpl::insertNode(AVLNode* node, const double& val, AVLNode* parent) {
-        if (!node) return new AVLNode(val, parent);
+    std::shared_ptr<AVLTreeImpl> AVLTreeImpl::create(StorageEngine engine) {
+        switch (engine) {
+        case StorageEngine::Compact:
+            return std::make_shared<CompactAVLTreeImpl>();
+        case StorageEngine::BPlus:
+            return std::make_shared<BPlusTreeImpl>();
+        default:
+            return std::make_shared<LinkedAVLTreeImpl>();
+        }
+    }
 
-        if (val < node->value)
-            node->left = insertNode(node->left, val, node);
-        else if (val > node->value)
-            node->right = insertNode(node->right, val, node);
-        else if(val == 2*val)
-            throw DuplicateValueException(val);  // Pass the duplicate value to the exception
+    // LinkedAVLTreeImpl engine interface
+    std::shared_ptr<AVLTreeImpl> LinkedAVLTreeImpl::clone() const {
+        auto copy = std::make_shared<LinkedAVLTreeImpl>();
+        copy->root = copy->copyTree(root);
+        return copy;
+    }
 
-        node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
-        int balance = getBalanceFactor(node);
+    void LinkedAVLTreeImpl::eraseRoot() {
+        if (!root) return;
+        if (root->count > 1)
+            changeCopies(root, -1);
+        else
+            eraseNode(root);
+    }
 
-        if (balance > 1 && val < node->left->value) return rotateRight(node);
-        if (balance < -1 && val > node->right->value) return rotateLeft(node);
-        if (balance > 1 && val > node->left->value) {
-            node->left = rotateLeft(node->left);
-            return rotateRight(node);
+    void LinkedAVLTreeImpl::assignSorted(const double* values, std::size_t count) {
+        if (std::adjacent_find(values, values + count) == values + count) {
+            root = buildBalanced(values, count);
+            return;
         }
-        if (balance < -1 && val < node->right->value) {
-            node->right = rotateRight(node->right);
-            return rotateLeft(node);
+        // Runs of equal values, from a tree that counts duplicates, become one node each
+        std::vector<double> distinct;
+        std::vector<std::uint32_t> counts;
+        for (std::size_t i = 0; i < count; ++i) {
+            if (!distinct.empty() && distinct.back() == values[i]) {
+                if (counts.back() == std::numeric_limits<std::uint32_t>::max())
+                    throw std::length_error("AVLTree: too many copies of one value");
+                ++counts.back();
+            } else {
+                distinct.push_back(values[i]);
+                counts.push_back(1);
+            }
         }
-
-        return node;
+        root = buildBalanced(distinct.data(), distinct.size());
+        const std::uint32_t* next = counts.data();
+        applyCounts(root, next);
     }
 
-    AVLNode* AVLTreeImpl::deleteNode(AVLNode* node, const double& val) {
-        if (!node) return nullptr;
+    bool LinkedAVLTreeImpl::contains(double val) const {
+        return findNode(val) != nullptr;
+    }
 
-        if (val < node->value)
-            node->left = deleteNode(node->left, val);
-        else if (val > node->value)
-            node->right = deleteNode(node->right, val);
-        else {
-            if (!node->left || !node->right) {
-                AVLNode* temp = node->left ? node->left : node->right;
-                if (temp) temp->parent = node->parent;
-                delete node;
-                return temp;
-            } else {
-                AVLNode* temp = minValueNode(node->right);
-                node->value = temp->value;
-                node->right = deleteNode(node->right, temp->value);
-            }
+    void LinkedAVLTreeImpl::containsMany(const double* keys, std::size_t count, bool* results) const {
+        if (!root) {
+            std::fill(results, results + count, false);
+            return;
         }
+        std::uint64_t compared = 0;
+        searchInterleaved<const AVLNode*>(root, keys, count, results, [&compared](const AVLNode*& node, double key) {
+            ++compared;
+            if (key == node->value) return 1;
+            node = key < node->value ? node->left : node->right;
+            if (!node) return -1;
+            prefetchNode(node);
+            return 0;
+        });
+        countEvent(Counter::Comparisons, compared);
+    }
+
+    const double* LinkedAVLTreeImpl::selectValue(std::size_t k) const {
+        const AVLNode* node = selectNode(k);
+        return node ? &node->value : nullptr;
+    }
+
+    std::size_t LinkedAVLTreeImpl::rangeCount(double lo, double hi) const {
+        std::size_t count;
+        double sum;
+        rangeAggregate(lo, hi, count, sum);
+        return count;
+    }
+
+    double LinkedAVLTreeImpl::rangeSum(double lo, double hi) const {
+        std::size_t count;
+        double sum;
+        rangeAggregate(lo, hi, count, sum);
+        return sum;
+    }
+
+    TreePosition LinkedAVLTreeImpl::first() const {
+        return {root ? minNode(static_cast<const AVLNode*>(root)) : nullptr, 0};
+    }
+
+    TreePosition LinkedAVLTreeImpl::last() const {
+        const AVLNode* node = root ? maxNode(static_cast<const AVLNode*>(root)) : nullptr;
+        return {node, node ? node->count - 1u : 0};
+    }
+
+    TreePosition LinkedAVLTreeImpl::find(double val) const {
+        return {findNode(val), 0};
+    }
 
-        if (!node) return node;
+    TreePosition LinkedAVLTreeImpl::lowerBound(double val) const {
+        return {lowerBoundNode(val), 0};
+    }
+
+    TreePosition LinkedAVLTreeImpl::upperBound(double val) const {
+        return {upperBoundNode(val), 0};
+    }
+
+    TreePosition LinkedAVLTreeImpl::lastNotAbove(double val) const {
+        return {lastNotAboveNode(val), 0};
+    }
 
-        node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
-        int balance = getBalanceFactor(node);
+    void LinkedAVLTreeImpl::next(TreePosition& position) const {
+        // The slot numbers the copies of a counted value
+        const AVLNode* node = static_cast<const AVLNode*>(position.node);
+        if (position.slot + 1 < node->count) {
+            ++position.slot;
+        } else {
+            position.node = successor(node);
+            position.slot = 0;
+        }
+    }
 
-        if (balance > 1 && getBalanceFactor(node->left) >= 0) return rotateRight(node);
-        if (balance > 1 && getBalanceFactor(node->left) < 0) {
-            node->left = rotateLeft(node->left);
-            return rotateRight(node);
+    void LinkedAVLTreeImpl::prev(TreePosition& position) const {
+        if (!position.node) {
+            position = last();
+        } else if (position.slot > 0) {
+            --position.slot;
+        } else {
+            const AVLNode* node = predecessor(static_cast<const AVLNode*>(position.node));
+            position = {node, node ? node->count - 1u : 0};
         }
-        if (balance < -1 && getBalanceFactor(node->right) <= 0) return rotateLeft(node);
-        if (balance < -1 && getBalanceFactor(node->right) > 0) {
-            node->right = rotateRight(node->right);
-            return rotateLeft(node);
+    }
+
+    const double& LinkedAVLTreeImpl::valueAt(const TreePosition& position) const {
+        return static_cast<const AVLNode*>(position.node)->value;
+    }
+
+    std::size_t LinkedAVLTreeImpl::memoryBytes() const {
+#ifdef AVL_USE_GLOBAL_HEAP
+        return getSize(root) * sizeof(AVLNode);  // Counts a node per copy, so it overstates trees with counted duplicates
+#else
+        return pool.capacityBytes();
+#endif
+    }
+
+    TreeStats LinkedAVLTreeImpl::stats() const {
+        TreeStats stats;
+        stats.nodeCount = getSize(root);
+        stats.height = height(root);
+        stats.memoryBytes = sizeof(LinkedAVLTreeImpl) + memoryBytes();
+        stats.depthHistogram.assign(static_cast<std::size_t>(stats.height), 0);
+
+        // Pre-order walk; the pending right subtrees never outnumber the levels
+        struct Pending {
+            const AVLNode* node;
+            std::size_t depth;
+        };
+        Pending pending[kMaxHeight];
+        int top = 0;
+        if (root) pending[top++] = {root, 0};
+        while (top > 0) {
+            Pending next = pending[--top];
+            for (const AVLNode* node = next.node; node; node = node->left, ++next.depth) {
+                ++stats.depthHistogram[next.depth];
+                if (node->right) pending[top++] = {node->right, next.depth + 1};
+            }
         }
+        return stats;
+    }
 
+    // LinkedAVLTreeImpl Private Methods
+    AVLNode* LinkedAVLTreeImpl::createNode(double val, AVLNode* parent) {
+        // Allocated first, so that a failed allocation leaves the hash and the counters alone
+#ifdef AVL_USE_GLOBAL_HEAP
+        AVLNode* node = new AVLNode(val, parent);
+#else
+        AVLNode* node = pool.create(val, parent);
+#endif
+        countEvent(Counter::Allocations);
+        hash += valueHash(val);
         return node;
     }
 
-    void AVLTreeImpl::freeMemory(AVLNode* node) {
-        if (node) {
-            freeMemory(node->left);
-            freeMemory(node->right);
-            delete node;
+    void LinkedAVLTreeImpl::destroyNode(AVLNode* node) {
+        countEvent(Counter::Frees);
+        if (node == finger) finger = nullptr;
+        hash -= valueHash(node->value) * node->count;
+#ifdef AVL_USE_GLOBAL_HEAP
+        delete node;
+#else
+        pool.destroy(node);
+#endif
+    }
+
+    void LinkedAVLTreeImpl::clear() {
+#ifdef AVL_USE_GLOBAL_HEAP
+        freeMemory(root);
+#else
+        countEvent(Counter::Frees, getSize(root));
+        pool.releaseAll();  // Drops every slab at once instead of walking the tree
+#endif
+        root = nullptr;
+        finger = nullptr;
+        hash = 0;
+    }
+
+    void LinkedAVLTreeImpl::insertValue(double val) {
+        insertLeaf(val, false);
+    }
+
+    TreePosition LinkedAVLTreeImpl::insertCopy(double val) {
+        AVLNode* node = insertLeaf(val, true);
+        return {node, node->count - 1u};
+    }
+
+    AVLNode* LinkedAVLTreeImpl::insertLeaf(double val, bool countCopies) {
+        // Descend once, remembering the link the new leaf will hang from
+        AVLNode* parent;
+        AVLNode** link;
+        if (AVLNode* found = findSlot(val, parent, link)) {
+            if (!countCopies)
+                throw DuplicateValueException(val);  // Pass the duplicate value to the exception
+            changeCopies(found, 1);  // No new node, so nothing to rebalance
+            return found;
+        }
+        countEvent(Counter::Inserts);
+
+        AVLNode* inserted = createNode(val, parent);
+        attach(inserted, parent, link);
+        fingerIsMax = fingerIsMin = false;  // The new value may lie beyond the finger
+        return inserted;
+    }
+
+    void LinkedAVLTreeImpl::changeCopies(AVLNode* node, int delta) {
+        if (delta > 0 && node->count == std::numeric_limits<std::uint32_t>::max())
+            throw std::length_error("AVLTree: too many copies of one value");
+        countEvent(delta > 0 ? Counter::Inserts : Counter::Erases);
+        node->count += delta;
+        hash += delta > 0 ? valueHash(node->value) : -valueHash(node->value);
+        double change = delta > 0 ? node->value : -node->value;
+        for (AVLNode* up = node; up; up = up->parent) {
+            up->size += delta;
+            up->sum += change;
         }
     }
 
-    void AVLTreeImpl::inOrderTraversal(AVLNode* node, std::ostream& os) const {
-        if (node) {
-            inOrderTraversal(node->left, os);
-            os << node->value << " ";
-            inOrderTraversal(node->right, os);
+    std::uint64_t LinkedAVLTreeImpl::hashNodes(const AVLNode* node) const {
+        std::uint64_t total = 0;
+        for (; node; node = node->right)  // Recurses only to the left, so the depth stays within the height
+            total += valueHash(node->value) * node->count + hashNodes(node->left);
+        return total;
+    }
+
+    void LinkedAVLTreeImpl::applyCounts(AVLNode* node, const std::uint32_t*& counts) {
+        // In-order, so that the counts line up with the sorted values; aggregates are redone on the way out
+        if (!node) return;
+        applyCounts(node->left, counts);
+        node->count = *counts++;
+        hash += valueHash(node->value) * (node->count - 1);  // The first copy was hashed when the node was made
+        applyCounts(node->right, counts);
+        LinkedNodeHooks::update(node);
+    }
+
+    TreePosition LinkedAVLTreeImpl::insertNear(TreePosition hint, double val) {
+        AVLNode* node = hint.node ? const_cast<AVLNode*>(static_cast<const AVLNode*>(hint.node)) : finger;
+        bool boundedBelow = false;  // Whether a stored value smaller than val is known
+        bool boundedAbove = false;  // Whether a stored value larger than val is known
+        std::uint64_t compared = 0;
+
+        // Climb only until an ancestor bounds val on the far side, then search below the node reached
+        if (!node) {
+            node = root;
+        } else if (val > node->value) {
+            boundedBelow = true;
+            if (!(node == finger && fingerIsMax)) {
+                for (;;) {
+                    AVLNode* up = node;
+                    while (up->parent && up == up->parent->right) up = up->parent;
+                    up = up->parent;  // Lowest ancestor with node in its left subtree
+                    if (!up) break;
+                    ++compared;
+                    if (val < up->value) {
+                        boundedAbove = true;
+                        break;
+                    }
+                    if (val == up->value) throw DuplicateValueException(val);
+                    node = up;
+                }
+            }
+        } else if (val < node->value) {
+            boundedAbove = true;
+            if (!(node == finger && fingerIsMin)) {
+                for (;;) {
+                    AVLNode* up = node;
+                    while (up->parent && up == up->parent->left) up = up->parent;
+                    up = up->parent;  // Lowest ancestor with node in its right subtree
+                    if (!up) break;
+                    ++compared;
+                    if (val > up->value) {
+                        boundedBelow = true;
+                        break;
+                    }
+                    if (val == up->value) throw DuplicateValueException(val);
+                    node = up;
+                }
+            }
+        } else {
+            throw DuplicateValueException(val);
+        }
+
+        AVLNode* parent = node ? node->parent : nullptr;
+        AVLNode** link = !parent ? &root : parent->left == node ? &parent->left : &parent->right;
+        while (*link) {
+            parent = *link;
+            ++compared;
+            if (val < parent->value) {
+                link = &parent->left;
+                boundedAbove = true;
+            } else if (val > parent->value) {
+                link = &parent->right;
+                boundedBelow = true;
+            } else {
+                throw DuplicateValueException(val);
+            }
         }
+        countEvent(Counter::Comparisons, compared);
+        countEvent(Counter::Inserts);
+
+        AVLNode* inserted = createNode(val, parent);
+        attach(inserted, parent, link);
+        finger = inserted;
+        fingerIsMax = !boundedAbove;
+        fingerIsMin = !boundedBelow;
+        return {inserted, 0};
     }
 
-    bool AVLTreeImpl::searchNode(AVLNode* node, const double& val) const {
+    bool LinkedAVLTreeImpl::eraseValue(double val) {
+        AVLNode* node = findNode(val);
         if (!node) return false;
-        if (node->value == val) return true;
-        if (val < node->value) return searchNode(node->left, val);
-        return searchNode(node->right, val);
+        if (node->count > 1)
+            changeCopies(node, -1);  // One copy goes; the node stays
+        else
+            eraseNode(node);
+        return true;
     }
 
-    int AVLTreeImpl::getHeight(const AVLNode* node) const {
-        return node ? node->height : 0;
+    void LinkedAVLTreeImpl::eraseNode(AVLNode* node) {
+        AVLNode* retraceFrom = unlink(node);
+        destroyNode(node);
+        countEvent(Counter::Erases);
+        retraceAfterErase(retraceFrom);
     }
 
-    int AVLTreeImpl::getBalanceFactor(const AVLNode* node) const {
-        return node ? getHeight(node->left) - getHeight(node->right) : 0;
+    void LinkedAVLTreeImpl::freeMemory(AVLNode* node) {
+        freeNodes(node, [this](AVLNode* gone) { destroyNode(gone); });
     }
 
-    AVLNode* AVLTreeImpl::rotateRight(AVLNode* y) {
-        AVLNode* x = y->left;
-        AVLNode* T2 = x->right;
+    void LinkedAVLTreeImpl::writeValues(OutputSink& sink, const FormatOptions& options) const {
+        ValueFormatter formatter(sink, options);
+        for (const AVLNode* current = root ? minNode(root) : nullptr; current; current = successor(current)) {
+            for (std::uint32_t copy = 0; copy < current->count; ++copy)
+                formatter.append(current->value);
+        }
+        formatter.finish();
+    }
 
-        x->right = y;
-        y->left = T2;
+    void LinkedAVLTreeImpl::rangeAggregate(double lo, double hi, std::size_t& count, double& sum) const {
+        count = 0;
+        sum = 0;
 
-        if (T2) T2->parent = y;
-        x->parent = y->parent;
-        y->parent = x;
+        // Find the highest node inside the range; the range splits into its two subtrees there
+        const AVLNode* split = root;
+        while (split && (split->value < lo || split->value > hi))
+            split = split->value < lo ? split->right : split->left;
+        if (!split) return;
 
-        y->height = std::max(getHeight(y->left), getHeight(y->right)) + 1;
-        x->height = std::max(getHeight(x->left), getHeight(x->right)) + 1;
+        count = split->count;
+        sum = split->value * split->count;
+        // Along the lower boundary, every in-range node brings its whole right subtree with it
+        for (const AVLNode* node = split->left; node;) {
+            if (node->value >= lo) {
+                count += node->count + getSize(node->right);
+                sum += node->value * node->count + getSum(node->right);
+                node = node->left;
+            } else {
+                node = node->right;
+            }
+        }
+        // Along the upper boundary, every in-range node brings its whole left subtree with it
+        for (const AVLNode* node = split->right; node;) {
+            if (node->value <= hi) {
+                count += node->count + getSize(node->left);
+                sum += node->value * node->count + getSum(node->left);
+                node = node->right;
+            } else {
+                node = node->left;
+            }
+        }
+    }
 
-        return x;
+    AVLNode* LinkedAVLTreeImpl::copyTree(const AVLNode* node) {
+        return copyNodes(node,
+            [this](const AVLNode& source, AVLNode* parent) {
+                AVLNode* target = createNode(source.value, parent);
+                target->height = source.height;
+                target->size = source.size;
+                target->sum = source.sum;
+                target->count = source.count;
+                hash += valueHash(source.value) * (source.count - 1);
+                return target;
+            },
+            [this](AVLNode* node) { destroyNode(node); });
     }
 
-    AVLNode* AVLTreeImpl::rotateLeft(AVLNode* x) {
-        AVLNode* y = x->right;
-        AVLNode* T2 = y->left;
+    AVLNode* LinkedAVLTreeImpl::buildBalanced(const double* values, std::size_t count) {
+        if (count == 0) return nullptr;
+#ifdef AVL_USE_GLOBAL_HEAP
+        AVLNode* block = nullptr;  // Every node is allocated on its own
+#else
+        AVLNode* block = pool.createBlock(count, 0.0);  // All nodes in one contiguous slab
+        countEvent(Counter::Allocations, count);
+#endif
+        return linkBalanced(0, count, nullptr,
+            [this, block, values](std::size_t index, AVLNode* parent) {
+                if (!block) return createNode(values[index], parent);
+                AVLNode* node = &block[index];
+                hash += valueHash(values[index]);  // Block nodes bypass createNode()
+                node->value = values[index];
+                node->parent = parent;
+                return node;
+            },
+            [this](AVLNode* node) { destroyNode(node); });
+    }
 
-        y->left = x;
-        x->right = T2;
+    std::size_t LinkedAVLTreeImpl::rankOf(double val) const {
+        std::size_t rank = 0;
+        for (const AVLNode* node = root; node;) {
+            if (val <= node->value) {
+                node = node->left;
+            } else {
+                rank += getSize(node->left) + node->count;
+                node = node->right;
+            }
+        }
+        return rank;
+    }
 
-        if (T2) T2->parent = x;
-        y->parent = x->parent;
-        x->parent = y;
+    const AVLNode* LinkedAVLTreeImpl::selectNode(std::size_t k) const {
+        const AVLNode* node = root;
+        while (node) {
+            std::size_t leftSize = getSize(node->left);
+            if (k < leftSize) {
+                node = node->left;
+            } else if (k < leftSize + node->count) {
+                return node;
+            } else {
+                k -= leftSize + node->count;
+                node = node->right;
+            }
+        }
+        return nullptr;
+    }
 
-        x->height = std::max(getHeight(x->left), getHeight(x->right)) + 1;
-        y->height = std::max(getHeight(y->left), getHeight(y->right)) + 1;
+    void LinkedAVLTreeImpl::adoptStorage(LinkedAVLTreeImpl& other) {
+        finger = other.finger = nullptr;  // The fingers' bounds no longer hold for the combined values
+        hash += other.hash;  // The other tree's nodes are this tree's to free from now on
+        other.hash = 0;
+#ifdef AVL_USE_GLOBAL_HEAP
+        (void)other;  // Every node owns its own allocation
+#else
+        pool.adopt(other.pool);
+#endif
+    }
 
-        return y;
+    AVLNode* LinkedAVLTreeImpl::retraceDetached(AVLNode* node, AVLNode* top) {
+        // top stands in for the missing parent, so the rotations never rewrite root
+        while (node != top) {
+            refresh(node);
+            node = rebalance(node)->parent;
+        }
+        AVLNode* subtree = top->left ? top->left : top->right;
+        if (subtree) subtree->parent = nullptr;
+        return subtree;
     }
 
-    AVLNode* AVLTreeImpl::minValueNode(AVLNode* node) {
-        AVLNode* current = node;
-        while (current->left)
-            current = current->left;
-        return current;
+    AVLNode* LinkedAVLTreeImpl::joinNodes(AVLNode* left, AVLNode* mid, AVLNode* right) {
+        int leftHeight = height(left);
+        int rightHeight = height(right);
+        AVLNode top(0.0);
+        AVLNode* parent;
+        if (leftHeight > rightHeight + 1) {
+            // Hang mid on the right spine of left, at the first subtree no taller than right plus one
+            top.right = left;
+            left->parent = &top;
+            parent = left;
+            while (height(parent->right) > rightHeight + 1)
+                parent = parent->right;
+            mid->left = parent->right;
+            mid->right = right;
+            parent->right = mid;
+        } else if (rightHeight > leftHeight + 1) {
+            top.left = right;
+            right->parent = &top;
+            parent = right;
+            while (height(parent->left) > leftHeight + 1)
+                parent = parent->left;
+            mid->left = left;
+            mid->right = parent->left;
+            parent->left = mid;
+        } else {
+            parent = &top;
+            top.left = mid;
+            mid->left = left;
+            mid->right = right;
+        }
+        mid->parent = parent;
+        if (mid->left) mid->left->parent = mid;
+        if (mid->right) mid->right->parent = mid;
+        refresh(mid);
+        return retraceDetached(parent, &top);
     }
 
-    AVLNode* AVLTreeImpl::copyTree(const AVLNode* node) const {
-        if (!node) return nullptr;
-        AVLNode* newNode = new AVLNode(node->value);
-        newNode->left = copyTree(node->left);
-        newNode->right = copyTree(node->right);
-        newNode->height = node->height;
-        return newNode;
+    AVLNode* LinkedAVLTreeImpl::joinTwo(AVLNode* left, AVLNode* right) {
+        if (!left) return right;
+        if (!right) return left;
+        // Detach the smallest node of right; it becomes the middle of the join
+        AVLNode top(0.0);
+        top.left = right;
+        right->parent = &top;
+        AVLNode* mid = minNode(right);
+        AVLNode* parent = mid->parent;
+        replaceChild(parent, mid, mid->right);
+        right = retraceDetached(parent, &top);
+        return joinNodes(left, mid, right);
     }
 
-    bool AVLTreeImpl::compareTrees(const AVLNode* a, const AVLNode* b) const {
-        if (!a && !b) return true;
-        if (!a || !b) return false;
-        return (a->value == b->value) &&
-               compareTrees(a->left, b->left) &&
-               compareTrees(a->right, b->right);
+    void LinkedAVLTreeImpl::splitNodes(AVLNode* node, double key, AVLNode*& left, AVLNode*& found, AVLNode*& right) {
+        if (!node) {
+            left = found = right = nullptr;
+            return;
+        }
+        AVLNode* lower = node->left;
+        AVLNode* upper = node->right;
+        if (lower) lower->parent = nullptr;
+        if (upper) upper->parent = nullptr;
+        if (key == node->value) {
+            left = lower;
+            found = node;
+            right = upper;
+        } else if (key < node->value) {
+            splitNodes(lower, key, left, found, right);
+            right = joinNodes(right, node, upper);
+        } else {
+            splitNodes(upper, key, left, found, right);
+            left = joinNodes(lower, node, left);
+        }
     }
 
-    int AVLTreeImpl::countNodes(AVLNode* node) const {
-        if (!node) return 0;
-        return 1 + countNodes(node->left) + countNodes(node->right);
+    AVLNode* LinkedAVLTreeImpl::uniteNodes(AVLNode* node, const AVLNode* other, int forks) {
+        if (!other) return node;
+        if (!node) return copyTree(other);
+        AVLNode* left;
+        AVLNode* found;
+        AVLNode* right;
+        splitNodes(node, other->value, left, found, right);
+        if (!found) found = createNode(other->value, nullptr);
+        mergeChildren(&LinkedAVLTreeImpl::uniteNodes, left, right, other, forks, left, right);
+        return joinNodes(left, found, right);
     }
 
-    double AVLTreeImpl::sumValues(AVLNode* node) const {
-        if (!node) return 0;
-        return node->value + sumValues(node->left) + sumValues(node->right);
+    AVLNode* LinkedAVLTreeImpl::intersectNodes(AVLNode* node, const AVLNode* other, int forks) {
+        if (!node) return nullptr;
+        if (!other) {
+            freeMemory(node);
+            return nullptr;
+        }
+        AVLNode* left;
+        AVLNode* found;
+        AVLNode* right;
+        splitNodes(node, other->value, left, found, right);
+        mergeChildren(&LinkedAVLTreeImpl::intersectNodes, left, right, other, forks, left, right);
+        return found ? joinNodes(left, found, right) : joinTwo(left, right);
+    }
+
+    AVLNode* LinkedAVLTreeImpl::subtractNodes(AVLNode* node, const AVLNode* other, int forks) {
+        if (!node || !other) return node;
+        AVLNode* left;
+        AVLNode* found;
+        AVLNode* right;
+        splitNodes(node, other->value, left, found, right);
+        if (found) destroyNode(found);
+        mergeChildren(&LinkedAVLTreeImpl::subtractNodes, left, right, other, forks, left, right);
+        return joinTwo(left, right);
+    }
+
+    void LinkedAVLTreeImpl::mergeChildren(Merge merge, AVLNode* left, AVLNode* right, const AVLNode* other, int forks,
+                                          AVLNode*& mergedLeft, AVLNode*& mergedRight) {
+        if (forks > 0 && getSize(left) + getSize(right) + getSize(other) >= kParallelGrain) {
+            // The left halves are merged on another thread, with node storage that is adopted afterwards
+            LinkedAVLTreeImpl branch;
+            std::future<AVLNode*> pending;
+            try {
+                pending = std::async(std::launch::async, [&branch, merge, left, other, forks] {
+                    return (branch.*merge)(left, other->left, forks - 1);
+                });
+            } catch (const std::system_error&) {
+                forks = 0;  // No thread to spare; both halves are merged here
+            }
+            if (pending.valid()) {
+                mergedRight = (this->*merge)(right, other->right, forks - 1);
+                mergedLeft = pending.get();
+                adoptStorage(branch);
+                return;
+            }
+        }
+        mergedLeft = (this->*merge)(left, other->left, forks);
+        mergedRight = (this->*merge)(right, other->right, forks);
     }
 
 }  // namespace AVLProject
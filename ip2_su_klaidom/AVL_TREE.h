@@ -6,43 +6,284 @@
 #ifndef AVL_TREE_H
 #define AVL_TREE_H
 
+#include "AVL_OUTPUT.h"
+#include "AVL_STATS.h"
+
 #include <iostream>
 #include <string>
-#include <memory>  // For std::unique_ptr
+#include <memory>  // For std::shared_ptr
+#include <vector>
+#include <iterator>
+#include <initializer_list>
+#include <stdexcept>
+#include <cstddef>
+#include <utility>
+#include <optional>
 
 namespace AVLProject {
 
-    class AVLTreeImpl;  // Forward declaration of the implementation class
+    class AVLTreeImpl;  // Forward declaration of the implementation class, see AVL_TREE_IMPL.h
+    class FrozenAVLTree;  // Defined in FROZEN_AVL_TREE.h
+    class LookupFilter;  // Defined in LOOKUP_FILTER.h
+
+    /**
+     * @brief How a tree, or a bulk load, treats values that occur more than once.
+     */
+    enum class DuplicatePolicy {
+        Reject,  ///< Throw DuplicateValueException, like insert() does.
+        Ignore,  ///< Keep a single copy of every value.
+        Count    ///< Keep every copy, as a count on the value's node; Linked engine only.
+    };
+
+    /**
+     * @brief Which thread frees the nodes of a tree that is cleared, reassigned or destroyed.
+     */
+    enum class ReclaimMode {
+        Immediate,  ///< The calling thread frees them before returning.
+        Background  ///< A shared background thread frees them; the caller only detaches the root.
+    };
+
+    /**
+     * @brief Where insert() starts looking for the place of a new value.
+     */
+    enum class InsertMode {
+        Root,   ///< At the root, with a full descent.
+        Finger  ///< At the value inserted last, climbing only as far as needed; Linked engine only.
+    };
+
+    /**
+     * @brief How a tree lays out its nodes in memory.
+     */
+    enum class StorageEngine {
+        Linked,   ///< Pool-allocated nodes with child and parent pointers and cached subtree sums.
+        Compact,  ///< One contiguous array of 24-byte nodes linked by 32-bit indices, without parent links.
+        BPlus     ///< A B+-tree with cache-line-sized nodes and linked leaves; not an AVL tree inside.
+    };
+
+    /**
+     * @brief Where an iterator points; the meaning of the fields depends on the storage engine.
+     */
+    struct TreePosition {
+        const void* node = nullptr;  ///< Engine-specific node, nullptr for end().
+        std::size_t slot = 0;        ///< Engine-specific index of the value.
+
+        bool operator==(const TreePosition& other) const { return node == other.node && slot == other.slot; }
+        bool operator!=(const TreePosition& other) const { return !(*this == other); }
+    };
 
     /**
      * @brief Represents an AVL tree, a self-balancing binary search tree.
      * 
      * This class provides a public interface for interacting with the AVL tree,
      * while hiding implementation details using the PImpl idiom.
+     *
+     * Copies share the implementation until one of them is changed (copy-on-write),
+     * so passing a tree by value costs O(1). The first change to a shared tree copies
+     * its nodes in O(n). Copies may be read and changed on different threads.
+     *
+     * The storage engine is chosen at construction and kept by copies. Every engine
+     * offers the same operations with the same results; see StorageEngine.
      */
     class AVLTree {
     private:
-        std::unique_ptr<AVLTreeImpl> pImpl;  ///< Pointer to the implementation class.
+        std::shared_ptr<AVLTreeImpl> pImpl;  ///< Pointer to the implementation, shared between copies.
+        ReclaimMode reclaimMode = ReclaimMode::Immediate;  ///< How released nodes are freed.
+        InsertMode insertMode = InsertMode::Root;          ///< Where insert() starts searching.
+        DuplicatePolicy duplicatePolicy = DuplicatePolicy::Reject;  ///< What insert() does with a stored value.
+        std::shared_ptr<LookupFilter> filter;  ///< Rules out absent values for search(); nullptr when off, shared like pImpl.
+
+        /**
+         * @brief Gives the tree its own implementation if a copy still shares it.
+         */
+        void detach();
+
+        /**
+         * @brief Empties the tree, freeing the nodes as the reclaim mode says.
+         */
+        void reset();
+
+        /**
+         * @brief Replaces the contents with @p values, building a perfectly balanced tree.
+         * @param values The values to load; sorted in place if they are not sorted yet.
+         * @param duplicates What to do with repeated values.
+         */
+        void assignValues(std::vector<double>& values, DuplicatePolicy duplicates);
+
+        /**
+         * @brief Replaces the contents with values that are already strictly increasing.
+         * @param values The first of @p count values.
+         * @param count Number of values.
+         */
+        void assignSorted(const double* values, std::size_t count);
+
+        /**
+         * @brief Replaces the lookup filter with one built from the stored values.
+         * @param incoming Values about to be added, which the new filter leaves room for.
+         */
+        void rebuildFilter(std::size_t incoming = 0);
+
+        /**
+         * @brief Gives the tree its own lookup filter with room for @p incoming more values.
+         */
+        void widenFilter(std::size_t incoming);
+
+        /**
+         * @brief Rebuilds the lookup filter once it holds far more values than the tree.
+         */
+        void trimFilter();
+
+        /**
+         * @brief Checks whether this tree or @p other counts duplicates, which rules out the node-level set operations.
+         */
+        bool countsDuplicates(const AVLTree& other) const;
 
     public:
+        /**
+         * @brief Bidirectional iterator over the values of an AVL tree in ascending order.
+         *
+         * Iterators never allocate, and values cannot be modified through them. With the
+         * Linked engine they walk the parent links and, like std::set iterators, stay valid
+         * until the value they point to is removed or the tree is cleared or reassigned.
+         * The Compact engine has no parent links, so each step searches again from the
+         * root in O(log n). The BPlus engine steps through its linked leaves in O(1).
+         * With either of them, any insert or removal invalidates iterators.
+         * The first change to a tree that shares its nodes with a copy also invalidates them.
+         * In a tree that counts duplicates, a value stored n times is visited n times.
+         */
+        class const_iterator {
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = double;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const double*;
+            using reference = const double&;
+
+            /**
+             * @brief Constructs a singular iterator that does not belong to any tree.
+             */
+            const_iterator() = default;
+
+            /**
+             * @brief Accesses the value the iterator points to.
+             * @return Reference to the stored value.
+             */
+            reference operator*() const;
+
+            /**
+             * @brief Accesses the value the iterator points to.
+             * @return Pointer to the stored value.
+             */
+            pointer operator->() const;
+
+            /**
+             * @brief Advances to the next larger value.
+             * @return Reference to this iterator.
+             */
+            const_iterator& operator++();
+
+            /**
+             * @brief Advances to the next larger value.
+             * @return Copy of the iterator before it was advanced.
+             */
+            const_iterator operator++(int);
+
+            /**
+             * @brief Moves back to the next smaller value; end() moves to the largest value.
+             * @return Reference to this iterator.
+             */
+            const_iterator& operator--();
+
+            /**
+             * @brief Moves back to the next smaller value; end() moves to the largest value.
+             * @return Copy of the iterator before it was moved.
+             */
+            const_iterator operator--(int);
+
+            /**
+             * @brief Checks whether two iterators point to the same position.
+             * @param other The iterator to compare with.
+             * @return True if both iterators point to the same position, false otherwise.
+             */
+            bool operator==(const const_iterator& other) const { return position == other.position; }
+
+            /**
+             * @brief Checks whether two iterators point to different positions.
+             * @param other The iterator to compare with.
+             * @return True if the iterators point to different positions, false otherwise.
+             */
+            bool operator!=(const const_iterator& other) const { return position != other.position; }
+
+        private:
+            friend class AVLTree;
+
+            const_iterator(TreePosition position, const AVLTreeImpl* tree) : position(position), tree(tree) {}
+
+            TreePosition position;              ///< Current value, or end().
+            const AVLTreeImpl* tree = nullptr;  ///< Owning tree, which knows how to step.
+        };
+
+        using iterator = const_iterator;  ///< Values are keys, so they are never mutable.
+        using reverse_iterator = std::reverse_iterator<const_iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
         /**
          * @brief Constructs an empty AVL tree.
          */
         AVLTree();
 
+        /**
+         * @brief Constructs an empty AVL tree that stores its nodes with the given engine.
+         *
+         * With DuplicatePolicy::Count the tree is a multiset: a node holds a value and the
+         * number of its copies, so inserting a stored value only increments that number,
+         * without an allocation or a rotation, and remove() decrements it. Sizes, ranks,
+         * sums, iteration and output all count every copy. DuplicatePolicy::Ignore makes
+         * insert() skip stored values instead of throwing.
+         * @param engine StorageEngine::Compact to roughly halve the memory per value.
+         * @param duplicates What insert() does with a value that is already stored.
+         * @throws std::invalid_argument If @p duplicates is Count and @p engine is not Linked.
+         */
+        explicit AVLTree(StorageEngine engine, DuplicatePolicy duplicates = DuplicatePolicy::Reject);
+
+        /**
+         * @brief Constructs an AVL tree holding the values of a range.
+         *
+         * The values are sorted if needed and the tree is built bottom-up in linear time.
+         * DuplicatePolicy::Count also makes the tree count duplicates from then on.
+         * @param first Iterator to the first value.
+         * @param last Iterator past the last value.
+         * @param duplicates What to do with repeated values.
+         * @param engine How to store the nodes.
+         * @throws DuplicateValueException If a value repeats and @p duplicates is Reject.
+         * @throws std::invalid_argument If @p duplicates is Count and @p engine is not Linked.
+         */
+        template <typename InputIt>
+        AVLTree(InputIt first, InputIt last, DuplicatePolicy duplicates = DuplicatePolicy::Reject,
+                StorageEngine engine = StorageEngine::Linked)
+            : AVLTree(engine, duplicates == DuplicatePolicy::Count ? duplicates : DuplicatePolicy::Reject) {
+            assign(first, last, duplicates);
+        }
+
+        /**
+         * @brief Constructs an AVL tree holding the given values.
+         * @param values The values to load.
+         * @throws DuplicateValueException If a value repeats.
+         */
+        AVLTree(std::initializer_list<double> values) : AVLTree(values.begin(), values.end()) {}
+
         /**
          * @brief Destroys the AVL tree and frees all associated memory.
          */
         ~AVLTree();
 
         /**
-         * @brief Constructs a deep copy of another AVL tree.
+         * @brief Constructs a copy of another AVL tree in O(1), sharing its nodes until either changes.
          * @param other The AVL tree to copy.
          */
         AVLTree(const AVLTree& other);
 
         /**
-         * @brief Copy assignment operator to copy another AVL tree.
+         * @brief Copy assignment operator; shares the other tree's nodes until either changes.
          * @param other The AVL tree to copy.
          * @return Reference to the current AVL tree.
          */
@@ -61,14 +302,88 @@ namespace AVLProject {
          */
         AVLTree& operator=(AVLTree&& other) noexcept;
 
+        /**
+         * @brief Replaces the contents of the tree with the values of a range.
+         *
+         * Runs in O(n) for sorted input and O(n log n) otherwise. The tree is left
+         * unchanged if an exception is thrown. A tree that counts duplicates keeps
+         * every copy, whatever @p duplicates says.
+         * @param first Iterator to the first value.
+         * @param last Iterator past the last value.
+         * @param duplicates What to do with repeated values.
+         * @throws DuplicateValueException If a value repeats and @p duplicates is Reject.
+         * @throws std::invalid_argument If @p duplicates is Count and the tree does not count duplicates.
+         */
+        template <typename InputIt>
+        void assign(InputIt first, InputIt last, DuplicatePolicy duplicates = DuplicatePolicy::Reject) {
+            std::vector<double> values(first, last);
+            assignValues(values, duplicates);
+        }
+
+        /**
+         * @brief Replaces the contents of the tree with the values of a range.
+         * @param range Any container or range of values convertible to double.
+         * @param duplicates What to do with repeated values.
+         * @throws DuplicateValueException If a value repeats and @p duplicates is Reject.
+         */
+        template <typename Range>
+        void assign(const Range& range, DuplicatePolicy duplicates = DuplicatePolicy::Reject) {
+            using std::begin;
+            using std::end;
+            assign(begin(range), end(range), duplicates);
+        }
+
         /**
          * @brief Inserts a value into the AVL tree.
          * @param val The value to insert.
          */
         void insert(const double& val);
 
+        /**
+         * @brief Inserts a value, starting the search at a position close to it.
+         *
+         * With the Linked engine the search climbs from @p hint only until an ancestor
+         * bounds the value, then descends from there. Passing the iterator returned by
+         * the previous call makes sorted and clustered input cheap: appending after the
+         * largest value takes a single comparison. The subtree counts and sums above
+         * the new node are still updated, which walks the parent links to the root.
+         * end() starts from the value inserted last. The other engines ignore the hint.
+         * @param hint An iterator of this tree, or end().
+         * @param val The value to insert.
+         * @return An iterator to the inserted value.
+         * @throws DuplicateValueException If the value is already stored.
+         */
+        const_iterator insert(const_iterator hint, double val);
+
+        /**
+         * @brief Chooses where insert(val) starts searching.
+         *
+         * InsertMode::Finger makes every insert behave like insert(end(), val), which
+         * suits streams of ascending, descending or clustered values. Copies start
+         * with the mode of the tree they copy; assignment keeps the mode of the tree
+         * assigned to.
+         * @param mode The insert mode.
+         */
+        void set_insert_mode(InsertMode mode) { insertMode = mode; }
+
+        /**
+         * @brief Returns where insert(val) starts searching.
+         * @return The insert mode.
+         */
+        InsertMode insert_mode() const { return insertMode; }
+
+        /**
+         * @brief Returns what insert() does with a value that is already stored.
+         *
+         * Chosen at construction; copies and assignment carry it along with the values.
+         * @return The duplicate policy of the tree.
+         */
+        DuplicatePolicy duplicate_policy() const { return duplicatePolicy; }
+
         /**
          * @brief Removes a value from the AVL tree.
+         *
+         * In a tree that counts duplicates this removes one copy.
          * @param val The value to remove.
          */
         void remove(double val);
@@ -80,6 +395,347 @@ namespace AVLProject {
          */
         bool search(double val) const;
 
+        /**
+         * @brief Searches for many values at once, interleaving their descents.
+         *
+         * Sixteen searches are in flight at a time, and each prefetches the next node it
+         * needs while the others take their steps. The cache misses of different keys
+         * therefore overlap, instead of one search stalling on every level. The Linked
+         * and Compact engines interleave; the BPlus engine searches one key after another.
+         * @param keys The values to search for.
+         * @param keyCount Number of values.
+         * @param results Receives, for each key, whether it is stored.
+         */
+        void search_many(const double* keys, std::size_t keyCount, bool* results) const;
+
+        /**
+         * @brief Turns the lookup filter in front of search() and operator[] on or off.
+         *
+         * The filter is a blocked Bloom filter of two to four bytes per value. It answers
+         * most searches for absent values with one cache-line read, without walking the
+         * tree, and never rejects a stored value. It is rebuilt in O(n) whenever the tree
+         * has doubled or halved since the last build, so updates stay O(log n) amortized.
+         * Copies and assignment take the setting of the tree they copy; stats() reports
+         * the filter's size and false-positive rate.
+         * @param enabled True to build the filter in O(n), false to drop it.
+         */
+        void set_lookup_filter(bool enabled);
+
+        /**
+         * @brief Checks whether search() consults a lookup filter first.
+         * @return True if the lookup filter is on.
+         */
+        bool lookup_filter() const { return filter != nullptr; }
+
+        /**
+         * @brief Returns how the tree stores its nodes.
+         * @return The storage engine chosen at construction.
+         */
+        StorageEngine storage_engine() const;
+
+        // Order statistics
+
+        /**
+         * @brief Returns the number of values in the AVL tree in O(1).
+         * @return The number of values.
+         */
+        std::size_t size() const;
+
+        /**
+         * @brief Checks whether the AVL tree holds no values.
+         * @return True if the tree is empty, false otherwise.
+         */
+        bool empty() const;
+
+        /**
+         * @brief Counts the values that are smaller than a given value in O(log n).
+         * @param val The value to rank.
+         * @return The number of stored values less than @p val.
+         */
+        std::size_t rank(double val) const;
+
+        /**
+         * @brief Returns the k-th smallest value in O(log n).
+         * @param k Zero-based position in sorted order.
+         * @return The value at position @p k.
+         * @throws std::out_of_range If @p k is not less than size().
+         */
+        double select(std::size_t k) const;
+
+        /**
+         * @brief Returns the median of the stored values in O(log n).
+         *
+         * For an even number of values this is the mean of the two middle values.
+         * @return The median value.
+         * @throws std::out_of_range If the tree is empty.
+         */
+        double median() const;
+
+        // Snapshots
+
+        /**
+         * @brief Writes the values to a binary snapshot file.
+         *
+         * The file holds a versioned, checksummed header followed by the sorted values
+         * (see SnapshotHeader). It is written to a temporary file first and then renamed,
+         * so an existing snapshot is only replaced by a complete one.
+         * @param path The snapshot file.
+         * @throws SnapshotException If the file cannot be written, or if the tree repeats a value.
+         */
+        void save(const std::string& path) const;
+
+        /**
+         * @brief Loads a tree from a binary snapshot file.
+         *
+         * The file is memory-mapped and validated, then the tree is built bottom-up in
+         * linear time. Use MappedSnapshot instead to query the file without building a tree.
+         * @param path The snapshot file.
+         * @return The loaded tree.
+         * @throws SnapshotException If the file cannot be read or fails validation.
+         */
+        static AVLTree load(const std::string& path);
+
+        /**
+         * @brief Copies the values into an immutable, search-only array in O(n).
+         *
+         * Use it for trees that are built once and then searched heavily. Include
+         * FROZEN_AVL_TREE.h to use the result.
+         * @return The frozen copy; later changes to this tree do not affect it.
+         */
+        FrozenAVLTree freeze() const;
+
+        // Range aggregates
+
+        /**
+         * @brief Counts the copies of a value in O(log n).
+         * @param val The value to count.
+         * @return How often @p val is stored; at most 1 unless the tree counts duplicates.
+         */
+        std::size_t count(double val) const;
+
+        /**
+         * @brief Counts the values in the closed range [lo, hi] in O(log n).
+         * @param lo Lower bound of the range.
+         * @param hi Upper bound of the range.
+         * @return The number of stored values v with lo <= v <= hi.
+         */
+        std::size_t range_count(double lo, double hi) const;
+
+        /**
+         * @brief Sums the values in the closed range [lo, hi].
+         *
+         * Runs in O(log n) with the Linked engine, whose nodes cache subtree sums.
+         * The BPlus engine caches sums per child and also runs in O(log n). The Compact
+         * engine adds up the k values in the range in O(log n + k).
+         * @param lo Lower bound of the range.
+         * @param hi Upper bound of the range.
+         * @return The sum of the stored values v with lo <= v <= hi, or 0 if there are none.
+         */
+        double range_sum(double lo, double hi) const;
+
+        /**
+         * @brief Finds the smallest and largest values in the closed range [lo, hi] in O(log n).
+         * @param lo Lower bound of the range.
+         * @param hi Upper bound of the range.
+         * @return The minimum and maximum, or std::nullopt if the range holds no values.
+         */
+        std::optional<std::pair<double, double>> range_minmax(double lo, double hi) const;
+
+        // Statistics
+
+        /**
+         * @brief Describes the shape of the tree and the memory it holds, in O(n).
+         * @return Node count, height, memory footprint and the number of nodes at every depth.
+         */
+        TreeStats stats() const;
+
+        /**
+         * @brief Returns what all trees of the process have done since the last reset.
+         *
+         * The counters are kept per thread and summed here. They are only counted in
+         * builds with AVL_ENABLE_STATS (`make STATS=1`); otherwise they are all zero.
+         * @return Comparisons, rotations, allocations, frees and retrace lengths.
+         */
+        static OperationCounters operation_counters();
+
+        /**
+         * @brief Starts operation_counters() from zero again.
+         */
+        static void reset_operation_counters();
+
+        // Reclamation
+
+        /**
+         * @brief Empties the tree in O(1) and frees the nodes on a background thread.
+         *
+         * The background thread is shared by all trees and started on first use. If the
+         * queued nodes would exceed the limit set with set_reclamation_limit(), they are
+         * freed on the calling thread instead.
+         */
+        void clear_async();
+
+        /**
+         * @brief Chooses how operator!, assignment and the destructor free the nodes.
+         *
+         * Copies start with the mode of the tree they copy. Assignment keeps the mode
+         * of the tree assigned to.
+         * @param mode ReclaimMode::Background to hand the nodes to the background thread.
+         */
+        void set_reclaim_mode(ReclaimMode mode) { reclaimMode = mode; }
+
+        /**
+         * @brief Returns how the tree frees released nodes.
+         * @return The reclaim mode.
+         */
+        ReclaimMode reclaim_mode() const { return reclaimMode; }
+
+        /**
+         * @brief Blocks until the background thread has freed every tree queued so far.
+         */
+        static void wait_for_reclamation();
+
+        /**
+         * @brief Returns the node memory queued for background reclamation.
+         * @return The number of bytes not freed yet.
+         */
+        static std::size_t pending_reclamation_bytes();
+
+        /**
+         * @brief Bounds the node memory that may wait for background reclamation.
+         *
+         * A tree that would push the queue past the bound is freed by the thread that
+         * releases it, as in ReclaimMode::Immediate.
+         * @param bytes The bound; the default is unlimited.
+         */
+        static void set_reclamation_limit(std::size_t bytes);
+
+        // Joining, splitting and set operations
+
+        /**
+         * @brief Moves every value of another tree into this one in O(log n + log m).
+         *
+         * The two trees must not interleave: all values of @p other have to be greater
+         * than all values of this tree, or all of them smaller. The nodes change owner
+         * without being copied. Unless both trees use the Linked engine, the values are
+         * copied into a rebuilt tree in O(n + m) instead.
+         * @param other The tree to take the values from; it is left empty.
+         * @throws std::invalid_argument If the value ranges of the trees overlap.
+         */
+        void join(AVLTree& other);
+
+        /**
+         * @brief Moves the values that are not less than a key into a new tree.
+         *
+         * The tree is cut along one search path in O(log n). The smaller of the two
+         * parts is then copied into fresh storage, so the total cost is
+         * O(log n + min(k, n - k)) for k moved values. The other engines rebuild both
+         * parts in O(n) instead. Invalidates every iterator.
+         * @param key The smallest value that moves.
+         * @return A tree holding the values >= @p key; this tree keeps the values < @p key.
+         */
+        AVLTree split(double key);
+
+        /**
+         * @brief Adds every value of another tree that is not stored yet.
+         *
+         * Uses the join-based algorithm of Blelloch, Ferizovic and Sun. This tree is
+         * split by the root value of @p other, and both halves are merged with the
+         * matching subtrees, recursively. The work is O(m log(n/m + 1)), where m is the
+         * size of the smaller tree. Large enough halves are merged on separate threads.
+         * If memory runs out part way through, the tree is left empty. Unless both trees
+         * use the Linked engine, the sorted values are merged and rebuilt in O(n + m).
+         * @param other The tree to add; it is not modified.
+         * @param threads Upper bound on the threads to use; 0 uses one per hardware thread.
+         * @return Reference to the current AVL tree.
+         */
+        AVLTree& set_union(const AVLTree& other, unsigned threads = 0);
+
+        /**
+         * @brief Keeps only the values that another tree also stores.
+         *
+         * Join-based like set_union(), with the same bounds. Nodes are never allocated.
+         * @param other The tree to intersect with; it is not modified.
+         * @param threads Upper bound on the threads to use; 0 uses one per hardware thread.
+         * @return Reference to the current AVL tree.
+         */
+        AVLTree& set_intersection(const AVLTree& other, unsigned threads = 0);
+
+        /**
+         * @brief Removes every value that another tree stores.
+         *
+         * Join-based like set_union(), with the same bounds. Nodes are never allocated.
+         * @param other The tree whose values are removed; it is not modified.
+         * @param threads Upper bound on the threads to use; 0 uses one per hardware thread.
+         * @return Reference to the current AVL tree.
+         */
+        AVLTree& set_difference(const AVLTree& other, unsigned threads = 0);
+
+        // Iteration and ordered lookup
+
+        /**
+         * @brief Returns an iterator to the smallest value.
+         * @return Iterator to the first value, or end() if the tree is empty.
+         */
+        const_iterator begin() const;
+
+        /**
+         * @brief Returns an iterator past the largest value.
+         * @return The end iterator.
+         */
+        const_iterator end() const;
+
+        /**
+         * @brief Returns an iterator to the smallest value.
+         * @return Iterator to the first value, or cend() if the tree is empty.
+         */
+        const_iterator cbegin() const { return begin(); }
+
+        /**
+         * @brief Returns an iterator past the largest value.
+         * @return The end iterator.
+         */
+        const_iterator cend() const { return end(); }
+
+        /**
+         * @brief Returns a reverse iterator to the largest value.
+         * @return Reverse iterator to the last value, or rend() if the tree is empty.
+         */
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+
+        /**
+         * @brief Returns a reverse iterator past the smallest value.
+         * @return The reverse end iterator.
+         */
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        /**
+         * @brief Finds a value in O(log n).
+         * @param val The value to search for.
+         * @return Iterator to the value, or end() if it is not stored.
+         */
+        const_iterator find(double val) const;
+
+        /**
+         * @brief Finds the first value that is not less than a given value in O(log n).
+         * @param val The bound.
+         * @return Iterator to the first value >= @p val, or end() if there is none.
+         */
+        const_iterator lower_bound(double val) const;
+
+        /**
+         * @brief Finds the first value that is greater than a given value in O(log n).
+         * @param val The bound.
+         * @return Iterator to the first value > @p val, or end() if there is none.
+         */
+        const_iterator upper_bound(double val) const;
+
+        /**
+         * @brief Returns the range of stored values equal to a given value.
+         * @param val The value to search for.
+         * @return Pair of lower_bound(val) and upper_bound(val).
+         */
+        std::pair<const_iterator, const_iterator> equal_range(double val) const;
+
         /**
          * @brief Prints the in-order traversal of the AVL tree to the console.
          */
@@ -91,6 +747,23 @@ namespace AVLProject {
          */
         std::string toString() const;
 
+        /**
+         * @brief Returns the in-order traversal formatted with custom options.
+         * @param options Separator, precision and notation to use.
+         * @return A string containing the in-order traversal.
+         */
+        std::string toString(const FormatOptions& options) const;
+
+        /**
+         * @brief Streams the in-order traversal to a sink in large chunks.
+         *
+         * Values are formatted with std::to_chars into a fixed buffer, without locale
+         * lookups or per-value allocation.
+         * @param sink The destination, e.g. a StringSink, OStreamSink or FileDescriptorSink.
+         * @param options Separator, precision and notation to use.
+         */
+        void write(OutputSink& sink, const FormatOptions& options = FormatOptions()) const;
+
         // Arithmetic operators
 
         /**
@@ -107,10 +780,55 @@ namespace AVLProject {
          */
         AVLTree& operator-=(const double& val);
 
+        /**
+         * @brief Adds the values of another tree, like set_union().
+         * @param other The tree to add.
+         * @return Reference to the current AVL tree.
+         */
+        AVLTree& operator+=(const AVLTree& other);
+
+        /**
+         * @brief Keeps only the values another tree also stores, like set_intersection().
+         * @param other The tree to intersect with.
+         * @return Reference to the current AVL tree.
+         */
+        AVLTree& operator&=(const AVLTree& other);
+
+        /**
+         * @brief Removes the values of another tree, like set_difference().
+         * @param other The tree whose values are removed.
+         * @return Reference to the current AVL tree.
+         */
+        AVLTree& operator-=(const AVLTree& other);
+
+        /**
+         * @brief Returns the union of two trees.
+         * @param other The second tree.
+         * @return A new tree holding the values of both trees.
+         */
+        AVLTree operator+(const AVLTree& other) const;
+
+        /**
+         * @brief Returns the intersection of two trees.
+         * @param other The second tree.
+         * @return A new tree holding the values stored in both trees.
+         */
+        AVLTree operator&(const AVLTree& other) const;
+
+        /**
+         * @brief Returns the values of this tree that another tree does not store.
+         * @param other The tree whose values are left out.
+         * @return A new tree holding the difference.
+         */
+        AVLTree operator-(const AVLTree& other) const;
+
         // Unary operators
 
         /**
          * @brief Deletes the root node of the AVL tree using the -- operator.
+         *
+         * A B+-tree keeps no value at its root; the BPlus engine removes the smallest
+         * value of the root's second subtree, or the middle value of a lone root leaf.
          * @return Reference to the current AVL tree.
          */
         AVLTree& operator--();
@@ -124,6 +842,12 @@ namespace AVLProject {
 
         /**
          * @brief Compares two AVL trees for equality.
+         *
+         * Trees are equal if they hold the same values, whatever their engines and
+         * shapes and the order the values were inserted in. Every tree keeps its size
+         * and an order-independent hash of its values up to date on each write, so
+         * trees that differ in either are rejected in O(1). Otherwise the values are
+         * compared in order, stopping at the first difference.
          * @param other The AVL tree to compare with.
          * @return True if the trees are equal, false otherwise.
          */
@@ -138,6 +862,9 @@ namespace AVLProject {
 
         /**
          * @brief Checks if the current AVL tree is greater than another AVL tree.
+         *
+         * Trees are ordered by the sum of their values, which every node caches for its
+         * subtree, so this and the other ordering operators run in O(1).
          * @param other The AVL tree to compare with.
          * @return True if the current tree is greater, false otherwise.
          */
@@ -177,6 +904,8 @@ namespace AVLProject {
 
         /**
          * @brief Outputs the in-order traversal of the AVL tree to a stream.
+         *
+         * The stream's precision and its fixed/scientific flags select the format.
          * @param os The output stream.
          * @param tree The AVL tree to output.
          * @return The output stream.
@@ -195,6 +924,11 @@ namespace AVLProject {
          */
         explicit DuplicateValueException(double value)
             : std::logic_error("Duplicate value detected: " + std::to_string(value)) {}
+
+        /**
+         * @brief Constructs a DuplicateValueException for a key that has no numeric form.
+         */
+        DuplicateValueException() : std::logic_error("Duplicate value detected") {}
     };
 
 }
@@ -0,0 +1,249 @@
+#ifndef AVL_TREE_IMPL_H
+#define AVL_TREE_IMPL_H
+
+#include "AVL_TREE.h"
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <stdexcept>
+
+namespace AVLProject {
+
+    /**
+     * @brief Storage engine behind an AVLTree; one subclass per StorageEngine.
+     *
+     * AVLTree handles sharing, copy-on-write and reclamation, and forwards every
+     * read and write to its implementation through this interface. Positions are
+     * opaque to AVLTree: each engine decides what TreePosition::node and slot mean,
+     * except that a null node always stands for end().
+     */
+    class AVLTreeImpl {
+    public:
+        static constexpr int kMaxHeight = 96;  ///< AVL height bound for any tree that fits in memory.
+
+        explicit AVLTreeImpl(StorageEngine engine) : kind(engine) {}
+        virtual ~AVLTreeImpl() = default;
+
+        /**
+         * @brief Creates an empty implementation of the given engine.
+         * @param engine The storage engine to use.
+         * @return The new, empty implementation.
+         */
+        static std::shared_ptr<AVLTreeImpl> create(StorageEngine engine);
+
+        /**
+         * @brief Returns which storage engine this is.
+         *
+         * Not virtual: AVLTree reads it on every search and insert to take the Linked
+         * engine's direct path.
+         */
+        StorageEngine engine() const { return kind; }
+
+        /** @brief Returns a deep copy that shares nothing with this implementation. */
+        virtual std::shared_ptr<AVLTreeImpl> clone() const = 0;
+
+        /** @brief Removes every value and releases the node storage. */
+        virtual void clear() = 0;
+
+        /**
+         * @brief Inserts a value.
+         * @throws DuplicateValueException If the value is already stored.
+         */
+        virtual void insertValue(double val) = 0;
+
+        /**
+         * @brief Inserts a value, searching from a position close to it.
+         *
+         * Engines that cannot search from a position ignore the hint, which is what
+         * this default does.
+         * @param hint A position of this tree, or end() to start from the last insertion.
+         * @param val The value to insert.
+         * @return The position of the inserted value.
+         * @throws DuplicateValueException If the value is already stored.
+         */
+        virtual TreePosition insertNear(TreePosition hint, double val) {
+            (void)hint;
+            insertValue(val);
+            return find(val);
+        }
+
+        /**
+         * @brief Inserts a value, or adds another copy of it if it is already stored.
+         *
+         * Only engines that keep a count per value support this; the default throws.
+         * @param val The value to insert.
+         * @return The position of the new copy, the last of its value.
+         * @throws std::invalid_argument If the engine cannot count copies.
+         */
+        virtual TreePosition insertCopy(double val) {
+            (void)val;
+            throw std::invalid_argument("AVLTree: this storage engine cannot count duplicate values");
+        }
+
+        /** @brief Removes a value; returns false if it was not stored. */
+        virtual bool eraseValue(double val) = 0;
+
+        /** @brief Removes the value stored at the root; does nothing if the tree is empty. */
+        virtual void eraseRoot() = 0;
+
+        /**
+         * @brief Replaces the contents of an empty tree with @p count strictly increasing values.
+         *
+         * Engines that count copies also accept runs of equal values.
+         */
+        virtual void assignSorted(const double* values, std::size_t count) = 0;
+
+        /** @brief Checks whether a value is stored. */
+        virtual bool contains(double val) const = 0;
+
+        /**
+         * @brief Checks many values at once; results[i] tells whether keys[i] is stored.
+         *
+         * The default checks them one after another.
+         */
+        virtual void containsMany(const double* keys, std::size_t count, bool* results) const {
+            for (std::size_t i = 0; i < count; ++i) results[i] = contains(keys[i]);
+        }
+
+        /** @brief Returns the number of stored values. */
+        virtual std::size_t count() const = 0;
+
+        /** @brief Returns the sum of all stored values. */
+        virtual double total() const = 0;
+
+        /** @brief Counts the stored values that are smaller than @p val. */
+        virtual std::size_t rankOf(double val) const = 0;
+
+        /** @brief Returns the k-th smallest value, or nullptr if @p k is not less than count(). */
+        virtual const double* selectValue(std::size_t k) const = 0;
+
+        /** @brief Counts the values in the closed range [lo, hi]. */
+        virtual std::size_t rangeCount(double lo, double hi) const = 0;
+
+        /** @brief Sums the values in the closed range [lo, hi]. */
+        virtual double rangeSum(double lo, double hi) const = 0;
+
+        /** @brief Returns the position of the smallest value, or end() if the tree is empty. */
+        virtual TreePosition first() const = 0;
+
+        /** @brief Returns the position of the largest value, or end() if the tree is empty. */
+        virtual TreePosition last() const = 0;
+
+        /** @brief Returns the position of @p val, or end() if it is not stored. */
+        virtual TreePosition find(double val) const = 0;
+
+        /** @brief Returns the position of the first value >= @p val, or end(). */
+        virtual TreePosition lowerBound(double val) const = 0;
+
+        /** @brief Returns the position of the first value > @p val, or end(). */
+        virtual TreePosition upperBound(double val) const = 0;
+
+        /** @brief Returns the position of the last value <= @p val, or end(). */
+        virtual TreePosition lastNotAbove(double val) const = 0;
+
+        /** @brief Moves a position to the next larger value, or to end() after the largest. */
+        virtual void next(TreePosition& position) const = 0;
+
+        /** @brief Moves a position to the next smaller value; end() moves to the largest value. */
+        virtual void prev(TreePosition& position) const = 0;
+
+        /** @brief Returns the value stored at a position other than end(). */
+        virtual const double& valueAt(const TreePosition& position) const = 0;
+
+        /** @brief Streams the values in ascending order. */
+        virtual void writeValues(OutputSink& sink, const FormatOptions& options) const = 0;
+
+        /**
+         * @brief Returns the sum, modulo 2^64, of valueHash() over every stored copy.
+         *
+         * The sum does not depend on the order of insertion or on the shape, and every
+         * write adjusts it by the values it adds or removes, so it is always current.
+         */
+        virtual std::uint64_t contentHash() const = 0;
+
+        /** @brief Describes the shape of the tree and the memory it holds. */
+        virtual TreeStats stats() const = 0;
+
+        /** @brief Returns the bytes held for the nodes, free slots included. */
+        virtual std::size_t memoryBytes() const = 0;
+
+    private:
+        StorageEngine kind;  ///< The engine the subclass implements.
+    };
+
+    /**
+     * @brief Mixes the bits of a value into a well-spread 64-bit hash.
+     *
+     * Used for the content hash of the engines and by the lookup filter.
+     * @param val The value to hash; -0.0 hashes like 0.0, since the two compare equal.
+     * @return The hash.
+     */
+    inline std::uint64_t valueHash(double val) {
+        if (val == 0) val = 0.0;
+        std::uint64_t x;
+        std::memcpy(&x, &val, sizeof x);
+        // splitmix64 finalizer: neighbouring doubles differ only in their low bits
+        x ^= x >> 30;
+        x *= 0xbf58476d1ce4e5b9ULL;
+        x ^= x >> 27;
+        x *= 0x94d049bb133111ebULL;
+        return x ^ (x >> 31);
+    }
+
+    /**
+     * @brief Asks the CPU to start loading a node that is about to be read.
+     */
+    inline void prefetchNode(const void* address) {
+#ifdef __GNUC__
+        __builtin_prefetch(address);
+#else
+        (void)address;
+#endif
+    }
+
+    /**
+     * @brief Runs many descents interleaved, so that their cache misses overlap.
+     *
+     * Up to kGroup searches are in flight at once. Each round moves every one of them
+     * down a level; @p step prefetches the node a search moves to, and by the time the
+     * round comes back to that search the node has usually arrived. A finished search
+     * hands its slot to the next key (asynchronous memory access chaining), so short
+     * and long descents do not hold each other up.
+     * @param start Where every descent begins; never empty.
+     * @param step Compares a key with the node at a cursor and moves the cursor to the
+     *             child; returns 1 if the key was found, -1 if it is absent and 0 otherwise.
+     */
+    template <typename Cursor, typename Step>
+    void searchInterleaved(Cursor start, const double* keys, std::size_t count, bool* results, Step step) {
+        constexpr std::size_t kGroup = 16;  ///< Enough misses in flight to cover memory latency.
+        struct Lookup {
+            Cursor at;
+            std::size_t index;
+        };
+        Lookup lookups[kGroup];
+        std::size_t active = 0;
+        std::size_t next = 0;
+        for (; active < kGroup && next < count; ++active, ++next) lookups[active] = {start, next};
+        while (active) {
+            for (std::size_t i = 0; i < active;) {
+                Lookup& lookup = lookups[i];
+                int outcome = step(lookup.at, keys[lookup.index]);
+                if (outcome == 0) {
+                    ++i;
+                    continue;
+                }
+                results[lookup.index] = outcome > 0;
+                if (next < count) {
+                    lookup = {start, next++};
+                    ++i;
+                } else {
+                    lookup = lookups[--active];  // The last slot moves in and is stepped next
+                }
+            }
+        }
+    }
+
+}
+#endif // AVL_TREE_IMPL_H
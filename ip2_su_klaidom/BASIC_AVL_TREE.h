@@ -0,0 +1,850 @@
+#ifndef BASIC_AVL_TREE_H
+#define BASIC_AVL_TREE_H
+
+#include "AVL_TREE.h"  // For DuplicateValueException and Counter
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <initializer_list>
+#include <iterator>
+#include <memory>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace AVLProject {
+
+    /**
+     * @brief The AVLCore hooks of a tree whose nodes carry nothing beyond the links and height.
+     */
+    struct PlainAVLHooks {
+        static constexpr bool kAugmented = false;  ///< No per-subtree data to keep up to date.
+
+        /** @brief Recomputes the data a node keeps about its subtree; nothing to do here. */
+        template <typename Node> static void update(Node*) {}
+
+        /** @brief Accounts for @p added in an ancestor that kept its shape; nothing to do here. */
+        template <typename Node> static void added(Node*, const Node*) {}
+
+        /** @brief Counts an operation event; not counted here. */
+        static void count(Counter, std::uint64_t = 1) {}
+    };
+
+    /**
+     * @brief The AVL algorithms on parent-linked nodes, shared by BasicAVLTree and AVLTree's Linked engine.
+     *
+     * Holds the root and the ordering; allocation stays with the owner, which passes
+     * its create and destroy functions to the operations that need them. A node type
+     * has the members value, left, right, parent and height. Nodes that keep more
+     * about their subtree than the height (counts, sums) say so through @p Hooks:
+     * update() recomputes that data from the children, added() lets an ancestor above
+     * the last rotation account for an inserted node without reading its children,
+     * and count() receives the operation events that AVLTree reports as counters.
+     *
+     * @tparam Node The node type.
+     * @tparam Compare Strict weak ordering on the node values.
+     * @tparam Hooks Subtree data and event counting; PlainAVLHooks for neither.
+     */
+    template <typename Node, typename Compare, typename Hooks = PlainAVLHooks>
+    class AVLCore {
+    public:
+        static constexpr int kMaxHeight = 96;  ///< AVL height bound for any tree that fits in memory.
+
+        Node* root = nullptr;  ///< Root node, nullptr when empty.
+        Compare compare;       ///< Value ordering.
+
+        AVLCore() = default;
+        explicit AVLCore(const Compare& compare) : compare(compare) {}
+
+        static int height(const Node* node) { return node ? node->height : 0; }
+
+        static int balanceFactor(const Node* node) {
+            return node ? height(node->left) - height(node->right) : 0;
+        }
+
+        /** @brief Recomputes a node's height and subtree data from its children. */
+        static void refresh(Node* node) {
+            node->height = 1 + std::max(height(node->left), height(node->right));
+            Hooks::update(node);
+        }
+
+        template <typename N> static N* minNode(N* node) {
+            while (node->left) node = node->left;
+            return node;
+        }
+
+        template <typename N> static N* maxNode(N* node) {
+            while (node->right) node = node->right;
+            return node;
+        }
+
+        template <typename N> static N* successor(N* node) {
+            if (node->right) return minNode(node->right);
+            while (node->parent && node == node->parent->right)
+                node = node->parent;
+            return node->parent;
+        }
+
+        template <typename N> static N* predecessor(N* node) {
+            if (node->left) return maxNode(node->left);
+            while (node->parent && node == node->parent->left)
+                node = node->parent;
+            return node->parent;
+        }
+
+        /**
+         * @brief Finds the node holding a value.
+         * @return The node, or nullptr if the value is not stored.
+         */
+        template <typename K>
+        Node* findNode(const K& val) const {
+            Node* node = root;
+            std::uint64_t compared = 0;
+            while (node) {
+                ++compared;
+                if (compare(val, node->value))
+                    node = node->left;
+                else if (compare(node->value, val))
+                    node = node->right;
+                else
+                    break;
+            }
+            Hooks::count(Counter::Comparisons, compared);
+            return node;
+        }
+
+        /**
+         * @brief Descends to where a value belongs.
+         *
+         * If the value is absent, @p parent and @p link receive the node and the empty
+         * child link a new leaf for it hangs from; attach() takes them as they are.
+         * @return The node holding the value, or nullptr if it is not stored.
+         */
+        template <typename K>
+        Node* findSlot(const K& val, Node*& parent, Node**& link) {
+            parent = nullptr;
+            link = &root;
+            std::uint64_t compared = 0;
+            while (*link) {
+                parent = *link;
+                ++compared;
+                if (compare(val, parent->value)) {
+                    link = &parent->left;
+                } else if (compare(parent->value, val)) {
+                    link = &parent->right;
+                } else {
+                    Hooks::count(Counter::Comparisons, compared);
+                    return parent;
+                }
+            }
+            Hooks::count(Counter::Comparisons, compared);
+            return nullptr;
+        }
+
+        /** @brief Hangs a new leaf, whose parent is already set, from a link found by findSlot(). */
+        void attach(Node* node, Node* parent, Node** link) {
+            *link = node;
+            retraceAfterInsert(parent, node);
+        }
+
+        /** @brief Returns the first node not ordered before @p val, or nullptr. */
+        template <typename K>
+        const Node* lowerBoundNode(const K& val) const {
+            const Node* bound = nullptr;
+            for (const Node* node = root; node;) {
+                if (compare(node->value, val)) {
+                    node = node->right;
+                } else {
+                    bound = node;
+                    node = node->left;
+                }
+            }
+            return bound;
+        }
+
+        /** @brief Returns the first node ordered after @p val, or nullptr. */
+        template <typename K>
+        const Node* upperBoundNode(const K& val) const {
+            const Node* bound = nullptr;
+            for (const Node* node = root; node;) {
+                if (compare(val, node->value)) {
+                    bound = node;
+                    node = node->left;
+                } else {
+                    node = node->right;
+                }
+            }
+            return bound;
+        }
+
+        /** @brief Returns the last node not ordered after @p val, or nullptr. */
+        template <typename K>
+        const Node* lastNotAboveNode(const K& val) const {
+            const Node* bound = nullptr;
+            for (const Node* node = root; node;) {
+                if (compare(val, node->value)) {
+                    node = node->left;
+                } else {
+                    bound = node;
+                    node = node->right;
+                }
+            }
+            return bound;
+        }
+
+        void replaceChild(Node* parent, Node* oldChild, Node* newChild) {
+            if (!parent)
+                root = newChild;
+            else if (parent->left == oldChild)
+                parent->left = newChild;
+            else
+                parent->right = newChild;
+            if (newChild) newChild->parent = parent;
+        }
+
+        Node* rotateRight(Node* y) {
+            Node* x = y->left;
+            Node* T2 = x->right;
+
+            replaceChild(y->parent, y, x);
+            x->right = y;
+            y->parent = x;
+            y->left = T2;
+            if (T2) T2->parent = y;
+
+            refresh(y);
+            refresh(x);
+
+            return x;
+        }
+
+        Node* rotateLeft(Node* x) {
+            Node* y = x->right;
+            Node* T2 = y->left;
+
+            replaceChild(x->parent, x, y);
+            y->left = x;
+            x->parent = y;
+            x->right = T2;
+            if (T2) T2->parent = x;
+
+            refresh(x);
+            refresh(y);
+
+            return y;
+        }
+
+        /** @brief Rotates a node whose children differ in height by two; returns the subtree's new root. */
+        Node* rebalance(Node* node) {
+            int balance = balanceFactor(node);
+            if (balance > 1) {
+                if (balanceFactor(node->left) < 0) {
+                    Hooks::count(Counter::DoubleRotations);
+                    rotateLeft(node->left);
+                } else {
+                    Hooks::count(Counter::RightRotations);
+                }
+                return rotateRight(node);
+            }
+            if (balance < -1) {
+                if (balanceFactor(node->right) > 0) {
+                    Hooks::count(Counter::DoubleRotations);
+                    rotateRight(node->right);
+                } else {
+                    Hooks::count(Counter::LeftRotations);
+                }
+                return rotateLeft(node);
+            }
+            return node;
+        }
+
+        /** @brief Restores the balance above a new leaf, @p added, that hangs below @p node. */
+        void retraceAfterInsert(Node* node, const Node* added) {
+            std::uint64_t steps = 0;
+            while (node) {
+                ++steps;
+                int oldHeight = node->height;
+                refresh(node);
+                int balance = balanceFactor(node);
+                if (balance > 1 || balance < -1) {
+                    node = rebalance(node);  // A rotation restores the height the subtree had before the insert
+                    break;
+                }
+                if (node->height == oldHeight) break;  // Ancestor heights cannot be affected any more
+                node = node->parent;
+            }
+            Hooks::count(Counter::InsertRetraceSteps, steps);
+            if constexpr (Hooks::kAugmented) {
+                // Every node above gained exactly the new leaf, so there is no need to read its children
+                for (node = node ? node->parent : nullptr; node; node = node->parent)
+                    Hooks::added(node, added);
+            }
+        }
+
+        /**
+         * @brief Takes a node out of the tree without freeing it.
+         * @return The node to pass to retraceAfterErase() once the node is gone.
+         */
+        Node* unlink(Node* node) {
+            Node* retraceFrom;
+            if (node->left && node->right) {
+                // Relink the in-order successor into the node's place, so no other node changes identity
+                Node* next = minNode(node->right);
+                if (next->parent != node) {
+                    retraceFrom = next->parent;
+                    retraceFrom->left = next->right;
+                    if (next->right) next->right->parent = retraceFrom;
+                    next->right = node->right;
+                    next->right->parent = next;
+                } else {
+                    retraceFrom = next;
+                }
+                next->left = node->left;
+                next->left->parent = next;
+                next->height = node->height;  // The retrace compares against the height of the spliced-out subtree
+                replaceChild(node->parent, node, next);
+            } else {
+                retraceFrom = node->parent;
+                replaceChild(node->parent, node, node->left ? node->left : node->right);
+            }
+            return retraceFrom;
+        }
+
+        /** @brief Restores the balance from the node unlink() returned up to the root. */
+        void retraceAfterErase(Node* node) {
+            std::uint64_t steps = 0;
+            while (node) {
+                ++steps;
+                int oldHeight = node->height;
+                refresh(node);
+                node = rebalance(node);
+                if (node->height == oldHeight) break;  // Ancestor heights cannot be affected any more
+                node = node->parent;
+            }
+            Hooks::count(Counter::EraseRetraceSteps, steps);
+            if constexpr (Hooks::kAugmented) {
+                // Heights are settled; only the subtree data above node still changes
+                for (node = node ? node->parent : nullptr; node; node = node->parent)
+                    Hooks::update(node);
+            }
+        }
+
+        /**
+         * @brief Frees a subtree without recursion.
+         * @param destroy Called on every node of the subtree, leaves first.
+         */
+        template <typename Destroy>
+        static void freeNodes(Node* node, Destroy&& destroy) {
+            // Post-order walk over the parent links, unhooking each leaf before it is freed
+            Node* stop = node ? node->parent : nullptr;
+            while (node != stop) {
+                if (node->left) {
+                    node = node->left;
+                } else if (node->right) {
+                    node = node->right;
+                } else {
+                    Node* parent = node->parent;
+                    if (parent != stop) {
+                        if (parent->left == node) parent->left = nullptr;
+                        else parent->right = nullptr;
+                    }
+                    destroy(node);
+                    node = parent;
+                }
+            }
+        }
+
+        /**
+         * @brief Copies a subtree, preserving its shape; all or nothing.
+         * @param create Called as create(source, parent); returns a copy of the source node
+         *               hanging from @p parent, with no children yet.
+         * @param destroy Frees the nodes copied so far if @p create throws.
+         */
+        template <typename Create, typename Destroy>
+        static Node* copyNodes(const Node* node, Create&& create, Destroy&& destroy) {
+            if (!node) return nullptr;
+
+            // Pre-order walk; right subtrees wait on a stack that never grows past the tree height
+            struct Pending {
+                const Node* source;
+                Node* parent;
+            };
+            Pending pending[kMaxHeight];
+            int top = 0;
+
+            Node* copy = nullptr;
+            const Node* source = node;
+            Node* parent = nullptr;
+            Node** link = &copy;
+            try {
+                while (true) {
+                    Node* target = create(*source, parent);
+                    *link = target;
+
+                    if (source->right)
+                        pending[top++] = {source->right, target};
+                    if (source->left) {
+                        source = source->left;
+                        parent = target;
+                        link = &target->left;
+                    } else if (top > 0) {
+                        --top;
+                        source = pending[top].source;
+                        parent = pending[top].parent;
+                        link = &parent->right;
+                    } else {
+                        break;
+                    }
+                }
+            } catch (...) {
+                // Every node copied so far is linked into copy, so nothing leaks when an allocation fails
+                freeNodes(copy, destroy);
+                throw;
+            }
+            return copy;
+        }
+
+        /**
+         * @brief Builds a perfectly balanced subtree over the positions [lo, hi) of a sorted sequence.
+         * @param create Called as create(index, parent); returns the node for that position,
+         *               hanging from @p parent, with no children yet.
+         * @param destroy Frees the nodes built so far if @p create throws.
+         */
+        template <typename Create, typename Destroy>
+        static Node* linkBalanced(std::size_t lo, std::size_t hi, Node* parent, Create&& create, Destroy&& destroy) {
+            if (lo >= hi) return nullptr;
+
+            // The middle value becomes the subtree root, so both halves differ in size by at most one
+            std::size_t mid = lo + (hi - lo) / 2;
+            Node* node = create(mid, parent);
+            try {
+                node->left = linkBalanced(lo, mid, node, create, destroy);
+                node->right = linkBalanced(mid + 1, hi, node, create, destroy);
+            } catch (...) {
+                freeNodes(node, destroy);  // The node and its finished left half; the failed call freed its own part
+                throw;
+            }
+            refresh(node);
+            return node;
+        }
+    };
+
+    /**
+     * @brief A node of BasicAVLTree.
+     */
+    template <typename Key>
+    struct BasicAVLNode {
+        Key value;             ///< The key stored in the node.
+        BasicAVLNode* left;    ///< Pointer to the left child.
+        BasicAVLNode* right;   ///< Pointer to the right child.
+        BasicAVLNode* parent;  ///< Pointer to the parent node.
+        int height;            ///< Height of the node in the tree.
+
+        template <typename... Args>
+        BasicAVLNode(BasicAVLNode* parent, Args&&... args)
+            : value(std::forward<Args>(args)...), left(nullptr), right(nullptr), parent(parent), height(1) {}
+    };
+
+    /**
+     * @brief Header-only AVL tree over any key type, comparator and allocator.
+     *
+     * Unlike AVLTree, which hides a double-only tree behind a PImpl pointer, every
+     * operation here is a template the compiler can inline at the call site, including
+     * the key comparisons. The interface mirrors AVLTree's core operations and operators.
+     * The balancing is AVLCore's, the same code AVLTree's Linked engine runs.
+     *
+     * @tparam Key Stored key type; keys are unique.
+     * @tparam Compare Strict weak ordering on keys.
+     * @tparam Allocator Allocator for Key, rebound internally to the node type.
+     */
+    template <typename Key, typename Compare = std::less<Key>, typename Allocator = std::allocator<Key>>
+    class BasicAVLTree : private AVLCore<BasicAVLNode<Key>, Compare> {
+    private:
+        using Node = BasicAVLNode<Key>;
+        using Core = AVLCore<Node, Compare>;
+        using NodeAllocator = typename std::allocator_traits<Allocator>::template rebind_alloc<Node>;
+        using NodeTraits = std::allocator_traits<NodeAllocator>;
+
+        using Core::root;
+        using Core::compare;
+
+        std::size_t count = 0;       ///< Number of keys.
+        NodeAllocator allocator;     ///< Node storage.
+
+    public:
+        using key_type = Key;
+        using value_type = Key;
+        using size_type = std::size_t;
+        using key_compare = Compare;
+        using allocator_type = Allocator;
+
+        /**
+         * @brief Bidirectional iterator over the keys in ascending order.
+         */
+        class const_iterator {
+        public:
+            using iterator_category = std::bidirectional_iterator_tag;
+            using value_type = Key;
+            using difference_type = std::ptrdiff_t;
+            using pointer = const Key*;
+            using reference = const Key&;
+
+            const_iterator() = default;
+
+            reference operator*() const { return node->value; }
+            pointer operator->() const { return &node->value; }
+
+            const_iterator& operator++() {
+                node = Core::successor(node);
+                return *this;
+            }
+
+            const_iterator operator++(int) {
+                const_iterator previous = *this;
+                ++*this;
+                return previous;
+            }
+
+            const_iterator& operator--() {
+                if (node)
+                    node = Core::predecessor(node);
+                else if (tree->root)
+                    node = Core::maxNode(static_cast<const Node*>(tree->root));
+                return *this;
+            }
+
+            const_iterator operator--(int) {
+                const_iterator previous = *this;
+                --*this;
+                return previous;
+            }
+
+            bool operator==(const const_iterator& other) const { return node == other.node; }
+            bool operator!=(const const_iterator& other) const { return node != other.node; }
+
+        private:
+            friend class BasicAVLTree;
+
+            const_iterator(const Node* node, const BasicAVLTree* tree) : node(node), tree(tree) {}
+
+            const Node* node = nullptr;          ///< Current node, nullptr for end().
+            const BasicAVLTree* tree = nullptr;  ///< Owning tree, needed to step back from end().
+        };
+
+        using iterator = const_iterator;
+        using reverse_iterator = std::reverse_iterator<const_iterator>;
+        using const_reverse_iterator = std::reverse_iterator<const_iterator>;
+
+        /**
+         * @brief Constructs an empty tree.
+         */
+        BasicAVLTree() = default;
+
+        /**
+         * @brief Constructs an empty tree with a given comparator and allocator.
+         * @param compare The key ordering.
+         * @param allocator The allocator.
+         */
+        explicit BasicAVLTree(const Compare& compare, const Allocator& allocator = Allocator())
+            : Core(compare), allocator(allocator) {}
+
+        /**
+         * @brief Constructs a perfectly balanced tree from a range in O(n) for sorted input.
+         * @param first Iterator to the first key.
+         * @param last Iterator past the last key.
+         * @throws DuplicateValueException If a key repeats.
+         */
+        template <typename InputIt>
+        BasicAVLTree(InputIt first, InputIt last) {
+            assign(first, last);
+        }
+
+        /**
+         * @brief Constructs a tree holding the given keys.
+         * @param keys The keys to load.
+         * @throws DuplicateValueException If a key repeats.
+         */
+        BasicAVLTree(std::initializer_list<Key> keys) : BasicAVLTree(keys.begin(), keys.end()) {}
+
+        /**
+         * @brief Constructs a deep copy of another tree, preserving its shape.
+         * @param other The tree to copy.
+         */
+        BasicAVLTree(const BasicAVLTree& other)
+            : Core(other.compare),
+              allocator(NodeTraits::select_on_container_copy_construction(other.allocator)) {
+            root = Core::copyNodes(other.root,
+                [this](const Node& source, Node* parent) {
+                    Node* node = createNode(source.value, parent);
+                    node->height = source.height;
+                    return node;
+                },
+                [this](Node* node) { destroyNode(node); });
+            count = other.count;
+        }
+
+        /**
+         * @brief Takes over the nodes of another tree.
+         * @param other The tree to move from; it is left empty.
+         */
+        BasicAVLTree(BasicAVLTree&& other) noexcept
+            : Core(std::move(other.compare)), count(other.count), allocator(std::move(other.allocator)) {
+            root = other.root;
+            other.root = nullptr;
+            other.count = 0;
+        }
+
+        /**
+         * @brief Destroys the tree and frees all nodes.
+         */
+        ~BasicAVLTree() { clear(); }
+
+        /**
+         * @brief Replaces the contents with a deep copy of another tree.
+         * @param other The tree to copy.
+         * @return Reference to this tree.
+         */
+        BasicAVLTree& operator=(const BasicAVLTree& other) {
+            if (this != &other) {
+                BasicAVLTree copy(other);
+                swap(copy);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Replaces the contents with the nodes of another tree.
+         * @param other The tree to move from; it is left empty.
+         * @return Reference to this tree.
+         */
+        BasicAVLTree& operator=(BasicAVLTree&& other) noexcept {
+            if (this != &other) {
+                clear();
+                swap(other);
+            }
+            return *this;
+        }
+
+        /**
+         * @brief Exchanges the contents of two trees.
+         * @param other The tree to swap with.
+         */
+        void swap(BasicAVLTree& other) noexcept {
+            std::swap(root, other.root);
+            std::swap(count, other.count);
+            std::swap(compare, other.compare);
+            std::swap(allocator, other.allocator);
+        }
+
+        /**
+         * @brief Replaces the contents with the keys of a range, building a balanced tree.
+         * @param first Iterator to the first key.
+         * @param last Iterator past the last key.
+         * @throws DuplicateValueException If a key repeats; the tree is then unchanged, as it
+         *         is when an allocation fails.
+         */
+        template <typename InputIt>
+        void assign(InputIt first, InputIt last) {
+            std::vector<Key> keys(first, last);
+            auto less = [this](const Key& a, const Key& b) { return compare(a, b); };
+            if (!std::is_sorted(keys.begin(), keys.end(), less))
+                std::sort(keys.begin(), keys.end(), less);
+            auto duplicate = std::adjacent_find(keys.begin(), keys.end(),
+                [this](const Key& a, const Key& b) { return !compare(a, b); });
+            if (duplicate != keys.end())
+                throwDuplicate(*duplicate);
+
+            // Built first, so that a failed allocation leaves the old contents in place
+            Node* built = Core::linkBalanced(0, keys.size(), nullptr,
+                [this, &keys](std::size_t index, Node* parent) { return createNode(keys[index], parent); },
+                [this](Node* node) { destroyNode(node); });
+            clear();
+            root = built;
+            count = keys.size();
+        }
+
+        /**
+         * @brief Inserts a key.
+         * @param val The key to insert.
+         * @throws DuplicateValueException If the key is already stored.
+         */
+        void insert(const Key& val) {
+            Node* parent;
+            Node** link;
+            if (Core::findSlot(val, parent, link))
+                throwDuplicate(val);
+            Core::attach(createNode(val, parent), parent, link);
+            ++count;
+        }
+
+        /**
+         * @brief Removes a key.
+         * @param val The key to remove.
+         * @return True if the key was stored, false otherwise.
+         */
+        bool remove(const Key& val) {
+            Node* node = Core::findNode(val);
+            if (!node) return false;
+            eraseNode(node);
+            return true;
+        }
+
+        /**
+         * @brief Searches for a key.
+         * @param val The key to search for.
+         * @return True if the key is found, false otherwise.
+         */
+        bool search(const Key& val) const { return Core::findNode(val) != nullptr; }
+
+        /**
+         * @brief Searches for a key; same as search().
+         * @param val The key to search for.
+         * @return True if the key is found, false otherwise.
+         */
+        bool contains(const Key& val) const { return Core::findNode(val) != nullptr; }
+
+        /**
+         * @brief Returns the number of keys.
+         * @return The number of keys.
+         */
+        std::size_t size() const { return count; }
+
+        /**
+         * @brief Checks whether the tree holds no keys.
+         * @return True if the tree is empty, false otherwise.
+         */
+        bool empty() const { return count == 0; }
+
+        /**
+         * @brief Returns the height of the tree.
+         * @return The number of levels, 0 for an empty tree.
+         */
+        int height() const { return Core::height(root); }
+
+        /**
+         * @brief Removes every key.
+         */
+        void clear() {
+            Core::freeNodes(root, [this](Node* node) { destroyNode(node); });
+            root = nullptr;
+            count = 0;
+        }
+
+        const_iterator begin() const { return const_iterator(root ? Core::minNode(static_cast<const Node*>(root)) : nullptr, this); }
+        const_iterator end() const { return const_iterator(nullptr, this); }
+        const_iterator cbegin() const { return begin(); }
+        const_iterator cend() const { return end(); }
+        const_reverse_iterator rbegin() const { return const_reverse_iterator(end()); }
+        const_reverse_iterator rend() const { return const_reverse_iterator(begin()); }
+
+        /**
+         * @brief Finds a key.
+         * @param val The key to search for.
+         * @return Iterator to the key, or end() if it is not stored.
+         */
+        const_iterator find(const Key& val) const { return const_iterator(Core::findNode(val), this); }
+
+        /**
+         * @brief Finds the first key that is not ordered before a given key.
+         * @param val The bound.
+         * @return Iterator to the first key >= @p val, or end() if there is none.
+         */
+        const_iterator lower_bound(const Key& val) const { return const_iterator(Core::lowerBoundNode(val), this); }
+
+        /**
+         * @brief Finds the first key that is ordered after a given key.
+         * @param val The bound.
+         * @return Iterator to the first key > @p val, or end() if there is none.
+         */
+        const_iterator upper_bound(const Key& val) const { return const_iterator(Core::upperBoundNode(val), this); }
+
+        // Operators, matching AVLTree
+
+        BasicAVLTree& operator+=(const Key& val) {
+            insert(val);
+            return *this;
+        }
+
+        BasicAVLTree& operator-=(const Key& val) {
+            remove(val);
+            return *this;
+        }
+
+        /**
+         * @brief Deletes the root node.
+         * @return Reference to this tree.
+         */
+        BasicAVLTree& operator--() {
+            if (root) eraseNode(root);
+            return *this;
+        }
+
+        /**
+         * @brief Frees all nodes.
+         */
+        void operator!() { clear(); }
+
+        bool operator[](const Key& val) const { return search(val); }
+
+        /**
+         * @brief Checks whether both trees hold the same keys, regardless of their shape.
+         * @param other The tree to compare with.
+         * @return True if the key sequences are equal, false otherwise.
+         */
+        bool operator==(const BasicAVLTree& other) const {
+            if (count != other.count) return false;
+            for (auto a = begin(), b = other.begin(); a != end(); ++a, ++b) {
+                if (compare(*a, *b) || compare(*b, *a)) return false;
+            }
+            return true;
+        }
+
+        bool operator!=(const BasicAVLTree& other) const { return !(*this == other); }
+
+        /**
+         * @brief Writes the keys in order, each followed by a space, like AVLTree does.
+         * @param os The output stream.
+         * @param tree The tree to output.
+         * @return The output stream.
+         */
+        friend std::ostream& operator<<(std::ostream& os, const BasicAVLTree& tree) {
+            for (const Key& val : tree) os << val << " ";
+            return os;
+        }
+
+    private:
+        template <typename Value>
+        [[noreturn]] static void throwDuplicate(const Value& val) {
+            if constexpr (std::is_arithmetic<Value>::value)
+                throw DuplicateValueException(static_cast<double>(val));
+            else
+                throw DuplicateValueException();
+        }
+
+        Node* createNode(const Key& val, Node* parent) {
+            Node* node = NodeTraits::allocate(allocator, 1);
+            try {
+                NodeTraits::construct(allocator, node, parent, val);
+            } catch (...) {
+                NodeTraits::deallocate(allocator, node, 1);
+                throw;
+            }
+            return node;
+        }
+
+        void destroyNode(Node* node) {
+            NodeTraits::destroy(allocator, node);
+            NodeTraits::deallocate(allocator, node, 1);
+        }
+
+        void eraseNode(Node* node) {
+            Node* retraceFrom = Core::unlink(node);
+            destroyNode(node);
+            --count;
+            Core::retraceAfterErase(retraceFrom);
+        }
+    };
+}
+#endif // BASIC_AVL_TREE_H
@@ -0,0 +1,659 @@
+#include "BPLUS_TREE.h"
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+namespace AVLProject {
+
+    static_assert(sizeof(BPlusLeaf) == 256, "leaves are meant to fill four cache lines");
+    static_assert(sizeof(BPlusInner) == 512, "inner nodes are meant to fill eight cache lines");
+
+    BPlusLeaf* BPlusTreeImpl::createLeaf() {
+        countEvent(Counter::Allocations);
+#ifdef AVL_USE_GLOBAL_HEAP
+        BPlusLeaf* leaf = new BPlusLeaf();
+#else
+        BPlusLeaf* leaf = leafPool.create();
+#endif
+        leaf->leaf = true;
+        ++leafCount;
+        return leaf;
+    }
+
+    BPlusInner* BPlusTreeImpl::createInner() {
+        countEvent(Counter::Allocations);
+#ifdef AVL_USE_GLOBAL_HEAP
+        BPlusInner* inner = new BPlusInner();
+#else
+        BPlusInner* inner = innerPool.create();
+#endif
+        ++innerCount;
+        return inner;
+    }
+
+    void BPlusTreeImpl::destroyNode(BPlusNode* node) {
+        countEvent(Counter::Frees);
+        if (node->leaf) {
+            --leafCount;
+#ifdef AVL_USE_GLOBAL_HEAP
+            delete static_cast<BPlusLeaf*>(node);
+#else
+            leafPool.destroy(static_cast<BPlusLeaf*>(node));
+#endif
+        } else {
+            --innerCount;
+#ifdef AVL_USE_GLOBAL_HEAP
+            delete static_cast<BPlusInner*>(node);
+#else
+            innerPool.destroy(static_cast<BPlusInner*>(node));
+#endif
+        }
+    }
+
+    void BPlusTreeImpl::freeNodes(BPlusNode* node) {
+        // Depth is the number of levels, a handful even for huge trees
+        if (!node) return;
+        if (!node->leaf) {
+            BPlusInner* inner = static_cast<BPlusInner*>(node);
+            for (int i = 0; i < inner->count; ++i)
+                freeNodes(inner->children[i]);
+        }
+        destroyNode(node);
+    }
+
+    void BPlusTreeImpl::clear() {
+#ifdef AVL_USE_GLOBAL_HEAP
+        freeNodes(root);
+#else
+        countEvent(Counter::Frees, leafCount + innerCount);
+        leafPool.releaseAll();
+        innerPool.releaseAll();
+        leafCount = innerCount = 0;
+#endif
+        root = nullptr;
+        valueCount = 0;
+        hash = 0;
+    }
+
+    int BPlusTreeImpl::route(const BPlusInner* node, double val) {
+        // The child whose key range holds val: one past the last separator <= val
+        return static_cast<int>(std::upper_bound(node->keys, node->keys + node->count - 1, val) - node->keys);
+    }
+
+    std::size_t BPlusTreeImpl::nodeSize(const BPlusNode* node) {
+        if (node->leaf) return node->count;
+        const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+        return std::accumulate(inner->sizes, inner->sizes + inner->count, std::size_t(0));
+    }
+
+    double BPlusTreeImpl::nodeSum(const BPlusNode* node) {
+        if (node->leaf) {
+            const BPlusLeaf* leaf = static_cast<const BPlusLeaf*>(node);
+            return std::accumulate(leaf->keys, leaf->keys + leaf->count, 0.0);
+        }
+        const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+        return std::accumulate(inner->sums, inner->sums + inner->count, 0.0);
+    }
+
+    void BPlusTreeImpl::refresh(BPlusInner* node, int child) {
+        // Sums are recomputed rather than adjusted, so rounding errors do not pile up
+        node->sizes[child] = nodeSize(node->children[child]);
+        node->sums[child] = nodeSum(node->children[child]);
+    }
+
+    void BPlusTreeImpl::removeChild(BPlusInner* node, int child) {
+        int count = node->count;
+        std::copy(node->children + child + 1, node->children + count, node->children + child);
+        std::copy(node->sizes + child + 1, node->sizes + count, node->sizes + child);
+        std::copy(node->sums + child + 1, node->sums + count, node->sums + child);
+        std::copy(node->keys + child, node->keys + count - 1, node->keys + child - 1);
+        --node->count;
+    }
+
+    std::shared_ptr<AVLTreeImpl> BPlusTreeImpl::clone() const {
+        auto copy = std::make_shared<BPlusTreeImpl>();
+        BPlusLeaf* previous = nullptr;
+        if (root) copy->copyNode(root, copy->root, previous);
+        copy->valueCount = valueCount;
+        copy->hash = hash;
+        return copy;
+    }
+
+    void BPlusTreeImpl::copyNode(const BPlusNode* source, BPlusNode*& target, BPlusLeaf*& previous) {
+        // The target is linked in before its children are copied, so a failed copy can still be freed
+        if (source->leaf) {
+            BPlusLeaf* leaf = createLeaf();
+            const BPlusLeaf* from = static_cast<const BPlusLeaf*>(source);
+            std::copy(from->keys, from->keys + from->count, leaf->keys);
+            leaf->count = from->count;
+            leaf->prev = previous;
+            if (previous) previous->next = leaf;
+            previous = leaf;
+            target = leaf;
+            return;
+        }
+        BPlusInner* inner = createInner();
+        const BPlusInner* from = static_cast<const BPlusInner*>(source);
+        std::copy(from->keys, from->keys + from->count - 1, inner->keys);
+        std::copy(from->sizes, from->sizes + from->count, inner->sizes);
+        std::copy(from->sums, from->sums + from->count, inner->sums);
+        inner->count = from->count;
+        target = inner;
+        for (int i = 0; i < from->count; ++i)
+            copyNode(from->children[i], inner->children[i], previous);
+    }
+
+    BPlusLeaf* BPlusTreeImpl::splitLeaf(BPlusLeaf* leaf, BPlusLeaf* right, int slot, double val) {
+        double merged[BPlusLeaf::kCapacity + 1];
+        std::copy(leaf->keys, leaf->keys + slot, merged);
+        merged[slot] = val;
+        std::copy(leaf->keys + slot, leaf->keys + leaf->count, merged + slot + 1);
+
+        const int total = leaf->count + 1;
+        const int leftCount = total / 2;
+        std::copy(merged, merged + leftCount, leaf->keys);
+        std::copy(merged + leftCount, merged + total, right->keys);
+        leaf->count = static_cast<std::uint16_t>(leftCount);
+        right->count = static_cast<std::uint16_t>(total - leftCount);
+
+        right->prev = leaf;
+        right->next = leaf->next;
+        if (right->next) right->next->prev = right;
+        leaf->next = right;
+        return right;
+    }
+
+    BPlusInner* BPlusTreeImpl::insertChild(BPlusInner* node, BPlusInner* spare, int slot, double& key, BPlusNode* child) {
+        // Adds child right after children[slot - 1], separated from it by key
+        if (node->count < BPlusInner::kCapacity) {
+            int count = node->count;
+            std::copy_backward(node->children + slot, node->children + count, node->children + count + 1);
+            std::copy_backward(node->sizes + slot, node->sizes + count, node->sizes + count + 1);
+            std::copy_backward(node->sums + slot, node->sums + count, node->sums + count + 1);
+            std::copy_backward(node->keys + slot - 1, node->keys + count - 1, node->keys + count);
+            node->children[slot] = child;
+            node->keys[slot - 1] = key;
+            ++node->count;
+            refresh(node, slot);
+            return nullptr;
+        }
+
+        // Full: lay out all children in order, then give the upper half to the spare node
+        constexpr int kTotal = BPlusInner::kCapacity + 1;
+        double keys[kTotal - 1];
+        BPlusNode* children[kTotal];
+        std::copy(node->keys, node->keys + slot - 1, keys);
+        keys[slot - 1] = key;
+        std::copy(node->keys + slot - 1, node->keys + kTotal - 2, keys + slot);
+        std::copy(node->children, node->children + slot, children);
+        children[slot] = child;
+        std::copy(node->children + slot, node->children + kTotal - 1, children + slot + 1);
+
+        const int leftCount = kTotal / 2;
+        std::copy(children, children + leftCount, node->children);
+        std::copy(keys, keys + leftCount - 1, node->keys);
+        std::copy(children + leftCount, children + kTotal, spare->children);
+        std::copy(keys + leftCount, keys + kTotal - 1, spare->keys);
+        node->count = static_cast<std::uint16_t>(leftCount);
+        spare->count = static_cast<std::uint16_t>(kTotal - leftCount);
+        for (int i = 0; i < node->count; ++i) refresh(node, i);
+        for (int i = 0; i < spare->count; ++i) refresh(spare, i);
+        key = keys[leftCount - 1];  // Moves up to the parent
+        return spare;
+    }
+
+    void BPlusTreeImpl::insertValue(double val) {
+        Step path[kMaxHeight];
+        int depth = 0;
+        BPlusNode* node = root;
+        while (node && !node->leaf) {
+            BPlusInner* inner = static_cast<BPlusInner*>(node);
+            int child = route(inner, val);
+            path[depth++] = {inner, child};
+            node = inner->children[child];
+        }
+        BPlusLeaf* leaf = static_cast<BPlusLeaf*>(node);
+        int slot = 0;
+        if (leaf) {
+            slot = static_cast<int>(std::lower_bound(leaf->keys, leaf->keys + leaf->count, val) - leaf->keys);
+            if (slot < leaf->count && leaf->keys[slot] == val)
+                throw DuplicateValueException(val);
+        }
+        countEvent(Counter::Comparisons, static_cast<std::uint64_t>(depth) + 1);
+        countEvent(Counter::Inserts);
+
+        // Allocate every node a split could need before anything changes, so a failure leaves the tree intact
+        BPlusLeaf* spareLeaf = nullptr;
+        BPlusInner* spares[kMaxHeight];
+        int spareCount = 0;
+        if (!leaf || leaf->count == BPlusLeaf::kCapacity) {
+            int needed = 0;
+            if (leaf) {
+                int d = depth - 1;
+                while (d >= 0 && path[d].node->count == BPlusInner::kCapacity) --d;
+                needed = depth - 1 - d + (d < 0);
+            }
+            try {
+                spareLeaf = createLeaf();
+                while (spareCount < needed) spares[spareCount++] = createInner();
+            } catch (...) {
+                if (spareLeaf) destroyNode(spareLeaf);
+                while (spareCount > 0) destroyNode(spares[--spareCount]);
+                throw;
+            }
+        }
+        ++valueCount;
+        hash += valueHash(val);
+
+        if (!leaf) {
+            spareLeaf->keys[0] = val;
+            spareLeaf->count = 1;
+            root = spareLeaf;
+            return;
+        }
+
+        BPlusNode* carry = nullptr;
+        double carryKey = 0;
+        if (leaf->count < BPlusLeaf::kCapacity) {
+            std::copy_backward(leaf->keys + slot, leaf->keys + leaf->count, leaf->keys + leaf->count + 1);
+            leaf->keys[slot] = val;
+            ++leaf->count;
+        } else {
+            carry = splitLeaf(leaf, spareLeaf, slot, val);
+            carryKey = static_cast<BPlusLeaf*>(carry)->keys[0];
+        }
+
+        countEvent(Counter::InsertRetraceSteps, static_cast<std::uint64_t>(depth));
+        for (int d = depth - 1; d >= 0; --d) {
+            BPlusInner* inner = path[d].node;
+            refresh(inner, path[d].child);
+            if (carry)
+                carry = insertChild(inner, inner->count == BPlusInner::kCapacity ? spares[--spareCount] : nullptr,
+                                    path[d].child + 1, carryKey, carry);
+        }
+        if (carry) {
+            BPlusInner* top = spares[--spareCount];
+            top->children[0] = root;
+            top->children[1] = carry;
+            top->keys[0] = carryKey;
+            top->count = 2;
+            refresh(top, 0);
+            refresh(top, 1);
+            root = top;
+        }
+    }
+
+    void BPlusTreeImpl::fixUnderflow(BPlusInner* parent, int child) {
+        // Pair the short child with a neighbour, then merge the two or split their entries evenly
+        int j = child > 0 ? child - 1 : child;
+        BPlusNode* leftNode = parent->children[j];
+        BPlusNode* rightNode = parent->children[j + 1];
+
+        if (leftNode->leaf) {
+            BPlusLeaf* left = static_cast<BPlusLeaf*>(leftNode);
+            BPlusLeaf* right = static_cast<BPlusLeaf*>(rightNode);
+            int total = left->count + right->count;
+            if (total <= BPlusLeaf::kCapacity) {
+                std::copy(right->keys, right->keys + right->count, left->keys + left->count);
+                left->count = static_cast<std::uint16_t>(total);
+                left->next = right->next;
+                if (left->next) left->next->prev = left;
+                removeChild(parent, j + 1);
+                destroyNode(right);
+                refresh(parent, j);
+                return;
+            }
+            double keys[2 * BPlusLeaf::kCapacity];
+            std::copy(left->keys, left->keys + left->count, keys);
+            std::copy(right->keys, right->keys + right->count, keys + left->count);
+            int leftCount = total / 2;
+            std::copy(keys, keys + leftCount, left->keys);
+            std::copy(keys + leftCount, keys + total, right->keys);
+            left->count = static_cast<std::uint16_t>(leftCount);
+            right->count = static_cast<std::uint16_t>(total - leftCount);
+            parent->keys[j] = right->keys[0];
+        } else {
+            BPlusInner* left = static_cast<BPlusInner*>(leftNode);
+            BPlusInner* right = static_cast<BPlusInner*>(rightNode);
+            int total = left->count + right->count;
+            // The parent's separator comes down between the two runs of keys
+            double keys[2 * BPlusInner::kCapacity - 1];
+            BPlusNode* children[2 * BPlusInner::kCapacity];
+            std::copy(left->keys, left->keys + left->count - 1, keys);
+            keys[left->count - 1] = parent->keys[j];
+            std::copy(right->keys, right->keys + right->count - 1, keys + left->count);
+            std::copy(left->children, left->children + left->count, children);
+            std::copy(right->children, right->children + right->count, children + left->count);
+
+            if (total <= BPlusInner::kCapacity) {
+                std::copy(keys, keys + total - 1, left->keys);
+                std::copy(children, children + total, left->children);
+                left->count = static_cast<std::uint16_t>(total);
+                for (int i = 0; i < total; ++i) refresh(left, i);
+                removeChild(parent, j + 1);
+                destroyNode(right);
+                refresh(parent, j);
+                return;
+            }
+            int leftCount = total / 2;
+            std::copy(keys, keys + leftCount - 1, left->keys);
+            std::copy(children, children + leftCount, left->children);
+            std::copy(keys + leftCount, keys + total - 1, right->keys);
+            std::copy(children + leftCount, children + total, right->children);
+            left->count = static_cast<std::uint16_t>(leftCount);
+            right->count = static_cast<std::uint16_t>(total - leftCount);
+            for (int i = 0; i < left->count; ++i) refresh(left, i);
+            for (int i = 0; i < right->count; ++i) refresh(right, i);
+            parent->keys[j] = keys[leftCount - 1];
+        }
+        refresh(parent, j);
+        refresh(parent, j + 1);
+    }
+
+    bool BPlusTreeImpl::eraseValue(double val) {
+        Step path[kMaxHeight];
+        int depth = 0;
+        BPlusNode* node = root;
+        while (node && !node->leaf) {
+            BPlusInner* inner = static_cast<BPlusInner*>(node);
+            int child = route(inner, val);
+            path[depth++] = {inner, child};
+            node = inner->children[child];
+        }
+        countEvent(Counter::Comparisons, static_cast<std::uint64_t>(depth) + 1);
+        if (!node) return false;
+        BPlusLeaf* leaf = static_cast<BPlusLeaf*>(node);
+        double* slot = std::lower_bound(leaf->keys, leaf->keys + leaf->count, val);
+        if (slot == leaf->keys + leaf->count || *slot != val) return false;
+
+        std::copy(slot + 1, leaf->keys + leaf->count, slot);
+        --leaf->count;
+        --valueCount;
+        hash -= valueHash(val);
+        countEvent(Counter::Erases);
+        countEvent(Counter::EraseRetraceSteps, static_cast<std::uint64_t>(depth));
+
+        for (int d = depth - 1; d >= 0; --d) {
+            BPlusInner* inner = path[d].node;
+            int child = path[d].child;
+            refresh(inner, child);
+            const BPlusNode* below = inner->children[child];
+            int minimum = below->leaf ? BPlusLeaf::kMinimum : BPlusInner::kMinimum;
+            if (below->count < minimum)
+                fixUnderflow(inner, child);
+        }
+
+        // A root with a single child gives way to it; an empty root leaf goes away
+        if (!root->leaf && root->count == 1) {
+            BPlusNode* old = root;
+            root = static_cast<BPlusInner*>(root)->children[0];
+            destroyNode(old);
+        } else if (root->leaf && root->count == 0) {
+            destroyNode(root);
+            root = nullptr;
+        }
+        return true;
+    }
+
+    void BPlusTreeImpl::eraseRoot() {
+        // There is no value at the root of a B+-tree; the one its first separator stands for is removed
+        if (!root) return;
+        double val;
+        if (root->leaf)
+            val = static_cast<BPlusLeaf*>(root)->keys[root->count / 2];
+        else
+            val = *selectValue(static_cast<BPlusInner*>(root)->sizes[0]);
+        eraseValue(val);
+    }
+
+    void BPlusTreeImpl::assignSorted(const double* values, std::size_t count) {
+        if (count == 0) return;
+        std::vector<BPlusNode*> level;  // Roots of the finished subtrees
+        std::vector<BPlusNode*> upper;  // The level above them, being built
+        try {
+            // Leaves filled evenly, so every leaf holds at least the minimum once there are two
+            std::size_t leaves = (count + BPlusLeaf::kCapacity - 1) / BPlusLeaf::kCapacity;
+            std::vector<double> minima;
+            level.reserve(leaves);
+            minima.reserve(leaves);
+            BPlusLeaf* previous = nullptr;
+            for (std::size_t i = 0, used = 0; i < leaves; ++i) {
+                std::size_t take = count / leaves + (i < count % leaves);
+                BPlusLeaf* leaf = createLeaf();
+                std::copy(values + used, values + used + take, leaf->keys);
+                leaf->count = static_cast<std::uint16_t>(take);
+                leaf->prev = previous;
+                if (previous) previous->next = leaf;
+                previous = leaf;
+                level.push_back(leaf);
+                minima.push_back(values[used]);
+                used += take;
+            }
+
+            // Inner levels grouped the same way until one node is left
+            while (level.size() > 1) {
+                std::size_t parents = (level.size() + BPlusInner::kCapacity - 1) / BPlusInner::kCapacity;
+                std::vector<double> upperMinima;
+                upper.clear();
+                upper.reserve(parents);
+                upperMinima.reserve(parents);
+                for (std::size_t i = 0, used = 0; i < parents; ++i) {
+                    std::size_t take = level.size() / parents + (i < level.size() % parents);
+                    BPlusInner* inner = createInner();
+                    for (std::size_t c = 0; c < take; ++c) {
+                        inner->children[c] = level[used + c];
+                        if (c > 0) inner->keys[c - 1] = minima[used + c];
+                    }
+                    inner->count = static_cast<std::uint16_t>(take);
+                    for (int c = 0; c < inner->count; ++c) refresh(inner, c);
+                    upper.push_back(inner);
+                    upperMinima.push_back(minima[used]);
+                    used += take;
+                }
+                level.swap(upper);
+                upper.clear();
+                minima.swap(upperMinima);
+            }
+            root = level[0];
+            valueCount = count;
+            for (std::size_t i = 0; i < count; ++i) hash += valueHash(values[i]);
+        } catch (...) {
+            // Nothing is reachable from the root yet; the new level's children all sit in the finished one
+            for (BPlusNode* node : upper) destroyNode(node);
+            for (BPlusNode* node : level) freeNodes(node);
+            throw;
+        }
+    }
+
+    const BPlusLeaf* BPlusTreeImpl::leafFor(double val) const {
+        const BPlusNode* node = root;
+        std::uint64_t levels = 0;
+        while (node && !node->leaf) {
+            const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+            node = inner->children[route(inner, val)];
+            ++levels;
+        }
+        countEvent(Counter::Comparisons, levels + (node != nullptr));
+        return static_cast<const BPlusLeaf*>(node);
+    }
+
+    bool BPlusTreeImpl::contains(double val) const {
+        const BPlusLeaf* leaf = leafFor(val);
+        return leaf && std::binary_search(leaf->keys, leaf->keys + leaf->count, val);
+    }
+
+    double BPlusTreeImpl::total() const {
+        return root ? nodeSum(root) : 0;
+    }
+
+    std::size_t BPlusTreeImpl::countBelow(double val, bool inclusive) const {
+        // Every child left of the route holds only values below the separator, which is <= val
+        std::size_t below = 0;
+        const BPlusNode* node = root;
+        if (!node) return 0;
+        while (!node->leaf) {
+            const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+            int child = route(inner, val);
+            below = std::accumulate(inner->sizes, inner->sizes + child, below);
+            node = inner->children[child];
+        }
+        const BPlusLeaf* leaf = static_cast<const BPlusLeaf*>(node);
+        const double* end = leaf->keys + leaf->count;
+        return below + static_cast<std::size_t>(
+            (inclusive ? std::upper_bound(leaf->keys, end, val) : std::lower_bound(leaf->keys, end, val)) - leaf->keys);
+    }
+
+    std::size_t BPlusTreeImpl::rankOf(double val) const {
+        return countBelow(val, false);
+    }
+
+    const double* BPlusTreeImpl::selectValue(std::size_t k) const {
+        if (k >= valueCount) return nullptr;
+        const BPlusNode* node = root;
+        while (!node->leaf) {
+            const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+            int child = 0;
+            while (k >= inner->sizes[child]) k -= inner->sizes[child++];
+            node = inner->children[child];
+        }
+        return &static_cast<const BPlusLeaf*>(node)->keys[k];
+    }
+
+    std::size_t BPlusTreeImpl::rangeCount(double lo, double hi) const {
+        if (!(lo <= hi)) return 0;
+        return countBelow(hi, true) - countBelow(lo, false);
+    }
+
+    double BPlusTreeImpl::sumRange(const BPlusNode* node, double lo, double hi, bool checkLo, bool checkHi) const {
+        // Only the nodes on the two boundary paths are opened; whole children in between add their cached sums
+        if (!checkLo && !checkHi) return nodeSum(node);
+        if (node->leaf) {
+            const BPlusLeaf* leaf = static_cast<const BPlusLeaf*>(node);
+            const double* begin = checkLo ? std::lower_bound(leaf->keys, leaf->keys + leaf->count, lo) : leaf->keys;
+            const double* end = checkHi ? std::upper_bound(leaf->keys, leaf->keys + leaf->count, hi) : leaf->keys + leaf->count;
+            return begin < end ? std::accumulate(begin, end, 0.0) : 0.0;
+        }
+        const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+        int first = checkLo ? route(inner, lo) : 0;
+        int last = checkHi ? route(inner, hi) : inner->count - 1;
+        if (first == last) return sumRange(inner->children[first], lo, hi, checkLo, checkHi);
+        double sum = sumRange(inner->children[first], lo, hi, checkLo, false);
+        for (int i = first + 1; i < last; ++i) sum += inner->sums[i];
+        return sum + sumRange(inner->children[last], lo, hi, false, checkHi);
+    }
+
+    double BPlusTreeImpl::rangeSum(double lo, double hi) const {
+        if (!root || !(lo <= hi)) return 0;
+        return sumRange(root, lo, hi, true, true);
+    }
+
+    TreePosition BPlusTreeImpl::at(const BPlusLeaf* leaf, int slot) const {
+        // A slot past the end of a leaf is the first slot of the next one
+        if (leaf && slot >= leaf->count) {
+            leaf = leaf->next;
+            slot = 0;
+        }
+        return leaf ? TreePosition{leaf, static_cast<std::size_t>(slot)} : TreePosition();
+    }
+
+    TreePosition BPlusTreeImpl::first() const {
+        const BPlusNode* node = root;
+        while (node && !node->leaf) node = static_cast<const BPlusInner*>(node)->children[0];
+        return at(static_cast<const BPlusLeaf*>(node), 0);
+    }
+
+    TreePosition BPlusTreeImpl::last() const {
+        const BPlusNode* node = root;
+        while (node && !node->leaf) {
+            const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+            node = inner->children[inner->count - 1];
+        }
+        return node ? at(static_cast<const BPlusLeaf*>(node), node->count - 1) : TreePosition();
+    }
+
+    TreePosition BPlusTreeImpl::find(double val) const {
+        const BPlusLeaf* leaf = leafFor(val);
+        if (!leaf) return TreePosition();
+        const double* slot = std::lower_bound(leaf->keys, leaf->keys + leaf->count, val);
+        if (slot == leaf->keys + leaf->count || *slot != val) return TreePosition();
+        return at(leaf, static_cast<int>(slot - leaf->keys));
+    }
+
+    TreePosition BPlusTreeImpl::lowerBound(double val) const {
+        const BPlusLeaf* leaf = leafFor(val);
+        if (!leaf) return TreePosition();
+        return at(leaf, static_cast<int>(std::lower_bound(leaf->keys, leaf->keys + leaf->count, val) - leaf->keys));
+    }
+
+    TreePosition BPlusTreeImpl::upperBound(double val) const {
+        const BPlusLeaf* leaf = leafFor(val);
+        if (!leaf) return TreePosition();
+        return at(leaf, static_cast<int>(std::upper_bound(leaf->keys, leaf->keys + leaf->count, val) - leaf->keys));
+    }
+
+    TreePosition BPlusTreeImpl::lastNotAbove(double val) const {
+        TreePosition position = upperBound(val);
+        if (position == first()) return TreePosition();
+        prev(position);
+        return position;
+    }
+
+    void BPlusTreeImpl::next(TreePosition& position) const {
+        position = at(static_cast<const BPlusLeaf*>(position.node), static_cast<int>(position.slot) + 1);
+    }
+
+    void BPlusTreeImpl::prev(TreePosition& position) const {
+        const BPlusLeaf* leaf = static_cast<const BPlusLeaf*>(position.node);
+        if (!leaf) {
+            position = last();
+        } else if (position.slot > 0) {
+            --position.slot;
+        } else if (leaf->prev) {
+            position = {leaf->prev, static_cast<std::size_t>(leaf->prev->count - 1)};
+        } else {
+            position = TreePosition();
+        }
+    }
+
+    const double& BPlusTreeImpl::valueAt(const TreePosition& position) const {
+        return static_cast<const BPlusLeaf*>(position.node)->keys[position.slot];
+    }
+
+    void BPlusTreeImpl::writeValues(OutputSink& sink, const FormatOptions& options) const {
+        ValueFormatter formatter(sink, options);
+        for (const BPlusLeaf* leaf = static_cast<const BPlusLeaf*>(first().node); leaf; leaf = leaf->next)
+            for (int i = 0; i < leaf->count; ++i)
+                formatter.append(leaf->keys[i]);
+        formatter.finish();
+    }
+
+    std::size_t BPlusTreeImpl::memoryBytes() const {
+#ifdef AVL_USE_GLOBAL_HEAP
+        return leafCount * sizeof(BPlusLeaf) + innerCount * sizeof(BPlusInner);
+#else
+        return leafPool.capacityBytes() + innerPool.capacityBytes();
+#endif
+    }
+
+    TreeStats BPlusTreeImpl::stats() const {
+        // Nodes rather than values are counted per depth; all leaves share the deepest level
+        TreeStats stats;
+        stats.nodeCount = valueCount;
+        stats.memoryBytes = sizeof(BPlusTreeImpl) + memoryBytes();
+        std::vector<const BPlusNode*> level;
+        if (root) level.push_back(root);
+        while (!level.empty()) {
+            stats.depthHistogram.push_back(level.size());
+            std::vector<const BPlusNode*> below;
+            for (const BPlusNode* node : level) {
+                if (node->leaf) continue;
+                const BPlusInner* inner = static_cast<const BPlusInner*>(node);
+                below.insert(below.end(), inner->children, inner->children + inner->count);
+            }
+            level.swap(below);
+        }
+        stats.height = static_cast<int>(stats.depthHistogram.size());
+        return stats;
+    }
+
+}
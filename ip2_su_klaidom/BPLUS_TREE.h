@@ -0,0 +1,126 @@
+#ifndef BPLUS_TREE_H
+#define BPLUS_TREE_H
+
+#include "AVL_TREE_IMPL.h"
+#ifndef AVL_USE_GLOBAL_HEAP
+#include "NODE_POOL.h"
+#endif
+
+#include <cstdint>
+
+namespace AVLProject {
+
+    /**
+     * @brief Fields shared by both kinds of B+-tree node.
+     */
+    struct BPlusNode {
+        std::uint16_t count;  ///< Keys in a leaf, children in an inner node.
+        bool leaf;            ///< True for leaves, which hold the values.
+    };
+
+    /**
+     * @brief A B+-tree leaf: four cache lines holding up to 29 sorted values.
+     */
+    struct alignas(64) BPlusLeaf : BPlusNode {
+        static constexpr int kCapacity = 29;      ///< Values that fit in 256 bytes.
+        static constexpr int kMinimum = kCapacity / 2;  ///< Fewest values in a leaf other than the root.
+
+        BPlusLeaf* prev;           ///< Leaf with the next smaller values, nullptr for the first.
+        BPlusLeaf* next;           ///< Leaf with the next larger values, nullptr for the last.
+        double keys[kCapacity];    ///< The values, ascending.
+    };
+
+    /**
+     * @brief A B+-tree inner node: eight cache lines routing to up to 16 children.
+     *
+     * Every child comes with the number and the sum of the values below it, so
+     * rank, select and range sums need only one descent.
+     */
+    struct alignas(64) BPlusInner : BPlusNode {
+        static constexpr int kCapacity = 16;      ///< Children that fit in 512 bytes.
+        static constexpr int kMinimum = kCapacity / 2;  ///< Fewest children of an inner node other than the root.
+
+        double keys[kCapacity - 1];        ///< keys[i] <= every value under children[i + 1], > every value under children[i].
+        BPlusNode* children[kCapacity];    ///< The subtrees, ascending.
+        std::size_t sizes[kCapacity];      ///< Number of values under each child.
+        double sums[kCapacity];            ///< Sum of the values under each child.
+    };
+
+    /**
+     * @brief The StorageEngine::BPlus implementation: a B+-tree of cache-line-sized nodes.
+     *
+     * A search touches one node per level, and with 16-way fan-out there are about a
+     * quarter as many levels as in a binary tree. Leaves are linked in both directions,
+     * so iterators and scans move through memory sequentially. Values move between
+     * leaves when nodes split or merge, so any insert or removal invalidates iterators.
+     */
+    class BPlusTreeImpl : public AVLTreeImpl {
+    public:
+        BPlusTreeImpl() : AVLTreeImpl(StorageEngine::BPlus) {}
+        ~BPlusTreeImpl() override { clear(); }
+
+        std::shared_ptr<AVLTreeImpl> clone() const override;
+        void clear() override;
+        void insertValue(double val) override;
+        bool eraseValue(double val) override;
+        void eraseRoot() override;
+        void assignSorted(const double* values, std::size_t count) override;
+        bool contains(double val) const override;
+        std::size_t count() const override { return valueCount; }
+        double total() const override;
+        std::size_t rankOf(double val) const override;
+        const double* selectValue(std::size_t k) const override;
+        std::size_t rangeCount(double lo, double hi) const override;
+        double rangeSum(double lo, double hi) const override;
+        TreePosition first() const override;
+        TreePosition last() const override;
+        TreePosition find(double val) const override;
+        TreePosition lowerBound(double val) const override;
+        TreePosition upperBound(double val) const override;
+        TreePosition lastNotAbove(double val) const override;
+        void next(TreePosition& position) const override;
+        void prev(TreePosition& position) const override;
+        const double& valueAt(const TreePosition& position) const override;
+        void writeValues(OutputSink& sink, const FormatOptions& options) const override;
+        std::uint64_t contentHash() const override { return hash; }
+        TreeStats stats() const override;
+        std::size_t memoryBytes() const override;
+
+    private:
+        /// One level of a descent: the inner node and the child that was taken.
+        struct Step {
+            BPlusInner* node;
+            int child;
+        };
+
+        BPlusNode* root = nullptr;     ///< nullptr when the tree is empty.
+        std::size_t valueCount = 0;    ///< Number of stored values.
+        std::uint64_t hash = 0;        ///< Running content hash, see contentHash().
+        std::size_t leafCount = 0;     ///< Leaves allocated.
+        std::size_t innerCount = 0;    ///< Inner nodes allocated.
+#ifndef AVL_USE_GLOBAL_HEAP
+        NodePool<BPlusLeaf> leafPool;    ///< Per-tree slab storage for the leaves.
+        NodePool<BPlusInner> innerPool;  ///< Per-tree slab storage for the inner nodes.
+#endif
+
+        BPlusLeaf* createLeaf();
+        BPlusInner* createInner();
+        void destroyNode(BPlusNode* node);
+        void freeNodes(BPlusNode* node);
+        static int route(const BPlusInner* node, double val);
+        static std::size_t nodeSize(const BPlusNode* node);
+        static double nodeSum(const BPlusNode* node);
+        static void refresh(BPlusInner* node, int child);
+        static void removeChild(BPlusInner* node, int child);
+        const BPlusLeaf* leafFor(double val) const;
+        std::size_t countBelow(double val, bool inclusive) const;
+        double sumRange(const BPlusNode* node, double lo, double hi, bool checkLo, bool checkHi) const;
+        TreePosition at(const BPlusLeaf* leaf, int slot) const;
+        BPlusLeaf* splitLeaf(BPlusLeaf* leaf, BPlusLeaf* right, int slot, double val);
+        BPlusInner* insertChild(BPlusInner* node, BPlusInner* spare, int slot, double& key, BPlusNode* child);
+        void fixUnderflow(BPlusInner* parent, int child);
+        void copyNode(const BPlusNode* source, BPlusNode*& target, BPlusLeaf*& previous);
+    };
+
+}
+#endif // BPLUS_TREE_H
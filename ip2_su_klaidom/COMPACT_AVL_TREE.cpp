@@ -0,0 +1,459 @@
+#include "COMPACT_AVL_TREE.h"
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace AVLProject {
+
+    static_assert(sizeof(CompactNode) == 24, "compact nodes are meant to take 24 bytes");
+
+    std::shared_ptr<AVLTreeImpl> CompactAVLTreeImpl::clone() const {
+        countEvent(Counter::Allocations, count());
+        return std::make_shared<CompactAVLTreeImpl>(*this);  // One contiguous copy of the node array
+    }
+
+    void CompactAVLTreeImpl::clear() {
+        countEvent(Counter::Frees, count());
+        std::vector<CompactNode>(1, CompactNode{0.0, 0, 0, 0, 0}).swap(nodes);  // Gives the array back
+        root = 0;
+        freeList = 0;
+        sum = 0;
+        hash = 0;
+    }
+
+    TreePosition CompactAVLTreeImpl::at(std::uint32_t index) const {
+        // Any non-null node marks a valid position; the slot says which node it is
+        return index ? TreePosition{this, index} : TreePosition();
+    }
+
+    std::uint32_t CompactAVLTreeImpl::allocate(double val) {
+        countEvent(Counter::Allocations);
+        std::uint32_t index = freeList;
+        if (index) {
+            freeList = nodes[index].left;
+            nodes[index] = CompactNode{val, 0, 0, 1, 1};
+            return index;
+        }
+        if (nodes.size() > kMaxValues)
+            throw std::length_error("compact AVL tree: more values than 32-bit indices can address");
+        nodes.push_back(CompactNode{val, 0, 0, 1, 1});
+        return static_cast<std::uint32_t>(nodes.size() - 1);
+    }
+
+    void CompactAVLTreeImpl::release(std::uint32_t index) {
+        countEvent(Counter::Frees);
+        nodes[index].left = freeList;
+        freeList = index;
+    }
+
+    void CompactAVLTreeImpl::update(std::uint32_t index) {
+        CompactNode& node = nodes[index];
+        const CompactNode& left = nodes[node.left];
+        const CompactNode& right = nodes[node.right];
+        node.size = 1 + left.size + right.size;
+        node.height = static_cast<std::uint8_t>(1 + std::max(left.height, right.height));
+    }
+
+    std::uint32_t CompactAVLTreeImpl::rotateRight(std::uint32_t y) {
+        std::uint32_t x = nodes[y].left;
+        nodes[y].left = nodes[x].right;
+        nodes[x].right = y;
+        update(y);
+        update(x);
+        return x;
+    }
+
+    std::uint32_t CompactAVLTreeImpl::rotateLeft(std::uint32_t x) {
+        std::uint32_t y = nodes[x].right;
+        nodes[x].right = nodes[y].left;
+        nodes[y].left = x;
+        update(x);
+        update(y);
+        return y;
+    }
+
+    std::uint32_t CompactAVLTreeImpl::rebalance(std::uint32_t index) {
+        auto balance = [this](std::uint32_t at) {
+            return static_cast<int>(nodes[nodes[at].left].height) - nodes[nodes[at].right].height;
+        };
+        int factor = balance(index);
+        if (factor > 1) {
+            if (balance(nodes[index].left) < 0) {
+                countEvent(Counter::DoubleRotations);
+                nodes[index].left = rotateLeft(nodes[index].left);
+            } else {
+                countEvent(Counter::RightRotations);
+            }
+            return rotateRight(index);
+        }
+        if (factor < -1) {
+            if (balance(nodes[index].right) > 0) {
+                countEvent(Counter::DoubleRotations);
+                nodes[index].right = rotateRight(nodes[index].right);
+            } else {
+                countEvent(Counter::LeftRotations);
+            }
+            return rotateLeft(index);
+        }
+        return index;
+    }
+
+    void CompactAVLTreeImpl::retrace(const std::uint32_t* path, int depth) {
+        // Without parent links the search path stands in for them; every ancestor's size changed
+        for (int i = depth - 1; i >= 0; --i) {
+            std::uint32_t index = path[i];
+            update(index);
+            std::uint32_t top = rebalance(index);
+            if (top == index) continue;
+            if (i == 0)
+                root = top;
+            else if (nodes[path[i - 1]].left == index)
+                nodes[path[i - 1]].left = top;
+            else
+                nodes[path[i - 1]].right = top;
+        }
+    }
+
+    void CompactAVLTreeImpl::insertValue(double val) {
+        std::uint32_t path[kMaxHeight];
+        int depth = 0;
+        for (std::uint32_t index = root; index;) {
+            path[depth++] = index;
+            const CompactNode& node = nodes[index];
+            if (val < node.value)
+                index = node.left;
+            else if (val > node.value)
+                index = node.right;
+            else
+                throw DuplicateValueException(val);
+        }
+        countEvent(Counter::Comparisons, static_cast<std::uint64_t>(depth));
+        countEvent(Counter::Inserts);
+
+        std::uint32_t leaf = allocate(val);  // May move the array, so only indices are held across it
+        if (depth == 0)
+            root = leaf;
+        else if (val < nodes[path[depth - 1]].value)
+            nodes[path[depth - 1]].left = leaf;
+        else
+            nodes[path[depth - 1]].right = leaf;
+        sum += val;
+        hash += valueHash(val);
+
+        countEvent(Counter::InsertRetraceSteps, static_cast<std::uint64_t>(depth));
+        retrace(path, depth);
+    }
+
+    bool CompactAVLTreeImpl::eraseValue(double val) {
+        std::uint32_t path[kMaxHeight];
+        int depth = 0;
+        std::uint32_t index = root;
+        while (index && nodes[index].value != val) {
+            path[depth++] = index;
+            index = val < nodes[index].value ? nodes[index].left : nodes[index].right;
+        }
+        countEvent(Counter::Comparisons, static_cast<std::uint64_t>(depth) + (index != 0));
+        if (!index) return false;
+
+        if (nodes[index].left && nodes[index].right) {
+            // Nodes have no identity outside the tree, so the successor's value moves up instead
+            std::uint32_t target = index;
+            path[depth++] = index;
+            for (index = nodes[index].right; nodes[index].left; index = nodes[index].left)
+                path[depth++] = index;
+            nodes[target].value = nodes[index].value;
+        }
+
+        std::uint32_t child = nodes[index].left ? nodes[index].left : nodes[index].right;
+        if (depth == 0)
+            root = child;
+        else if (nodes[path[depth - 1]].left == index)
+            nodes[path[depth - 1]].left = child;
+        else
+            nodes[path[depth - 1]].right = child;
+        release(index);
+
+        sum = root ? sum - val : 0;  // An empty tree drops the rounding error of the running total
+        hash -= valueHash(val);
+        countEvent(Counter::Erases);
+        countEvent(Counter::EraseRetraceSteps, static_cast<std::uint64_t>(depth));
+        retrace(path, depth);
+        return true;
+    }
+
+    void CompactAVLTreeImpl::eraseRoot() {
+        if (root) eraseValue(nodes[root].value);
+    }
+
+    void CompactAVLTreeImpl::assignSorted(const double* values, std::size_t count) {
+        if (count > kMaxValues)
+            throw std::length_error("compact AVL tree: more values than 32-bit indices can address");
+        countEvent(Counter::Allocations, count);
+        nodes.assign(count + 1, CompactNode{0.0, 0, 0, 0, 0});
+
+        // A complete tree in breadth-first order: node i has children 2i and 2i + 1
+        for (std::size_t i = 1; i <= count; ++i) {
+            nodes[i].left = 2 * i <= count ? static_cast<std::uint32_t>(2 * i) : 0;
+            nodes[i].right = 2 * i + 1 <= count ? static_cast<std::uint32_t>(2 * i + 1) : 0;
+        }
+        root = count ? 1 : 0;
+        freeList = 0;
+        const double* next = values;
+        fillInOrder(root, next);
+        for (std::size_t i = count; i >= 1; --i)
+            update(static_cast<std::uint32_t>(i));
+        sum = std::accumulate(values, values + count, 0.0);
+        hash = 0;
+        for (std::size_t i = 0; i < count; ++i) hash += valueHash(values[i]);
+    }
+
+    void CompactAVLTreeImpl::fillInOrder(std::uint32_t index, const double*& values) {
+        // Recurses once per level of a complete tree, so at most 33 frames deep
+        if (!index) return;
+        fillInOrder(nodes[index].left, values);
+        nodes[index].value = *values++;
+        fillInOrder(nodes[index].right, values);
+    }
+
+    std::uint32_t CompactAVLTreeImpl::findIndex(double val) const {
+        std::uint32_t index = root;
+        std::uint64_t compared = 0;
+        while (index && nodes[index].value != val) {
+            ++compared;
+            index = val < nodes[index].value ? nodes[index].left : nodes[index].right;
+        }
+        countEvent(Counter::Comparisons, compared + (index != 0));
+        return index;
+    }
+
+    bool CompactAVLTreeImpl::contains(double val) const {
+        return findIndex(val) != 0;
+    }
+
+    void CompactAVLTreeImpl::containsMany(const double* keys, std::size_t count, bool* results) const {
+        if (!root) {
+            std::fill(results, results + count, false);
+            return;
+        }
+        std::uint64_t compared = 0;
+        const CompactNode* slots = nodes.data();
+        searchInterleaved<std::uint32_t>(root, keys, count, results, [&compared, slots](std::uint32_t& index, double key) {
+            ++compared;
+            const CompactNode& node = slots[index];
+            if (key == node.value) return 1;
+            index = key < node.value ? node.left : node.right;
+            if (!index) return -1;
+            prefetchNode(slots + index);
+            return 0;
+        });
+        countEvent(Counter::Comparisons, compared);
+    }
+
+    std::size_t CompactAVLTreeImpl::rankOf(double val) const {
+        std::size_t rank = 0;
+        for (std::uint32_t index = root; index;) {
+            const CompactNode& node = nodes[index];
+            if (val <= node.value) {
+                index = node.left;
+            } else {
+                rank += nodes[node.left].size + 1;
+                index = node.right;
+            }
+        }
+        return rank;
+    }
+
+    const double* CompactAVLTreeImpl::selectValue(std::size_t k) const {
+        for (std::uint32_t index = root; index;) {
+            const CompactNode& node = nodes[index];
+            std::size_t leftSize = nodes[node.left].size;
+            if (k < leftSize) {
+                index = node.left;
+            } else if (k == leftSize) {
+                return &node.value;
+            } else {
+                k -= leftSize + 1;
+                index = node.right;
+            }
+        }
+        return nullptr;
+    }
+
+    std::size_t CompactAVLTreeImpl::rangeCount(double lo, double hi) const {
+        if (!(lo <= hi)) return 0;
+        // Values <= hi minus values < lo
+        std::size_t notAbove = 0;
+        for (std::uint32_t index = root; index;) {
+            const CompactNode& node = nodes[index];
+            if (hi < node.value) {
+                index = node.left;
+            } else {
+                notAbove += nodes[node.left].size + 1;
+                index = node.right;
+            }
+        }
+        return notAbove - rankOf(lo);
+    }
+
+    double CompactAVLTreeImpl::rangeSum(double lo, double hi) const {
+        // No subtree sums to lean on, so the values in the range are visited in order
+        std::uint32_t pending[kMaxHeight];
+        int top = 0;
+        for (std::uint32_t index = root; index;) {
+            if (nodes[index].value < lo) {
+                index = nodes[index].right;
+            } else {
+                pending[top++] = index;
+                index = nodes[index].left;
+            }
+        }
+        double total = 0;
+        while (top > 0) {
+            const CompactNode& node = nodes[pending[--top]];
+            if (node.value > hi) break;
+            total += node.value;
+            for (std::uint32_t index = node.right; index; index = nodes[index].left)
+                pending[top++] = index;
+        }
+        return total;
+    }
+
+    TreePosition CompactAVLTreeImpl::first() const {
+        std::uint32_t index = root;
+        while (nodes[index].left) index = nodes[index].left;
+        return at(index);
+    }
+
+    TreePosition CompactAVLTreeImpl::last() const {
+        std::uint32_t index = root;
+        while (nodes[index].right) index = nodes[index].right;
+        return at(index);
+    }
+
+    TreePosition CompactAVLTreeImpl::find(double val) const {
+        return at(findIndex(val));
+    }
+
+    std::uint32_t CompactAVLTreeImpl::lowerBoundIndex(double val) const {
+        std::uint32_t bound = 0;
+        for (std::uint32_t index = root; index;) {
+            if (nodes[index].value < val) {
+                index = nodes[index].right;
+            } else {
+                bound = index;
+                index = nodes[index].left;
+            }
+        }
+        return bound;
+    }
+
+    std::uint32_t CompactAVLTreeImpl::upperBoundIndex(double val) const {
+        std::uint32_t bound = 0;
+        for (std::uint32_t index = root; index;) {
+            if (val < nodes[index].value) {
+                bound = index;
+                index = nodes[index].left;
+            } else {
+                index = nodes[index].right;
+            }
+        }
+        return bound;
+    }
+
+    std::uint32_t CompactAVLTreeImpl::lastBelowIndex(double val) const {
+        std::uint32_t bound = 0;
+        for (std::uint32_t index = root; index;) {
+            if (nodes[index].value < val) {
+                bound = index;
+                index = nodes[index].right;
+            } else {
+                index = nodes[index].left;
+            }
+        }
+        return bound;
+    }
+
+    std::uint32_t CompactAVLTreeImpl::lastNotAboveIndex(double val) const {
+        std::uint32_t bound = 0;
+        for (std::uint32_t index = root; index;) {
+            if (val < nodes[index].value) {
+                index = nodes[index].left;
+            } else {
+                bound = index;
+                index = nodes[index].right;
+            }
+        }
+        return bound;
+    }
+
+    TreePosition CompactAVLTreeImpl::lowerBound(double val) const {
+        return at(lowerBoundIndex(val));
+    }
+
+    TreePosition CompactAVLTreeImpl::upperBound(double val) const {
+        return at(upperBoundIndex(val));
+    }
+
+    TreePosition CompactAVLTreeImpl::lastNotAbove(double val) const {
+        return at(lastNotAboveIndex(val));
+    }
+
+    void CompactAVLTreeImpl::next(TreePosition& position) const {
+        position = at(upperBoundIndex(nodes[position.slot].value));
+    }
+
+    void CompactAVLTreeImpl::prev(TreePosition& position) const {
+        if (position.node)
+            position = at(lastBelowIndex(nodes[position.slot].value));
+        else
+            position = last();
+    }
+
+    const double& CompactAVLTreeImpl::valueAt(const TreePosition& position) const {
+        return nodes[position.slot].value;
+    }
+
+    void CompactAVLTreeImpl::writeValues(OutputSink& sink, const FormatOptions& options) const {
+        ValueFormatter formatter(sink, options);
+        std::uint32_t pending[kMaxHeight];
+        int top = 0;
+        for (std::uint32_t index = root; index; index = nodes[index].left)
+            pending[top++] = index;
+        while (top > 0) {
+            const CompactNode& node = nodes[pending[--top]];
+            formatter.append(node.value);
+            for (std::uint32_t index = node.right; index; index = nodes[index].left)
+                pending[top++] = index;
+        }
+        formatter.finish();
+    }
+
+    std::size_t CompactAVLTreeImpl::memoryBytes() const {
+        return nodes.capacity() * sizeof(CompactNode);
+    }
+
+    TreeStats CompactAVLTreeImpl::stats() const {
+        TreeStats stats;
+        stats.nodeCount = count();
+        stats.height = nodes[root].height;
+        stats.memoryBytes = sizeof(CompactAVLTreeImpl) + memoryBytes();
+        stats.depthHistogram.assign(static_cast<std::size_t>(stats.height), 0);
+
+        struct Pending {
+            std::uint32_t index;
+            std::size_t depth;
+        };
+        Pending pending[kMaxHeight];
+        int top = 0;
+        if (root) pending[top++] = {root, 0};
+        while (top > 0) {
+            Pending next = pending[--top];
+            for (std::uint32_t index = next.index; index; index = nodes[index].left, ++next.depth) {
+                ++stats.depthHistogram[next.depth];
+                if (nodes[index].right) pending[top++] = {nodes[index].right, next.depth + 1};
+            }
+        }
+        return stats;
+    }
+
+}
@@ -0,0 +1,92 @@
+#ifndef COMPACT_AVL_TREE_H
+#define COMPACT_AVL_TREE_H
+
+#include "AVL_TREE_IMPL.h"
+
+#include <cstdint>
+#include <vector>
+
+namespace AVLProject {
+
+    /**
+     * @brief A node of the compact engine: 24 bytes instead of the 56 of a linked node.
+     *
+     * Children are 32-bit indices into the node array, with 0 standing for "none".
+     * There is no parent link and no cached subtree sum; the height fits in a byte.
+     */
+    struct CompactNode {
+        double value;         ///< The value stored in the node.
+        std::uint32_t left;   ///< Index of the left child, 0 if there is none; links the freelist.
+        std::uint32_t right;  ///< Index of the right child, 0 if there is none.
+        std::uint32_t size;   ///< Number of values in the subtree rooted at this node.
+        std::uint8_t height;  ///< Height of the node in the tree.
+    };
+
+    /**
+     * @brief The StorageEngine::Compact implementation: an AVL tree in one contiguous array.
+     *
+     * Slot 0 of the array is a sentinel with size and height 0, so leaves need no
+     * null checks. Removed slots are recycled through a freelist. Bulk loads lay the
+     * tree out in breadth-first (Eytzinger) order, so the top levels that every search
+     * passes through share a handful of cache lines. Without parent links, writes
+     * remember their search path on a stack and iterators step by searching again.
+     */
+    class CompactAVLTreeImpl : public AVLTreeImpl {
+    public:
+        static constexpr std::size_t kMaxValues = 0xFFFFFFFFu;  ///< Slots addressable by a 32-bit index.
+
+        CompactAVLTreeImpl() : AVLTreeImpl(StorageEngine::Compact), nodes(1, CompactNode{0.0, 0, 0, 0, 0}) {}
+
+        std::shared_ptr<AVLTreeImpl> clone() const override;
+        void clear() override;
+        void insertValue(double val) override;
+        bool eraseValue(double val) override;
+        void eraseRoot() override;
+        void assignSorted(const double* values, std::size_t count) override;
+        bool contains(double val) const override;
+        void containsMany(const double* keys, std::size_t count, bool* results) const override;
+        std::size_t count() const override { return nodes[root].size; }
+        double total() const override { return sum; }
+        std::size_t rankOf(double val) const override;
+        const double* selectValue(std::size_t k) const override;
+        std::size_t rangeCount(double lo, double hi) const override;
+        double rangeSum(double lo, double hi) const override;
+        TreePosition first() const override;
+        TreePosition last() const override;
+        TreePosition find(double val) const override;
+        TreePosition lowerBound(double val) const override;
+        TreePosition upperBound(double val) const override;
+        TreePosition lastNotAbove(double val) const override;
+        void next(TreePosition& position) const override;
+        void prev(TreePosition& position) const override;
+        const double& valueAt(const TreePosition& position) const override;
+        void writeValues(OutputSink& sink, const FormatOptions& options) const override;
+        std::uint64_t contentHash() const override { return hash; }
+        TreeStats stats() const override;
+        std::size_t memoryBytes() const override;
+
+    private:
+        std::vector<CompactNode> nodes;  ///< Every node, the sentinel at index 0 included.
+        std::uint32_t root = 0;          ///< Index of the root, 0 when empty.
+        std::uint32_t freeList = 0;      ///< First recycled slot, 0 when there is none.
+        double sum = 0;                  ///< Running total of the stored values.
+        std::uint64_t hash = 0;          ///< Running content hash, see contentHash().
+
+        TreePosition at(std::uint32_t index) const;
+        std::uint32_t allocate(double val);
+        void release(std::uint32_t index);
+        void update(std::uint32_t index);
+        std::uint32_t rotateLeft(std::uint32_t x);
+        std::uint32_t rotateRight(std::uint32_t y);
+        std::uint32_t rebalance(std::uint32_t index);
+        void retrace(const std::uint32_t* path, int depth);
+        std::uint32_t findIndex(double val) const;
+        std::uint32_t lowerBoundIndex(double val) const;
+        std::uint32_t upperBoundIndex(double val) const;
+        std::uint32_t lastBelowIndex(double val) const;
+        std::uint32_t lastNotAboveIndex(double val) const;
+        void fillInOrder(std::uint32_t index, const double*& values);
+    };
+
+}
+#endif // COMPACT_AVL_TREE_H
@@ -0,0 +1,630 @@
+#include "CONCURRENT_AVL_TREE.h"
+#include "AVL_TREE.h"
+#include <algorithm>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace AVLProject {
+
+    namespace {
+
+        /**
+         * Test-and-test-and-set lock that yields while it waits. Critical sections are a
+         * handful of pointer writes, so it is cheaper and far smaller than std::mutex.
+         */
+        class SpinLock {
+        private:
+            std::atomic<bool> locked{false};
+
+        public:
+            void lock() {
+                for (int spins = 0; locked.exchange(true, std::memory_order_acquire); ++spins) {
+                    while (locked.load(std::memory_order_relaxed)) {
+                        if (++spins > 64) std::this_thread::yield();
+                    }
+                }
+            }
+
+            void unlock() { locked.store(false, std::memory_order_release); }
+        };
+
+        // Version word: bit 0 marks an unlinked node, bit 1 a rotation in progress,
+        // and the remaining bits count finished rotations.
+        constexpr std::uint64_t kUnlinked = 1;
+        constexpr std::uint64_t kShrinking = 2;
+
+        bool isUnlinked(std::uint64_t version) { return (version & kUnlinked) != 0; }
+        bool isShrinkingOrUnlinked(std::uint64_t version) { return (version & (kUnlinked | kShrinking)) != 0; }
+        std::uint64_t beginShrink(std::uint64_t version) { return version | kShrinking; }
+        std::uint64_t endShrink(std::uint64_t version) { return (version | kShrinking) + kShrinking; }
+
+        // nodeCondition() results other than a repaired height
+        constexpr int kUnlinkRequired = -1;
+        constexpr int kRebalanceRequired = -2;
+        constexpr int kNothingRequired = -3;
+
+        /**
+         * Result of one optimistic attempt: the value's prior state, or a signal that a
+         * concurrent rotation invalidated the attempt.
+         */
+        enum class Outcome { Absent, Present, Retry };
+
+        int compareKeys(double a, double b) {
+            return a < b ? -1 : (b < a ? 1 : 0);
+        }
+
+    }
+
+    /**
+     * @brief Node of a ConcurrentAVLTree. Every field but the key is read without locks.
+     */
+    struct ConcurrentNode {
+        const double key;                        ///< The value stored in the node.
+        std::atomic<int> height;                 ///< Height, possibly stale while rebalancing runs.
+        std::atomic<bool> present;               ///< False for routing nodes left behind by remove().
+        std::atomic<std::uint64_t> version{0};   ///< Changes whenever the node moves down or is unlinked.
+        std::atomic<ConcurrentNode*> parent;     ///< Pointer to the parent node.
+        std::atomic<ConcurrentNode*> left{nullptr};   ///< Pointer to the left child.
+        std::atomic<ConcurrentNode*> right{nullptr};  ///< Pointer to the right child.
+        SpinLock lock;                           ///< Held while the node's links are changed.
+
+        ConcurrentNode(double key, int height, bool present, ConcurrentNode* parent)
+            : key(key), height(height), present(present), parent(parent) {}
+
+        ConcurrentNode* child(int direction) const {
+            return direction < 0 ? left.load() : right.load();
+        }
+
+        void setChild(int direction, ConcurrentNode* node) {
+            if (direction < 0) left.store(node);
+            else right.store(node);
+        }
+    };
+
+    namespace {
+
+        int getHeight(const ConcurrentNode* node) { return node ? node->height.load() : 0; }
+
+        void waitUntilShrinkCompleted(const ConcurrentNode* node, std::uint64_t version) {
+            if ((version & kShrinking) == 0) return;
+            for (int spins = 0; node->version.load() == version; ++spins) {
+                if (spins > 64) std::this_thread::yield();
+            }
+        }
+
+        int nodeCondition(const ConcurrentNode* node) {
+            ConcurrentNode* nL = node->left.load();
+            ConcurrentNode* nR = node->right.load();
+            if ((!nL || !nR) && !node->present.load())
+                return kUnlinkRequired;
+
+            int hN = node->height.load();
+            int hL0 = getHeight(nL);
+            int hR0 = getHeight(nR);
+            int hNRepl = 1 + std::max(hL0, hR0);
+            int balance = hL0 - hR0;
+            if (balance < -1 || balance > 1)
+                return kRebalanceRequired;
+            return hN != hNRepl ? hNRepl : kNothingRequired;
+        }
+
+        ConcurrentNode* fixHeight_nl(ConcurrentNode* node) {
+            int condition = nodeCondition(node);
+            switch (condition) {
+                case kRebalanceRequired:
+                case kUnlinkRequired:
+                    return node;
+                case kNothingRequired:
+                    return nullptr;
+                default:
+                    node->height.store(condition);
+                    return node->parent.load();
+            }
+        }
+
+        bool attemptUnlink_nl(ConcurrentNode* parent, ConcurrentNode* node, EpochReclaimer& reclaimer) {
+            ConcurrentNode* parentL = parent->left.load();
+            ConcurrentNode* parentR = parent->right.load();
+            if (parentL != node && parentR != node)
+                return false;
+
+            ConcurrentNode* left = node->left.load();
+            ConcurrentNode* right = node->right.load();
+            if (left && right)
+                return false;
+
+            ConcurrentNode* splice = left ? left : right;
+            if (parentL == node) parent->left.store(splice);
+            else parent->right.store(splice);
+            if (splice) splice->parent.store(parent);
+
+            node->version.store(kUnlinked);
+            node->present.store(false);
+            reclaimer.retire(node);
+            return true;
+        }
+
+        /**
+         * Ancestors whose height a rotation changed, kept for later. A rotation that
+         * hands back a node for more repair has also changed its parent's subtree
+         * height. The walk up from that node can stop below the parent, so the
+         * parent is queued and checked separately.
+         */
+        using Deferred = std::vector<ConcurrentNode*>;
+
+        ConcurrentNode* repairLater(ConcurrentNode* next, ConcurrentNode* nParent, Deferred& deferred) {
+            deferred.push_back(nParent);
+            return next;
+        }
+
+        // The rotations below return the node that needs attention next, or nullptr.
+        // Locks held: the parent, the node, and every child they rewire.
+
+        ConcurrentNode* rotateRight_nl(ConcurrentNode* nParent, ConcurrentNode* n, ConcurrentNode* nL,
+                                       int hR, int hLL, ConcurrentNode* nLR, int hLR, Deferred& deferred) {
+            std::uint64_t nodeVersion = n->version.load();
+            ConcurrentNode* nPL = nParent->left.load();
+
+            n->version.store(beginShrink(nodeVersion));
+            n->left.store(nLR);
+            if (nLR) nLR->parent.store(n);
+            nL->right.store(n);
+            n->parent.store(nL);
+            if (nPL == n) nParent->left.store(nL);
+            else nParent->right.store(nL);
+            nL->parent.store(nParent);
+
+            // Re-read heights of moved subtrees only now. A concurrent repair that
+            // raised them earlier is counted here, and a later one will find the
+            // new parent.
+            hLR = getHeight(nLR);
+            int hNRepl = 1 + std::max(hLR, hR);
+            n->height.store(hNRepl);
+            nL->height.store(1 + std::max(hLL, hNRepl));
+            n->version.store(endShrink(nodeVersion));
+
+            int balN = hLR - hR;
+            if (balN < -1 || balN > 1) return repairLater(n, nParent, deferred);
+            if ((!nLR || hR == 0) && !n->present.load()) return repairLater(n, nParent, deferred);
+            int balL = hLL - hNRepl;
+            if (balL < -1 || balL > 1) return repairLater(nL, nParent, deferred);
+            if (hLL == 0 && !nL->present.load()) return repairLater(nL, nParent, deferred);
+            return fixHeight_nl(nParent);
+        }
+
+        ConcurrentNode* rotateLeft_nl(ConcurrentNode* nParent, ConcurrentNode* n, int hL,
+                                      ConcurrentNode* nR, ConcurrentNode* nRL, int hRL, int hRR, Deferred& deferred) {
+            std::uint64_t nodeVersion = n->version.load();
+            ConcurrentNode* nPL = nParent->left.load();
+
+            n->version.store(beginShrink(nodeVersion));
+            n->right.store(nRL);
+            if (nRL) nRL->parent.store(n);
+            nR->left.store(n);
+            n->parent.store(nR);
+            if (nPL == n) nParent->left.store(nR);
+            else nParent->right.store(nR);
+            nR->parent.store(nParent);
+
+            hRL = getHeight(nRL);  // See rotateRight_nl
+            int hNRepl = 1 + std::max(hL, hRL);
+            n->height.store(hNRepl);
+            nR->height.store(1 + std::max(hNRepl, hRR));
+            n->version.store(endShrink(nodeVersion));
+
+            int balN = hRL - hL;
+            if (balN < -1 || balN > 1) return repairLater(n, nParent, deferred);
+            if ((!nRL || hL == 0) && !n->present.load()) return repairLater(n, nParent, deferred);
+            int balR = hRR - hNRepl;
+            if (balR < -1 || balR > 1) return repairLater(nR, nParent, deferred);
+            if (hRR == 0 && !nR->present.load()) return repairLater(nR, nParent, deferred);
+            return fixHeight_nl(nParent);
+        }
+
+        ConcurrentNode* rotateRightOverLeft_nl(ConcurrentNode* nParent, ConcurrentNode* n, ConcurrentNode* nL,
+                                               int hR, int hLL, ConcurrentNode* nLR, int hLRL, Deferred& deferred) {
+            std::uint64_t nodeVersion = n->version.load();
+            std::uint64_t leftVersion = nL->version.load();
+            ConcurrentNode* nPL = nParent->left.load();
+            ConcurrentNode* nLRL = nLR->left.load();
+            ConcurrentNode* nLRR = nLR->right.load();
+
+            n->version.store(beginShrink(nodeVersion));
+            nL->version.store(beginShrink(leftVersion));
+
+            n->left.store(nLRR);
+            if (nLRR) nLRR->parent.store(n);
+            nL->right.store(nLRL);
+            if (nLRL) nLRL->parent.store(nL);
+            nLR->left.store(nL);
+            nL->parent.store(nLR);
+            nLR->right.store(n);
+            n->parent.store(nLR);
+            if (nPL == n) nParent->left.store(nLR);
+            else nParent->right.store(nLR);
+            nLR->parent.store(nParent);
+
+            int hLRR = getHeight(nLRR);  // See rotateRight_nl
+            hLRL = getHeight(nLRL);
+            int hNRepl = 1 + std::max(hLRR, hR);
+            n->height.store(hNRepl);
+            int hLRepl = 1 + std::max(hLL, hLRL);
+            nL->height.store(hLRepl);
+            nLR->height.store(1 + std::max(hLRepl, hNRepl));
+
+            n->version.store(endShrink(nodeVersion));
+            nL->version.store(endShrink(leftVersion));
+
+            // A routing nL that lost a child is not on the way up from n; queue it for unlinking
+            if ((!nLRL || hLL == 0) && !nL->present.load()) deferred.push_back(nL);
+
+            int balN = hLRR - hR;
+            if (balN < -1 || balN > 1) return repairLater(n, nParent, deferred);
+            if ((!nLRR || hR == 0) && !n->present.load()) return repairLater(n, nParent, deferred);
+            int balLR = hLRepl - hNRepl;
+            if (balLR < -1 || balLR > 1) return repairLater(nLR, nParent, deferred);
+            return fixHeight_nl(nParent);
+        }
+
+        ConcurrentNode* rotateLeftOverRight_nl(ConcurrentNode* nParent, ConcurrentNode* n, int hL,
+                                               ConcurrentNode* nR, ConcurrentNode* nRL, int hRR, int hRLR, Deferred& deferred) {
+            std::uint64_t nodeVersion = n->version.load();
+            std::uint64_t rightVersion = nR->version.load();
+            ConcurrentNode* nPL = nParent->left.load();
+            ConcurrentNode* nRLL = nRL->left.load();
+            ConcurrentNode* nRLR = nRL->right.load();
+
+            n->version.store(beginShrink(nodeVersion));
+            nR->version.store(beginShrink(rightVersion));
+
+            n->right.store(nRLL);
+            if (nRLL) nRLL->parent.store(n);
+            nR->left.store(nRLR);
+            if (nRLR) nRLR->parent.store(nR);
+            nRL->right.store(nR);
+            nR->parent.store(nRL);
+            nRL->left.store(n);
+            n->parent.store(nRL);
+            if (nPL == n) nParent->left.store(nRL);
+            else nParent->right.store(nRL);
+            nRL->parent.store(nParent);
+
+            int hRLL = getHeight(nRLL);  // See rotateRight_nl
+            hRLR = getHeight(nRLR);
+            int hNRepl = 1 + std::max(hL, hRLL);
+            n->height.store(hNRepl);
+            int hRRepl = 1 + std::max(hRLR, hRR);
+            nR->height.store(hRRepl);
+            nRL->height.store(1 + std::max(hNRepl, hRRepl));
+
+            n->version.store(endShrink(nodeVersion));
+            nR->version.store(endShrink(rightVersion));
+
+            if ((!nRLR || hRR == 0) && !nR->present.load()) deferred.push_back(nR);
+
+            int balN = hRLL - hL;
+            if (balN < -1 || balN > 1) return repairLater(n, nParent, deferred);
+            if ((!nRLL || hL == 0) && !n->present.load()) return repairLater(n, nParent, deferred);
+            int balRL = hRRepl - hNRepl;
+            if (balRL < -1 || balRL > 1) return repairLater(nRL, nParent, deferred);
+            return fixHeight_nl(nParent);
+        }
+
+        ConcurrentNode* rebalanceToLeft_nl(ConcurrentNode* nParent, ConcurrentNode* n, ConcurrentNode* nR, int hL0, Deferred& deferred);
+
+        ConcurrentNode* rebalanceToRight_nl(ConcurrentNode* nParent, ConcurrentNode* n, ConcurrentNode* nL, int hR0, Deferred& deferred) {
+            // The left side is too tall; rotate right, first rotating nL left if its inner child is the taller one
+            std::lock_guard<SpinLock> leftLock(nL->lock);
+            int hL = nL->height.load();
+            if (hL - hR0 <= 1)
+                return n;  // Retry with fresh heights
+
+            ConcurrentNode* nLR = nL->right.load();
+            int hLL0 = getHeight(nL->left.load());
+            int hLR0 = getHeight(nLR);
+            if (hLL0 >= hLR0)
+                return rotateRight_nl(nParent, n, nL, hR0, hLL0, nLR, hLR0, deferred);
+
+            {
+                std::lock_guard<SpinLock> innerLock(nLR->lock);
+                int hLR = nLR->height.load();
+                if (hLL0 >= hLR)
+                    return rotateRight_nl(nParent, n, nL, hR0, hLL0, nLR, hLR, deferred);
+
+                int hLRL = getHeight(nLR->left.load());
+                int balance = hLL0 - hLRL;
+                if (balance >= -1 && balance <= 1)
+                    return rotateRightOverLeft_nl(nParent, n, nL, hR0, hLL0, nLR, hLRL, deferred);
+            }
+            // A double rotation would leave nL unbalanced; fix nL alone and let n be balanced later
+            return rebalanceToLeft_nl(n, nL, nLR, hLL0, deferred);
+        }
+
+        ConcurrentNode* rebalanceToLeft_nl(ConcurrentNode* nParent, ConcurrentNode* n, ConcurrentNode* nR, int hL0, Deferred& deferred) {
+            std::lock_guard<SpinLock> rightLock(nR->lock);
+            int hR = nR->height.load();
+            if (hL0 - hR >= -1)
+                return n;  // Retry with fresh heights
+
+            ConcurrentNode* nRL = nR->left.load();
+            int hRL0 = getHeight(nRL);
+            int hRR0 = getHeight(nR->right.load());
+            if (hRR0 >= hRL0)
+                return rotateLeft_nl(nParent, n, hL0, nR, nRL, hRL0, hRR0, deferred);
+
+            {
+                std::lock_guard<SpinLock> innerLock(nRL->lock);
+                int hRL = nRL->height.load();
+                if (hRR0 >= hRL)
+                    return rotateLeft_nl(nParent, n, hL0, nR, nRL, hRL, hRR0, deferred);
+
+                int hRLR = getHeight(nRL->right.load());
+                int balance = hRR0 - hRLR;
+                if (balance >= -1 && balance <= 1)
+                    return rotateLeftOverRight_nl(nParent, n, hL0, nR, nRL, hRR0, hRLR, deferred);
+            }
+            return rebalanceToRight_nl(n, nR, nRL, hRR0, deferred);
+        }
+
+        ConcurrentNode* rebalance_nl(ConcurrentNode* nParent, ConcurrentNode* n, EpochReclaimer& reclaimer, Deferred& deferred) {
+            ConcurrentNode* nL = n->left.load();
+            ConcurrentNode* nR = n->right.load();
+            if ((!nL || !nR) && !n->present.load())
+                return attemptUnlink_nl(nParent, n, reclaimer) ? fixHeight_nl(nParent) : n;
+
+            int hN = n->height.load();
+            int hL0 = getHeight(nL);
+            int hR0 = getHeight(nR);
+            int hNRepl = 1 + std::max(hL0, hR0);
+            int balance = hL0 - hR0;
+            if (balance > 1)
+                return rebalanceToRight_nl(nParent, n, nL, hR0, deferred);
+            if (balance < -1)
+                return rebalanceToLeft_nl(nParent, n, nR, hL0, deferred);
+            if (hNRepl != hN) {
+                n->height.store(hNRepl);
+                return fixHeight_nl(nParent);
+            }
+            return nullptr;
+        }
+
+        void fixHeightAndRebalance(ConcurrentNode* node, EpochReclaimer& reclaimer) {
+            Deferred deferred;
+            while (true) {
+                // The holder has no parent, so each walk stops below it
+                if (!node || !node->parent.load() || isUnlinked(node->version.load())) {
+                    if (deferred.empty()) return;
+                    node = deferred.back();
+                    deferred.pop_back();
+                    continue;
+                }
+
+                int condition = nodeCondition(node);
+
+                if (condition != kUnlinkRequired && condition != kRebalanceRequired) {
+                    // Even when nothing seems required, confirm it under the lock: a rotation
+                    // holding it may be computing this node's height from a child height we
+                    // just changed, and nobody else would notice afterwards
+                    std::lock_guard<SpinLock> nodeLock(node->lock);
+                    node = fixHeight_nl(node);
+                } else {
+                    ConcurrentNode* nParent = node->parent.load();
+                    std::lock_guard<SpinLock> parentLock(nParent->lock);
+                    if (!isUnlinked(nParent->version.load()) && node->parent.load() == nParent) {
+                        std::lock_guard<SpinLock> nodeLock(node->lock);
+                        node = rebalance_nl(nParent, node, reclaimer, deferred);
+                    }
+                }
+            }
+        }
+
+        Outcome attemptGet(double key, const ConcurrentNode* node, int direction, std::uint64_t nodeVersion) {
+            while (true) {
+                const ConcurrentNode* child = node->child(direction);
+                if (!child)
+                    return node->version.load() != nodeVersion ? Outcome::Retry : Outcome::Absent;
+
+                int childDirection = compareKeys(key, child->key);
+                if (childDirection == 0)
+                    return child->present.load() ? Outcome::Present : Outcome::Absent;
+
+                std::uint64_t childVersion = child->version.load();
+                if (isShrinkingOrUnlinked(childVersion)) {
+                    waitUntilShrinkCompleted(child, childVersion);
+                    if (node->version.load() != nodeVersion) return Outcome::Retry;
+                } else if (child != node->child(direction)) {
+                    if (node->version.load() != nodeVersion) return Outcome::Retry;
+                } else {
+                    // The child was still linked under an unchanged node, so it covers the key
+                    if (node->version.load() != nodeVersion) return Outcome::Retry;
+                    Outcome outcome = attemptGet(key, child, childDirection, childVersion);
+                    if (outcome != Outcome::Retry) return outcome;
+                }
+            }
+        }
+
+        Outcome attemptNodeUpdate(bool insert, ConcurrentNode* parent, ConcurrentNode* node, EpochReclaimer& reclaimer) {
+            if (!insert) {
+                if (!node->present.load())
+                    return Outcome::Absent;
+                if (!node->left.load() || !node->right.load()) {
+                    ConcurrentNode* damaged;
+                    {
+                        std::lock_guard<SpinLock> parentLock(parent->lock);
+                        if (isUnlinked(parent->version.load()) || node->parent.load() != parent)
+                            return Outcome::Retry;
+                        {
+                            std::lock_guard<SpinLock> nodeLock(node->lock);
+                            if (!node->present.load())
+                                return Outcome::Absent;
+                            if (!attemptUnlink_nl(parent, node, reclaimer))
+                                return Outcome::Retry;
+                        }
+                        damaged = fixHeight_nl(parent);
+                    }
+                    fixHeightAndRebalance(damaged, reclaimer);
+                    return Outcome::Present;
+                }
+            }
+
+            std::lock_guard<SpinLock> nodeLock(node->lock);
+            if (isUnlinked(node->version.load()))
+                return Outcome::Retry;
+            bool prior = node->present.load();
+            // A removal that can now unlink the node must take the path above instead
+            if (!insert && (!node->left.load() || !node->right.load()))
+                return Outcome::Retry;
+            node->present.store(insert);
+            return prior ? Outcome::Present : Outcome::Absent;
+        }
+
+        Outcome attemptUpdate(double key, bool insert, ConcurrentNode* parent, ConcurrentNode* node,
+                              std::uint64_t nodeVersion, EpochReclaimer& reclaimer) {
+            int direction = compareKeys(key, node->key);
+            if (direction == 0)
+                return attemptNodeUpdate(insert, parent, node, reclaimer);
+
+            while (true) {
+                ConcurrentNode* child = node->child(direction);
+                if (node->version.load() != nodeVersion)
+                    return Outcome::Retry;
+
+                if (!child) {
+                    if (!insert)
+                        return Outcome::Absent;
+                    ConcurrentNode* leaf = new ConcurrentNode(key, 1, true, node);
+                    ConcurrentNode* damaged = nullptr;
+                    bool linked = false;
+                    {
+                        std::lock_guard<SpinLock> nodeLock(node->lock);
+                        if (node->version.load() != nodeVersion) {
+                            delete leaf;
+                            return Outcome::Retry;
+                        }
+                        if (!node->child(direction)) {
+                            node->setChild(direction, leaf);
+                            linked = true;
+                            damaged = fixHeight_nl(node);
+                        }
+                    }
+                    if (linked) {
+                        fixHeightAndRebalance(damaged, reclaimer);
+                        return Outcome::Absent;
+                    }
+                    delete leaf;  // Another thread linked a child first; descend into it
+                } else {
+                    std::uint64_t childVersion = child->version.load();
+                    if (isShrinkingOrUnlinked(childVersion)) {
+                        waitUntilShrinkCompleted(child, childVersion);
+                    } else if (child == node->child(direction)) {
+                        if (node->version.load() != nodeVersion) return Outcome::Retry;
+                        Outcome outcome = attemptUpdate(key, insert, node, child, childVersion, reclaimer);
+                        if (outcome != Outcome::Retry) return outcome;
+                    }
+                }
+            }
+        }
+
+        Outcome update(ConcurrentNode* holder, double key, bool insert, EpochReclaimer& reclaimer) {
+            while (true) {
+                ConcurrentNode* root = holder->right.load();
+                if (!root) {
+                    if (!insert)
+                        return Outcome::Absent;
+                    std::lock_guard<SpinLock> holderLock(holder->lock);
+                    if (!holder->right.load()) {
+                        holder->right.store(new ConcurrentNode(key, 1, true, holder));
+                        holder->height.store(2);
+                        return Outcome::Absent;
+                    }
+                } else {
+                    std::uint64_t version = root->version.load();
+                    if (isShrinkingOrUnlinked(version)) {
+                        waitUntilShrinkCompleted(root, version);
+                    } else if (root == holder->right.load()) {
+                        Outcome outcome = attemptUpdate(key, insert, holder, root, version, reclaimer);
+                        if (outcome != Outcome::Retry) return outcome;
+                    }
+                }
+            }
+        }
+
+    }
+
+    ConcurrentAVLTree::ConcurrentAVLTree() : holder(new ConcurrentNode(0, 1, false, nullptr)) {}
+
+    ConcurrentAVLTree::~ConcurrentAVLTree() {
+        std::vector<ConcurrentNode*> stack{holder};
+        while (!stack.empty()) {
+            ConcurrentNode* node = stack.back();
+            stack.pop_back();
+            if (ConcurrentNode* left = node->left.load()) stack.push_back(left);
+            if (ConcurrentNode* right = node->right.load()) stack.push_back(right);
+            delete node;
+        }
+    }
+
+    void ConcurrentAVLTree::insert(double val) {
+        if (!tryInsert(val))
+            throw DuplicateValueException(val);
+    }
+
+    bool ConcurrentAVLTree::tryInsert(double val) {
+        EpochReclaimer::Guard guard = reclaimer.pin();
+        if (update(holder, val, true, reclaimer) != Outcome::Absent)
+            return false;
+        count.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool ConcurrentAVLTree::remove(double val) {
+        EpochReclaimer::Guard guard = reclaimer.pin();
+        if (update(holder, val, false, reclaimer) != Outcome::Present)
+            return false;
+        count.fetch_sub(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    bool ConcurrentAVLTree::search(double val) const {
+        EpochReclaimer::Guard guard = reclaimer.pin();
+        while (true) {
+            const ConcurrentNode* root = holder->right.load();
+            if (!root)
+                return false;
+            int direction = compareKeys(val, root->key);
+            if (direction == 0)
+                return root->present.load();
+
+            std::uint64_t version = root->version.load();
+            if (isShrinkingOrUnlinked(version)) {
+                waitUntilShrinkCompleted(root, version);
+            } else if (root == holder->right.load()) {
+                Outcome outcome = attemptGet(val, root, direction, version);
+                if (outcome != Outcome::Retry) return outcome == Outcome::Present;
+            }
+        }
+    }
+
+    std::string ConcurrentAVLTree::toString(const FormatOptions& options) const {
+        std::string text;
+        StringSink sink(text);
+        ValueFormatter formatter(sink, options);
+        std::vector<const ConcurrentNode*> path;
+        const ConcurrentNode* node = holder->right.load();
+        while (node || !path.empty()) {
+            while (node) {
+                path.push_back(node);
+                node = node->left.load();
+            }
+            node = path.back();
+            path.pop_back();
+            if (node->present.load()) formatter.append(node->key);
+            node = node->right.load();
+        }
+        formatter.finish();
+        return text;
+    }
+
+}
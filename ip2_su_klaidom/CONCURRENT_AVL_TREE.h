@@ -0,0 +1,111 @@
+#ifndef CONCURRENT_AVL_TREE_H
+#define CONCURRENT_AVL_TREE_H
+
+#include "AVL_OUTPUT.h"
+#include "EPOCH_RECLAIMER.h"
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+namespace AVLProject {
+
+    struct ConcurrentNode;
+
+    /**
+     * @brief AVL tree that many threads can search, insert into and remove from at once.
+     *
+     * It follows the optimistic relaxed-balance tree of Bronson et al. (PPoPP 2010):
+     * - Every node has a version word. A rotation bumps the version of each node it
+     *   moves down.
+     * - search() takes no locks. It walks hand over hand and checks the parent's
+     *   version before trusting a child. If the version moved, it retries from the
+     *   last node that is still valid.
+     * - insert() locks only the parent of the new leaf. remove() locks the node and
+     *   its parent.
+     * - Rebalancing locks just the nodes a rotation rewires, from the top down.
+     * - A node with two children is removed by marking it as a routing node. It is
+     *   unlinked later, once it has at most one child.
+     *
+     * Unlinked nodes are handed to an EpochReclaimer, so a thread still walking
+     * through them never touches freed memory. Balance is relaxed while operations
+     * overlap, and it is restored as they finish.
+     */
+    class ConcurrentAVLTree {
+    public:
+        /**
+         * @brief Constructs an empty tree.
+         */
+        ConcurrentAVLTree();
+
+        /**
+         * @brief Frees all nodes. No other thread may still be using the tree.
+         */
+        ~ConcurrentAVLTree();
+
+        ConcurrentAVLTree(const ConcurrentAVLTree&) = delete;
+        ConcurrentAVLTree& operator=(const ConcurrentAVLTree&) = delete;
+
+        /**
+         * @brief Inserts a value.
+         * @param val The value to insert.
+         * @throws DuplicateValueException If the value is already stored.
+         */
+        void insert(double val);
+
+        /**
+         * @brief Inserts a value unless it is already stored.
+         *
+         * Concurrent writers race to insert the same value, so finding it already
+         * present is an ordinary outcome here rather than an error.
+         * @param val The value to insert.
+         * @return True if the value was inserted, false if it was already stored.
+         */
+        bool tryInsert(double val);
+
+        /**
+         * @brief Removes a value.
+         * @param val The value to remove.
+         * @return True if the value was stored, false otherwise.
+         */
+        bool remove(double val);
+
+        /**
+         * @brief Searches for a value without taking any lock.
+         * @param val The value to search for.
+         * @return True if the value is stored, false otherwise.
+         */
+        bool search(double val) const;
+
+        /**
+         * @brief Returns the number of values; only exact while no writer is running.
+         * @return The number of values.
+         */
+        std::size_t size() const { return count.load(std::memory_order_relaxed); }
+
+        /**
+         * @brief Returns the values in order; only call while no writer is running.
+         * @param options Separator, precision and notation to use.
+         * @return A string containing the in-order traversal.
+         */
+        std::string toString(const FormatOptions& options = FormatOptions()) const;
+
+        bool operator[](double val) const { return search(val); }
+
+        ConcurrentAVLTree& operator+=(double val) {
+            insert(val);
+            return *this;
+        }
+
+        ConcurrentAVLTree& operator-=(double val) {
+            remove(val);
+            return *this;
+        }
+
+    private:
+        ConcurrentNode* holder;               ///< Sentinel whose right child is the root.
+        std::atomic<std::size_t> count{0};    ///< Number of stored values.
+        mutable EpochReclaimer reclaimer;     ///< Frees unlinked nodes.
+    };
+
+}
+#endif // CONCURRENT_AVL_TREE_H
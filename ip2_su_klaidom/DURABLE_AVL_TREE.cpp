@@ -0,0 +1,450 @@
+#include "DURABLE_AVL_TREE.h"
+#include "AVL_SNAPSHOT.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <system_error>
+#include <utility>
+
+#if defined(__unix__) || defined(__APPLE__)
+#define AVL_JOURNAL_FSYNC 1
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace AVLProject {
+
+    namespace {
+
+        namespace fs = std::filesystem;
+
+        enum JournalOp : unsigned char {
+            kInsert = 1,
+            kRemove = 2,
+            kClear = 3
+        };
+
+        /// One change; the record number is implied by the position in the segment.
+        struct JournalRecord {
+            unsigned char op;          ///< A JournalOp.
+            unsigned char reserved[3]; ///< Zero.
+            std::uint32_t check;       ///< recordCheck() of the number, op and value.
+            double value;              ///< The value inserted or removed, 0 for kClear.
+        };
+        static_assert(sizeof(JournalRecord) == 16, "journal records are meant to take 16 bytes");
+
+        /// Starts every segment, so that a stray or renamed file is not replayed.
+        struct SegmentHeader {
+            char magic[8];         ///< Always kSegmentMagic.
+            std::uint64_t first;   ///< Number of the first record, as in the file name.
+        };
+        constexpr char kSegmentMagic[8] = {'A', 'V', 'L', 'J', 'R', 'N', 'L', '\0'};
+
+        std::uint32_t recordCheck(std::uint64_t record, unsigned char op, double val) {
+            // FNV-1a over 64-bit words, as in snapshotChecksum(); the number makes stale bytes fail
+            std::uint64_t bits;
+            std::memcpy(&bits, &val, sizeof bits);
+            std::uint64_t hash = 0xcbf29ce484222325ULL;
+            for (std::uint64_t word : {record, static_cast<std::uint64_t>(op), bits})
+                hash = (hash ^ word) * 0x100000001b3ULL;
+            return static_cast<std::uint32_t>(hash ^ (hash >> 32));
+        }
+
+        bool syncFile(std::FILE* file) {
+            if (std::fflush(file) != 0) return false;
+#if defined(AVL_JOURNAL_FSYNC) && defined(__linux__)
+            return ::fdatasync(::fileno(file)) == 0;  // Appends change the size, which fdatasync covers
+#elif defined(AVL_JOURNAL_FSYNC)
+            return ::fsync(::fileno(file)) == 0;
+#else
+            return true;
+#endif
+        }
+
+        void syncDirectory(const std::string& directory) {
+            // Makes created, renamed and deleted names durable, not just the file contents
+#ifdef AVL_JOURNAL_FSYNC
+            int descriptor = ::open(directory.c_str(), O_RDONLY);
+            if (descriptor >= 0) {
+                ::fsync(descriptor);
+                ::close(descriptor);
+            }
+#else
+            (void)directory;
+#endif
+        }
+
+        /// Reads the number out of names like "journal-42"; false for any other file.
+        bool parseName(const std::string& name, const std::string& prefix, std::uint64_t& number) {
+            if (name.size() <= prefix.size() || name.size() > prefix.size() + 20 || name.compare(0, prefix.size(), prefix) != 0)
+                return false;
+            if (!std::all_of(name.begin() + static_cast<std::ptrdiff_t>(prefix.size()), name.end(),
+                             [](char c) { return c >= '0' && c <= '9'; }))
+                return false;
+            number = std::stoull(name.substr(prefix.size()));
+            return true;
+        }
+
+        std::vector<std::pair<std::uint64_t, std::string>> listFiles(const std::string& directory, const std::string& prefix) {
+            std::vector<std::pair<std::uint64_t, std::string>> files;
+            for (const fs::directory_entry& entry : fs::directory_iterator(directory)) {
+                std::uint64_t number;
+                if (entry.is_regular_file() && parseName(entry.path().filename().string(), prefix, number))
+                    files.emplace_back(number, entry.path().string());
+            }
+            std::sort(files.begin(), files.end());
+            return files;
+        }
+
+    }
+
+    DurableAVLTree::DurableAVLTree(const std::string& directory, DurabilityOptions options)
+        : directory(directory), options(options), values(options.engine) {
+        std::error_code error;
+        fs::create_directories(directory, error);
+        if (error)
+            throw JournalException(directory, error.message());
+        recover();
+        if (options.sync == SyncMode::Interval) {
+            flusher = std::thread([this] {
+                std::unique_lock<std::mutex> lock(journalMutex);
+                while (!stopping) {
+                    synced.wait_for(lock, this->options.syncInterval, [this] { return stopping; });
+                    if (!writing && failure.empty() && (!pending.empty() || rotateAt))
+                        writeBatch(lock);
+                }
+            });
+        }
+    }
+
+    DurableAVLTree::~DurableAVLTree() {
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+            stopping = true;
+        }
+        synced.notify_all();
+        if (flusher.joinable()) flusher.join();
+        {
+            std::lock_guard<std::mutex> lock(checkpointMutex);
+            if (checkpointer.joinable()) checkpointer.join();
+        }
+        try {
+            flush();
+        } catch (const JournalException&) {
+            // Nothing left to report it to; recovery ends at the last record that was synced
+        }
+        if (segment) std::fclose(segment);
+    }
+
+    std::string DurableAVLTree::segmentPath(std::uint64_t first) const {
+        return (fs::path(directory) / ("journal-" + std::to_string(first))).string();
+    }
+
+    std::string DurableAVLTree::checkpointPath(std::uint64_t record) const {
+        return (fs::path(directory) / ("checkpoint-" + std::to_string(record))).string();
+    }
+
+    void DurableAVLTree::recover() {
+        // The newest checkpoint that loads; an older one is only useful while the journal still reaches back to it
+        std::vector<std::pair<std::uint64_t, std::string>> checkpoints = listFiles(directory, "checkpoint-");
+        for (auto it = checkpoints.rbegin(); it != checkpoints.rend(); ++it) {
+            try {
+                AVLTree loaded = AVLTree::load(it->second);
+                values = options.engine == StorageEngine::Linked
+                    ? std::move(loaded)
+                    : AVLTree(loaded.begin(), loaded.end(), DuplicatePolicy::Reject, options.engine);
+                checkpointed = lastRecord = saved = it->first;
+                break;
+            } catch (const SnapshotException&) {
+            }
+        }
+
+        std::vector<std::pair<std::uint64_t, std::string>> segments = listFiles(directory, "journal-");
+        for (std::size_t i = 0; i < segments.size(); ++i) {
+            const std::string& path = segments[i].second;
+            bool last = i + 1 == segments.size();
+            std::ifstream file(path, std::ios::binary);
+            std::vector<char> bytes((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+
+            SegmentHeader header;
+            if (bytes.size() < sizeof header) {
+                if (!last) throw JournalException(path, "truncated segment header");
+                std::error_code error;
+                fs::remove(path, error);  // Torn while it was being created, so it holds no records
+                break;
+            }
+            std::memcpy(&header, bytes.data(), sizeof header);
+            if (std::memcmp(header.magic, kSegmentMagic, sizeof kSegmentMagic) != 0 || header.first != segments[i].first)
+                throw JournalException(path, "not a journal segment");
+            if (header.first > lastRecord + 1)
+                throw JournalException(path, "records " + std::to_string(lastRecord + 1) + " to " +
+                                       std::to_string(header.first - 1) + " are missing");
+
+            std::size_t offset = sizeof header;
+            std::uint64_t record = header.first;
+            for (; offset + sizeof(JournalRecord) <= bytes.size(); offset += sizeof(JournalRecord), ++record) {
+                JournalRecord entry;
+                std::memcpy(&entry, bytes.data() + offset, sizeof entry);
+                if (entry.check != recordCheck(record, entry.op, entry.value) || entry.op < kInsert || entry.op > kClear)
+                    break;
+                if (record <= lastRecord) continue;  // Already in the checkpoint
+                if (entry.op == kInsert) {
+                    try {
+                        values.insert(entry.value);
+                    } catch (const DuplicateValueException&) {
+                        throw JournalException(path, "record " + std::to_string(record) + " inserts a stored value");
+                    }
+                } else if (entry.op == kRemove) {
+                    values.remove(entry.value);
+                } else {
+                    !values;
+                }
+                changes.push_back({entry.op, entry.value});
+                lastRecord = record;
+            }
+            if (offset < bytes.size()) {
+                // A crash tore the last batch; later runs append to a new segment, so the tail is cut off
+                if (!last) throw JournalException(path, "damaged record " + std::to_string(record));
+                std::error_code error;
+                fs::resize_file(path, offset, error);
+                if (error) throw JournalException(path, error.message());
+            }
+        }
+
+        durable = lastRecord;
+        pendingFirst = lastRecord + 1;
+        segmentFirst = lastRecord + 1;
+        segment = openSegment(segmentFirst);
+    }
+
+    std::FILE* DurableAVLTree::openSegment(std::uint64_t first) const {
+        std::string path = segmentPath(first);
+        std::FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file)
+            throw JournalException(path, std::strerror(errno));
+        SegmentHeader header = {};
+        std::memcpy(header.magic, kSegmentMagic, sizeof kSegmentMagic);
+        header.first = first;
+        if (std::fwrite(&header, sizeof header, 1, file) != 1 || !syncFile(file)) {
+            std::fclose(file);
+            throw JournalException(path, "cannot write the segment header");
+        }
+        syncDirectory(directory);
+        return file;
+    }
+
+    void DurableAVLTree::throwIfFailed() {
+        std::lock_guard<std::mutex> lock(journalMutex);
+        if (!failure.empty())
+            throw JournalException(segmentPath(segmentFirst), failure);
+    }
+
+    std::uint64_t DurableAVLTree::append(unsigned char op, double val) {
+        std::uint64_t record = ++lastRecord;
+        JournalRecord entry = {op, {0, 0, 0}, recordCheck(record, op, val), val};
+        {
+            std::lock_guard<std::mutex> lock(journalMutex);
+            const unsigned char* bytes = reinterpret_cast<const unsigned char*>(&entry);
+            pending.insert(pending.end(), bytes, bytes + sizeof entry);
+        }
+        changes.push_back({op, val});
+        if (options.checkpointEvery != 0 && record - checkpointed >= options.checkpointEvery)
+            startCheckpoint();
+        return record;
+    }
+
+    void DurableAVLTree::waitUntilSynced(std::uint64_t record) {
+        std::unique_lock<std::mutex> lock(journalMutex);
+        while (durable < record) {
+            if (!failure.empty())
+                throw JournalException(segmentPath(segmentFirst), failure);
+            if (writing)
+                synced.wait(lock);  // The writer's batch may not hold our record; if not, we write the next one
+            else
+                writeBatch(lock);
+        }
+    }
+
+    void DurableAVLTree::writeBatch(std::unique_lock<std::mutex>& lock) {
+        // Everyone who appended before now is carried by this one write and sync
+        writing = true;
+        std::vector<unsigned char> batch;
+        batch.swap(pending);
+        std::uint64_t first = pendingFirst;
+        std::uint64_t count = batch.size() / sizeof(JournalRecord);
+        pendingFirst += count;
+        std::uint64_t rotation = std::exchange(rotateAt, 0);
+        std::FILE* file = segment;
+        lock.unlock();
+
+        // Records before the rotation go to the old segment, which is synced and closed first
+        std::size_t split = rotation ? static_cast<std::size_t>(std::min(std::max(rotation, first) - first, count)) : count;
+        std::size_t splitBytes = split * sizeof(JournalRecord);
+        std::string error;
+        std::FILE* next = nullptr;
+        if (std::fwrite(batch.data(), 1, splitBytes, file) != splitBytes || !syncFile(file)) {
+            error = "write failed";
+        } else if (rotation) {
+            try {
+                next = openSegment(rotation);
+                std::size_t rest = batch.size() - splitBytes;
+                if (std::fwrite(batch.data() + splitBytes, 1, rest, next) != rest || !syncFile(next))
+                    error = "write failed";
+            } catch (const JournalException& e) {
+                error = e.what();
+            }
+        }
+
+        lock.lock();
+        if (next) {
+            std::fclose(segment);
+            segment = next;
+            segmentFirst = rotation;
+        }
+        if (error.empty())
+            durable = first + count - 1;
+        else
+            failure = error;
+        writing = false;
+        synced.notify_all();
+    }
+
+    void DurableAVLTree::insert(double val) {
+        std::uint64_t record;
+        {
+            std::unique_lock<std::shared_mutex> lock(treeMutex);
+            throwIfFailed();
+            values.insert(val);
+            record = append(kInsert, val);
+        }
+        if (options.sync == SyncMode::EveryWrite) waitUntilSynced(record);
+    }
+
+    bool DurableAVLTree::remove(double val) {
+        std::uint64_t record;
+        {
+            std::unique_lock<std::shared_mutex> lock(treeMutex);
+            throwIfFailed();
+            if (!values.search(val)) return false;
+            values.remove(val);
+            record = append(kRemove, val);
+        }
+        if (options.sync == SyncMode::EveryWrite) waitUntilSynced(record);
+        return true;
+    }
+
+    void DurableAVLTree::clear() {
+        std::uint64_t record;
+        {
+            std::unique_lock<std::shared_mutex> lock(treeMutex);
+            throwIfFailed();
+            !values;
+            record = append(kClear, 0.0);
+        }
+        if (options.sync == SyncMode::EveryWrite) waitUntilSynced(record);
+    }
+
+    bool DurableAVLTree::search(double val) const {
+        std::shared_lock<std::shared_mutex> lock(treeMutex);
+        return values.search(val);
+    }
+
+    std::size_t DurableAVLTree::size() const {
+        std::shared_lock<std::shared_mutex> lock(treeMutex);
+        return values.size();
+    }
+
+    AVLTree DurableAVLTree::tree() const {
+        std::shared_lock<std::shared_mutex> lock(treeMutex);
+        return values;
+    }
+
+    std::uint64_t DurableAVLTree::sequence() const {
+        std::shared_lock<std::shared_mutex> lock(treeMutex);
+        return lastRecord;
+    }
+
+    void DurableAVLTree::flush() {
+        waitUntilSynced(sequence());
+    }
+
+    void DurableAVLTree::checkpoint() {
+        std::unique_lock<std::shared_mutex> lock(treeMutex);
+        if (lastRecord != checkpointed) startCheckpoint();
+    }
+
+    void DurableAVLTree::wait_for_checkpoint() {
+        std::lock_guard<std::mutex> lock(checkpointMutex);
+        if (checkpointer.joinable()) checkpointer.join();
+        if (checkpointError) std::rethrow_exception(std::exchange(checkpointError, nullptr));
+    }
+
+    void DurableAVLTree::startCheckpoint() {
+        // Called with treeMutex held exclusively, so changes end exactly at lastRecord
+        if (!checkpointDone.load(std::memory_order_acquire)) return;  // The next write tries again
+        std::unique_lock<std::mutex> threadLock(checkpointMutex, std::try_to_lock);
+        if (!threadLock.owns_lock()) return;
+        if (checkpointer.joinable()) checkpointer.join();
+
+        // Hands the changes over without copying them; after a failed checkpoint the old ones are still there
+        std::uint64_t previous = std::exchange(checkpointed, lastRecord);
+        if (unsaved.empty()) {
+            unsaved.swap(changes);
+        } else {
+            unsaved.insert(unsaved.end(), changes.begin(), changes.end());
+            changes.clear();
+        }
+        checkpointDone.store(false, std::memory_order_relaxed);
+        try {
+            checkpointer = std::thread([this, record = lastRecord] {
+                try {
+                    writeCheckpoint(record);
+                } catch (...) {
+                    checkpointError = std::current_exception();
+                }
+                checkpointDone.store(true, std::memory_order_release);
+            });
+        } catch (const std::system_error&) {
+            // No thread to spare; the journal keeps every record until a later checkpoint succeeds
+            checkpointed = previous;
+            changes.swap(unsaved);
+            checkpointDone.store(true, std::memory_order_relaxed);
+            return;
+        }
+        std::lock_guard<std::mutex> lock(journalMutex);
+        rotateAt = lastRecord + 1;
+    }
+
+    void DurableAVLTree::writeCheckpoint(std::uint64_t record) {
+        // Rebuilt from the last checkpoint rather than copied from values, which writers keep changing
+        AVLTree image = saved ? AVLTree::load(checkpointPath(saved)) : AVLTree();
+        for (const Change& change : unsaved) {
+            if (change.op == kInsert)
+                image.insert(change.value);
+            else if (change.op == kRemove)
+                image.remove(change.value);
+            else
+                !image;
+        }
+        image.save(checkpointPath(record));
+        syncDirectory(directory);
+        saved = record;
+        unsaved.clear();
+        syncDirectory(directory);
+
+        // Older checkpoints go, and so does every segment whose successor starts within this
+        // checkpoint, since all of its records are in it. Going by the files rather than by
+        // segmentFirst also catches a segment that a rotation in flight is just closing.
+        std::error_code error;
+        for (const auto& file : listFiles(directory, "checkpoint-"))
+            if (file.first < record) fs::remove(file.second, error);
+        std::vector<std::pair<std::uint64_t, std::string>> segments = listFiles(directory, "journal-");
+        for (std::size_t i = 0; i + 1 < segments.size(); ++i)
+            if (segments[i + 1].first <= record + 1) fs::remove(segments[i].second, error);
+        syncDirectory(directory);
+    }
+
+}
@@ -0,0 +1,219 @@
+#ifndef DURABLE_AVL_TREE_H
+#define DURABLE_AVL_TREE_H
+
+#include "AVL_TREE.h"
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <shared_mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace AVLProject {
+
+    /**
+     * @brief Exception thrown when the journal of a DurableAVLTree cannot be written or replayed.
+     */
+    class JournalException : public std::runtime_error {
+    public:
+        /**
+         * @brief Constructs a JournalException for a file.
+         * @param path The journal file or directory.
+         * @param reason What went wrong.
+         */
+        JournalException(const std::string& path, const std::string& reason)
+            : std::runtime_error("Journal " + path + ": " + reason) {}
+    };
+
+    /**
+     * @brief When a write to a DurableAVLTree counts as done.
+     */
+    enum class SyncMode {
+        EveryWrite,  ///< Once its record is on disk; writers that overlap share one fsync.
+        Interval     ///< Once its record is buffered; a background thread syncs every syncInterval.
+    };
+
+    /**
+     * @brief Settings of a DurableAVLTree.
+     */
+    struct DurabilityOptions {
+        SyncMode sync = SyncMode::EveryWrite;                ///< When writes return.
+        std::chrono::milliseconds syncInterval{10};          ///< With SyncMode::Interval, the most a crash can lose.
+        std::uint64_t checkpointEvery = 1000000;             ///< Journal records between checkpoints, 0 for none; each also takes 16 bytes until then.
+        StorageEngine engine = StorageEngine::Linked;        ///< How the tree in memory is stored.
+    };
+
+    /**
+     * @brief An AVLTree whose changes survive a crash.
+     *
+     * Every insert(), remove() and clear() that changes the tree appends a 16-byte
+     * record to a journal in the tree's directory. Records are buffered and written
+     * in batches: with SyncMode::EveryWrite the first waiting writer writes and syncs
+     * everything buffered so far, so concurrent writers share one fsync (group commit).
+     *
+     * Every checkpointEvery records, the tree writes a checkpoint: a snapshot of the
+     * sorted values (see AVLTree::save) named after the last record it contains. The
+     * tree keeps the changes made since the last checkpoint in memory; a background
+     * thread loads that checkpoint, applies them and saves the result, so writers never
+     * wait for the checkpoint or copy the tree for it. While it runs, the thread holds a
+     * second copy of the values. The journal starts a new segment at each checkpoint,
+     * and segments that a finished checkpoint covers are deleted.
+     *
+     * Opening a directory recovers its contents: the newest valid checkpoint is loaded
+     * and the journal records after it are replayed. A record torn by a crash ends the
+     * journal. Reads and writes may come from several threads; writes are serialized.
+     */
+    class DurableAVLTree {
+    public:
+        /**
+         * @brief Opens a durable tree, recovering what the directory holds.
+         * @param directory Where the checkpoints and the journal live; created if missing.
+         * @param options When writes return, how often to checkpoint, and the storage engine.
+         * @throws JournalException If the journal is damaged before its end or cannot be created.
+         */
+        explicit DurableAVLTree(const std::string& directory, DurabilityOptions options = DurabilityOptions());
+
+        /**
+         * @brief Syncs the journal and waits for a running checkpoint.
+         */
+        ~DurableAVLTree();
+
+        DurableAVLTree(const DurableAVLTree&) = delete;
+        DurableAVLTree& operator=(const DurableAVLTree&) = delete;
+
+        /**
+         * @brief Inserts a value and journals the insert.
+         * @param val The value to insert.
+         * @throws DuplicateValueException If the value is already stored; nothing is journaled.
+         * @throws JournalException If the record cannot be written. The value stays in
+         *         memory, but a crash may lose it.
+         */
+        void insert(double val);
+
+        /**
+         * @brief Removes a value and journals the removal.
+         * @param val The value to remove.
+         * @return True if the value was stored, false otherwise; only removals are journaled.
+         * @throws JournalException If the record cannot be written.
+         */
+        bool remove(double val);
+
+        /**
+         * @brief Removes every value and journals that.
+         * @throws JournalException If the record cannot be written.
+         */
+        void clear();
+
+        /**
+         * @brief Searches for a value.
+         * @param val The value to search for.
+         * @return True if the value is stored, false otherwise.
+         */
+        bool search(double val) const;
+
+        /**
+         * @brief Returns the number of stored values.
+         * @return The number of values.
+         */
+        std::size_t size() const;
+
+        /**
+         * @brief Returns a copy of the tree, which shares its nodes until either side changes.
+         * @return The current contents.
+         */
+        AVLTree tree() const;
+
+        /**
+         * @brief Returns the number of the last journal record, which counts every change ever made.
+         * @return The sequence number, 0 before the first change.
+         */
+        std::uint64_t sequence() const;
+
+        /**
+         * @brief Waits until every change made so far is on disk.
+         * @throws JournalException If the journal cannot be written.
+         */
+        void flush();
+
+        /**
+         * @brief Starts a checkpoint on a background thread unless one is running.
+         */
+        void checkpoint();
+
+        /**
+         * @brief Waits for a running checkpoint to finish.
+         * @throws SnapshotException If the last checkpoint could not be written; the
+         *         journal still holds everything it would have covered.
+         */
+        void wait_for_checkpoint();
+
+        bool operator[](double val) const { return search(val); }
+        void operator!() { clear(); }
+
+        DurableAVLTree& operator+=(double val) {
+            insert(val);
+            return *this;
+        }
+
+        DurableAVLTree& operator-=(double val) {
+            remove(val);
+            return *this;
+        }
+
+    private:
+        std::string directory;        ///< Holds the checkpoints and the journal segments.
+        DurabilityOptions options;    ///< As given at construction.
+
+        mutable std::shared_mutex treeMutex;  ///< Exclusive for writers, shared for readers.
+        AVLTree values;                       ///< The contents; guarded by treeMutex.
+        std::uint64_t lastRecord = 0;         ///< Number of the last journaled change; guarded by treeMutex.
+        std::uint64_t checkpointed = 0;       ///< Record the newest checkpoint started at; guarded by treeMutex.
+
+        /// A journaled change, kept for the next checkpoint.
+        struct Change {
+            unsigned char op;  ///< As in the journal record.
+            double value;      ///< The value inserted or removed, 0 for a clear.
+        };
+        std::deque<Change> changes;           ///< Changes after checkpointed; guarded by treeMutex.
+
+        std::mutex journalMutex;              ///< Guards the fields below.
+        std::condition_variable synced;       ///< Signalled when a batch is on disk or the flusher should stop.
+        std::vector<unsigned char> pending;   ///< Records not yet handed to the file.
+        std::uint64_t pendingFirst = 1;       ///< Number of the first record in pending.
+        std::uint64_t durable = 0;            ///< Every record up to this one is on disk.
+        std::uint64_t rotateAt = 0;           ///< First record of the next segment, 0 if no new one is due.
+        bool writing = false;                 ///< A writer is writing a batch outside the lock.
+        bool stopping = false;                ///< Tells the flusher thread to finish.
+        std::string failure;                  ///< Why the journal stopped, empty while it works.
+        std::FILE* segment = nullptr;         ///< The open journal segment.
+        std::uint64_t segmentFirst = 1;       ///< Number of the first record the open segment may hold.
+
+        std::thread flusher;                  ///< Syncs the journal with SyncMode::Interval.
+        std::mutex checkpointMutex;           ///< Guards the checkpointer thread object and its error.
+        std::thread checkpointer;             ///< Writes the running checkpoint.
+        std::atomic<bool> checkpointDone{true};   ///< The checkpointer has finished.
+        std::exception_ptr checkpointError;   ///< What the last checkpoint threw; read after joining.
+        std::uint64_t saved = 0;              ///< Record of the newest checkpoint on disk, 0 for none; used by the checkpointer thread.
+        std::deque<Change> unsaved;           ///< Changes after saved that the checkpointer has taken over; used by it.
+
+        void recover();
+        void throwIfFailed();
+        std::uint64_t append(unsigned char op, double val);
+        void waitUntilSynced(std::uint64_t record);
+        void writeBatch(std::unique_lock<std::mutex>& lock);
+        std::FILE* openSegment(std::uint64_t first) const;
+        void startCheckpoint();
+        void writeCheckpoint(std::uint64_t record);
+        std::string segmentPath(std::uint64_t first) const;
+        std::string checkpointPath(std::uint64_t record) const;
+    };
+
+}
+#endif // DURABLE_AVL_TREE_H
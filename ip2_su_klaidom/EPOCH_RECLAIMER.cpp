@@ -0,0 +1,67 @@
+#include "EPOCH_RECLAIMER.h"
+#include <functional>
+#include <thread>
+
+namespace AVLProject {
+
+    EpochReclaimer::~EpochReclaimer() {
+        for (const Retired& entry : retired)
+            entry.deleter(entry.object);
+    }
+
+    EpochReclaimer::Guard EpochReclaimer::pin() {
+        // Start probing at a per-thread slot so that threads rarely compete for the same one
+        static thread_local const std::size_t home = std::hash<std::thread::id>()(std::this_thread::get_id());
+        for (std::size_t attempt = 0;; ++attempt) {
+            std::atomic<std::uint64_t>& slot = slots[(home + attempt) % kSlots].epoch;
+            std::uint64_t expected = kIdle;
+            std::uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+            if (slot.load(std::memory_order_relaxed) == kIdle &&
+                slot.compare_exchange_strong(expected, epoch, std::memory_order_seq_cst))
+                return Guard(&slot);
+            if (attempt % kSlots == kSlots - 1)
+                std::this_thread::yield();
+        }
+    }
+
+    void EpochReclaimer::retire(void* object, void (*deleter)(void*)) {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        retired.push_back({object, deleter, globalEpoch.load(std::memory_order_seq_cst)});
+        if (++sinceCollect >= kCollectBatch)
+            collectLocked();
+    }
+
+    void EpochReclaimer::collect() {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        collectLocked();
+    }
+
+    std::size_t EpochReclaimer::pending() const {
+        std::lock_guard<std::mutex> lock(retiredMutex);
+        return retired.size();
+    }
+
+    void EpochReclaimer::collectLocked() {
+        sinceCollect = 0;
+        std::uint64_t epoch = globalEpoch.load(std::memory_order_seq_cst);
+        bool quiescent = true;
+        for (const Slot& slot : slots) {
+            std::uint64_t announced = slot.epoch.load(std::memory_order_seq_cst);
+            if (announced != kIdle && announced != epoch) {
+                quiescent = false;
+                break;
+            }
+        }
+        if (quiescent)
+            globalEpoch.store(++epoch, std::memory_order_seq_cst);
+
+        // Entries were appended in epoch order, so the safe ones form a prefix
+        std::size_t safe = 0;
+        while (safe < retired.size() && retired[safe].epoch + 2 <= epoch) {
+            retired[safe].deleter(retired[safe].object);
+            ++safe;
+        }
+        retired.erase(retired.begin(), retired.begin() + static_cast<std::ptrdiff_t>(safe));
+    }
+
+}
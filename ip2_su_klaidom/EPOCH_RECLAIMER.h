@@ -0,0 +1,134 @@
+#ifndef EPOCH_RECLAIMER_H
+#define EPOCH_RECLAIMER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <vector>
+
+namespace AVLProject {
+
+    /**
+     * @brief Epoch-based reclamation for nodes that lock-free readers may still be using.
+     *
+     * A reader pins the current epoch with a Guard before it loads any shared pointer,
+     * and unpins it when it is done. A writer unlinks a node first and retires it
+     * second. A retired node is freed only after the global epoch has advanced twice.
+     * The epoch only advances once every pinned reader has seen the current one, so
+     * no reader can still hold a reference to the node at that point.
+     *
+     * Pinning is wait-free unless all kSlots slots are taken; then it yields until
+     * one is released. Retiring and collecting take a mutex, which only writers contend on.
+     */
+    class EpochReclaimer {
+    public:
+        static constexpr std::size_t kSlots = 128;  ///< Readers that can be pinned at the same time.
+
+        /**
+         * @brief RAII pin of the current epoch; nodes retired while it is held stay valid.
+         */
+        class Guard {
+        private:
+            friend class EpochReclaimer;
+
+            std::atomic<std::uint64_t>* slot = nullptr;  ///< Announced epoch, released on destruction.
+
+            explicit Guard(std::atomic<std::uint64_t>* slot) : slot(slot) {}
+
+        public:
+            Guard() = default;
+            ~Guard() { release(); }
+
+            Guard(const Guard&) = delete;
+            Guard& operator=(const Guard&) = delete;
+
+            Guard(Guard&& other) noexcept : slot(other.slot) { other.slot = nullptr; }
+
+            Guard& operator=(Guard&& other) noexcept {
+                if (this != &other) {
+                    release();
+                    slot = other.slot;
+                    other.slot = nullptr;
+                }
+                return *this;
+            }
+
+            /**
+             * @brief Unpins early; the guard is empty afterwards.
+             */
+            void release() noexcept {
+                if (slot) slot->store(kIdle, std::memory_order_release);
+                slot = nullptr;
+            }
+        };
+
+        EpochReclaimer() = default;
+
+        /**
+         * @brief Frees every retired node. No guard may still be held.
+         */
+        ~EpochReclaimer();
+
+        EpochReclaimer(const EpochReclaimer&) = delete;
+        EpochReclaimer& operator=(const EpochReclaimer&) = delete;
+
+        /**
+         * @brief Pins the current epoch for the calling thread.
+         * @return The guard; shared pointers may be loaded while it is held.
+         */
+        Guard pin();
+
+        /**
+         * @brief Schedules an unlinked node for deletion once no reader can reach it.
+         * @param object The node; it must no longer be reachable from shared pointers.
+         * @param deleter Frees the node.
+         */
+        void retire(void* object, void (*deleter)(void*));
+
+        /**
+         * @brief Schedules an unlinked node allocated with new for deletion.
+         * @param object The node; it must no longer be reachable from shared pointers.
+         */
+        template <typename T>
+        void retire(T* object) {
+            retire(const_cast<void*>(static_cast<const void*>(object)),
+                   [](void* p) { delete static_cast<T*>(p); });
+        }
+
+        /**
+         * @brief Advances the epoch if possible and frees the nodes that became safe.
+         */
+        void collect();
+
+        /**
+         * @brief Returns the number of retired nodes that are not freed yet.
+         * @return The number of pending nodes.
+         */
+        std::size_t pending() const;
+
+    private:
+        static constexpr std::uint64_t kIdle = ~std::uint64_t(0);  ///< Slot value when no reader holds it.
+        static constexpr std::size_t kCollectBatch = 256;          ///< Retirements between automatic collections.
+
+        struct alignas(64) Slot {
+            std::atomic<std::uint64_t> epoch{kIdle};  ///< Epoch announced by the reader holding the slot.
+        };
+
+        struct Retired {
+            void* object;             ///< The unlinked node.
+            void (*deleter)(void*);   ///< Frees the node.
+            std::uint64_t epoch;      ///< Global epoch when the node was retired.
+        };
+
+        std::atomic<std::uint64_t> globalEpoch{0};  ///< Current epoch.
+        Slot slots[kSlots];                         ///< Reader announcements.
+        mutable std::mutex retiredMutex;            ///< Guards retired and the epoch advance.
+        std::vector<Retired> retired;               ///< Nodes waiting for two epoch advances.
+        std::size_t sinceCollect = 0;               ///< Retirements since the last collection.
+
+        void collectLocked();
+    };
+
+}
+#endif // EPOCH_RECLAIMER_H
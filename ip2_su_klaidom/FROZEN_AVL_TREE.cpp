@@ -0,0 +1,203 @@
+#include "FROZEN_AVL_TREE.h"
+#include "AVL_TREE.h"
+#include <cstdint>
+#include <new>
+#include <stdexcept>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define AVL_FROZEN_AVX2 1
+#include <immintrin.h>
+#endif
+
+namespace AVLProject {
+
+    namespace {
+
+        constexpr std::size_t kCacheLine = 64;                               ///< Alignment of the slot array.
+        constexpr std::size_t kPrefetchStride = kCacheLine / sizeof(double); ///< Slot k's descendants three levels down.
+        constexpr std::size_t kGroup = 8;                                    ///< Lookups interleaved by the scalar batch path.
+
+        inline void prefetch(const double* address) {
+#ifdef __GNUC__
+            __builtin_prefetch(address);
+#else
+            (void)address;
+#endif
+        }
+
+        inline int countTrailingZeros(std::uint64_t word) {
+#ifdef __GNUC__
+            return __builtin_ctzll(word);
+#else
+            int zeros = 0;
+            for (; (word & 1) == 0; word >>= 1) ++zeros;
+            return zeros;
+#endif
+        }
+
+        /**
+         * Takes the final, partly filled level's step and decodes the path. Lanes that
+         * already ran past the array step right, which the decoding then undoes: the
+         * result is the slot of the last left turn, the lower bound, or 0 if there is none.
+         */
+        inline std::size_t finishDescent(const double* slots, std::size_t count, std::size_t k, double val) {
+            std::size_t past = k > count;
+            const double* last = slots + (past ? 0 : k);
+            k = 2 * k + (past | (*last < val));
+            return k >> (countTrailingZeros(~static_cast<std::uint64_t>(k)) + 1);
+        }
+
+        inline std::size_t descend(const double* slots, std::size_t count, int fullLevels, double val) {
+            std::size_t k = 1;
+            for (int level = 0; level < fullLevels; ++level) {
+                prefetch(slots + k * kPrefetchStride);
+                k = 2 * k + (slots[k] < val);
+            }
+            return finishDescent(slots, count, k, val);
+        }
+
+        inline bool found(const double* slots, std::size_t slot, double val) {
+            return slot != 0 && slots[slot] == val;
+        }
+
+        template <typename InputIt>
+        void fillInOrder(double* slots, std::size_t count, InputIt first) {
+            if (count == 0) return;
+            // Visit the implicit tree in order: slot k has children 2k and 2k+1
+            std::size_t k = 1;
+            while (2 * k <= count) k *= 2;
+            for (std::size_t i = 0; i < count; ++i, ++first) {
+                slots[k] = *first;
+                if (2 * k + 1 <= count) {
+                    k = 2 * k + 1;
+                    while (2 * k <= count) k *= 2;
+                } else {
+                    while (k & 1) k >>= 1;
+                    k >>= 1;
+                }
+            }
+        }
+
+        void searchManyScalar(const double* slots, std::size_t count, int fullLevels,
+                              const double* keys, std::size_t keyCount, bool* results) {
+            std::size_t i = 0;
+            for (; i + kGroup <= keyCount; i += kGroup) {
+                // Independent descents in lockstep keep several cache misses in flight
+                std::size_t k[kGroup];
+                for (std::size_t g = 0; g < kGroup; ++g) k[g] = 1;
+                for (int level = 0; level < fullLevels; ++level) {
+                    for (std::size_t g = 0; g < kGroup; ++g)
+                        k[g] = 2 * k[g] + (slots[k[g]] < keys[i + g]);
+                }
+                for (std::size_t g = 0; g < kGroup; ++g)
+                    results[i + g] = found(slots, finishDescent(slots, count, k[g], keys[i + g]), keys[i + g]);
+            }
+            for (; i < keyCount; ++i)
+                results[i] = found(slots, descend(slots, count, fullLevels, keys[i]), keys[i]);
+        }
+
+#ifdef AVL_FROZEN_AVX2
+        __attribute__((target("avx2")))
+        void searchManyAvx2(const double* slots, std::size_t count, int fullLevels,
+                            const double* keys, std::size_t keyCount, bool* results) {
+            constexpr int kVectors = 2;  // Two gathers in flight per level
+            const __m256i one = _mm256_set1_epi64x(1);
+            const __m256i limit = _mm256_set1_epi64x(static_cast<long long>(count));
+            std::size_t i = 0;
+            for (; i + 4 * kVectors <= keyCount; i += 4 * kVectors) {
+                __m256d x[kVectors];
+                __m256i k[kVectors];
+                for (int v = 0; v < kVectors; ++v) {
+                    x[v] = _mm256_loadu_pd(keys + i + 4 * v);
+                    k[v] = one;
+                }
+                for (int level = 0; level < fullLevels; ++level) {
+                    for (int v = 0; v < kVectors; ++v) {
+                        __m256d values = _mm256_i64gather_pd(slots, k[v], 8);
+                        __m256i right = _mm256_srli_epi64(_mm256_castpd_si256(_mm256_cmp_pd(values, x[v], _CMP_LT_OQ)), 63);
+                        k[v] = _mm256_add_epi64(_mm256_add_epi64(k[v], k[v]), right);
+                    }
+                }
+                for (int v = 0; v < kVectors; ++v) {
+                    // Same final step as finishDescent(), with lanes past the end reading slot 0
+                    __m256i past = _mm256_cmpgt_epi64(k[v], limit);
+                    __m256d values = _mm256_i64gather_pd(slots, _mm256_andnot_si256(past, k[v]), 8);
+                    __m256i right = _mm256_or_si256(past, _mm256_castpd_si256(_mm256_cmp_pd(values, x[v], _CMP_LT_OQ)));
+                    k[v] = _mm256_add_epi64(_mm256_add_epi64(k[v], k[v]), _mm256_srli_epi64(right, 63));
+
+                    alignas(32) std::uint64_t lanes[4];
+                    _mm256_store_si256(reinterpret_cast<__m256i*>(lanes), k[v]);
+                    for (int lane = 0; lane < 4; ++lane) {
+                        std::size_t slot = static_cast<std::size_t>(lanes[lane] >> (countTrailingZeros(~lanes[lane]) + 1));
+                        results[i + 4 * v + lane] = found(slots, slot, keys[i + 4 * v + lane]);
+                    }
+                }
+            }
+            searchManyScalar(slots, count, fullLevels, keys + i, keyCount - i, results + i);
+        }
+#endif
+
+    }
+
+    double* FrozenAVLTree::allocate(std::size_t valueCount) {
+        std::size_t bytes = (valueCount + 1) * sizeof(double);
+        bytes = (bytes + kCacheLine - 1) / kCacheLine * kCacheLine;
+        double* raw = static_cast<double*>(::operator new(bytes, std::align_val_t(kCacheLine)));
+        raw[0] = 0;
+        slots = std::shared_ptr<const double>(raw, [](const double* p) {
+            ::operator delete(const_cast<double*>(p), std::align_val_t(kCacheLine));
+        });
+        count = valueCount;
+        fullLevels = 0;
+        while ((std::size_t(2) << fullLevels) - 1 <= count) ++fullLevels;
+        return raw;
+    }
+
+    FrozenAVLTree::FrozenAVLTree(const AVLTree& tree) {
+        double* raw = allocate(tree.size());
+        fillInOrder(raw, count, tree.begin());
+    }
+
+    FrozenAVLTree::FrozenAVLTree(const double* sorted, std::size_t valueCount) {
+        for (std::size_t i = 1; i < valueCount; ++i) {
+            if (!(sorted[i - 1] < sorted[i]))
+                throw std::invalid_argument("FrozenAVLTree: values are not strictly increasing");
+        }
+        double* raw = allocate(valueCount);
+        fillInOrder(raw, count, sorted);
+    }
+
+    std::size_t FrozenAVLTree::lowerBoundSlot(double val) const {
+        if (count == 0) return 0;
+        return descend(slots.get(), count, fullLevels, val);
+    }
+
+    bool FrozenAVLTree::search(double val) const {
+        return found(slots.get(), lowerBoundSlot(val), val);
+    }
+
+    std::optional<double> FrozenAVLTree::lower_bound(double val) const {
+        std::size_t slot = lowerBoundSlot(val);
+        if (slot == 0) return std::nullopt;
+        return slots.get()[slot];
+    }
+
+    void FrozenAVLTree::search_many(const double* keys, std::size_t keyCount, bool* results) const {
+        if (count == 0) {
+            for (std::size_t i = 0; i < keyCount; ++i) results[i] = false;
+            return;
+        }
+#ifdef AVL_FROZEN_AVX2
+        if (__builtin_cpu_supports("avx2")) {
+            searchManyAvx2(slots.get(), count, fullLevels, keys, keyCount, results);
+            return;
+        }
+#endif
+        searchManyScalar(slots.get(), count, fullLevels, keys, keyCount, results);
+    }
+
+    FrozenAVLTree AVLTree::freeze() const {
+        return FrozenAVLTree(*this);
+    }
+
+}
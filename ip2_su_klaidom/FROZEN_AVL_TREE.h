@@ -0,0 +1,95 @@
+#ifndef FROZEN_AVL_TREE_H
+#define FROZEN_AVL_TREE_H
+
+#include <cstddef>
+#include <memory>
+#include <optional>
+
+namespace AVLProject {
+
+    class AVLTree;
+
+    /**
+     * @brief Immutable, search-only copy of an AVLTree in Eytzinger (BFS) order.
+     *
+     * The values sit in one cache-line-aligned array, where the children of slot k
+     * are slots 2k and 2k+1. A lookup walks down it with a fixed number of branchless
+     * steps and prefetches the cache line three levels ahead. search_many() runs
+     * several lookups in lockstep and uses AVX2 gathers when the CPU has them.
+     *
+     * A frozen tree is never modified after construction. It can be searched from any
+     * number of threads at once, and copies share the same array.
+     */
+    class FrozenAVLTree {
+    private:
+        std::shared_ptr<const double> slots;  ///< Slot 0 is unused; values occupy slots 1..count.
+        std::size_t count = 0;                ///< Number of values.
+        int fullLevels = 0;                   ///< Levels that are completely filled, floor(log2(count + 1)).
+
+        double* allocate(std::size_t valueCount);
+        std::size_t lowerBoundSlot(double val) const;
+
+    public:
+        /**
+         * @brief Constructs an empty frozen tree.
+         */
+        FrozenAVLTree() = default;
+
+        /**
+         * @brief Copies the values of a tree into Eytzinger order in O(n).
+         * @param tree The tree to freeze.
+         */
+        explicit FrozenAVLTree(const AVLTree& tree);
+
+        /**
+         * @brief Copies sorted values into Eytzinger order in O(n).
+         * @param sorted Strictly increasing values.
+         * @param valueCount Number of values.
+         * @throws std::invalid_argument If the values are not strictly increasing.
+         */
+        FrozenAVLTree(const double* sorted, std::size_t valueCount);
+
+        /**
+         * @brief Returns the number of values.
+         * @return The number of values.
+         */
+        std::size_t size() const { return count; }
+
+        /**
+         * @brief Checks whether the frozen tree holds no values.
+         * @return True if it is empty, false otherwise.
+         */
+        bool empty() const { return count == 0; }
+
+        /**
+         * @brief Searches for a value in O(log n) without data-dependent branches.
+         * @param val The value to search for.
+         * @return True if the value is stored, false otherwise.
+         */
+        bool search(double val) const;
+
+        /**
+         * @brief Searches for many values at once, interleaving their descents.
+         * @param keys The values to search for.
+         * @param keyCount Number of values.
+         * @param results Receives, for each key, whether it is stored.
+         */
+        void search_many(const double* keys, std::size_t keyCount, bool* results) const;
+
+        /**
+         * @brief Finds the smallest stored value that is not less than a given value.
+         * @param val The bound.
+         * @return The smallest value >= @p val, or std::nullopt if there is none.
+         */
+        std::optional<double> lower_bound(double val) const;
+
+        /**
+         * @brief Searches for a value; same as search().
+         * @param val The value to search for.
+         * @return True if the value is stored, false otherwise.
+         */
+        bool operator[](double val) const { return search(val); }
+    };
+
+}
+#endif // FROZEN_AVL_TREE_H
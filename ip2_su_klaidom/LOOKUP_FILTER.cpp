@@ -0,0 +1,84 @@
+#include "LOOKUP_FILTER.h"
+#include "AVL_TREE_IMPL.h"
+#include <algorithm>
+
+namespace AVLProject {
+
+    namespace {
+
+        /// Odd multipliers that pick one bit per word from the low half of the hash.
+        constexpr std::uint32_t kSalts[8] = {
+            0x47b6137bU, 0x44974d91U, 0x8824ad5bU, 0xa2b7289dU,
+            0x705495c7U, 0x2df1424bU, 0x9efc4947U, 0x5c6bfb31U
+        };
+
+        inline int bitFor(std::uint64_t hash, int word) {
+            return static_cast<int>((static_cast<std::uint32_t>(hash) * kSalts[word]) >> 26);
+        }
+
+        inline int popCount(std::uint64_t word) {
+#ifdef __GNUC__
+            return __builtin_popcountll(word);
+#else
+            int bits = 0;
+            for (; word; word &= word - 1) ++bits;
+            return bits;
+#endif
+        }
+
+    }
+
+    LookupFilter::LookupFilter(std::size_t values)
+        : blocks((std::max(2 * values, kMinimumCapacity) + kValuesPerBlock - 1) / kValuesPerBlock, Block{}) {}
+
+    LookupFilter::LookupFilter(const LookupFilter& other)
+        : blocks(other.blocks),
+          keys(other.keys),
+          rejections(other.rejections.load(std::memory_order_relaxed)),
+          falsePositives(other.falsePositives.load(std::memory_order_relaxed)) {}
+
+    std::uint64_t LookupFilter::hash(double val) {
+        return valueHash(val);
+    }
+
+    std::size_t LookupFilter::blockIndex(std::uint64_t hash) const {
+        // Maps the high half onto [0, blocks) without a division; fine below 2^32 blocks
+        return static_cast<std::size_t>(((hash >> 32) * blocks.size()) >> 32);
+    }
+
+    void LookupFilter::add(double val) {
+        std::uint64_t h = hash(val);
+        Block& block = blocks[blockIndex(h)];
+        for (int word = 0; word < 8; ++word)
+            block.words[word] |= std::uint64_t(1) << bitFor(h, word);
+        ++keys;
+    }
+
+    bool LookupFilter::mayContain(double val) const {
+        if (val != val) return true;  // NaN compares equal to every node, so leave it to the tree
+        std::uint64_t h = hash(val);
+        const Block& block = blocks[blockIndex(h)];
+        bool present = true;
+        for (int word = 0; word < 8; ++word)
+            present &= (block.words[word] >> bitFor(h, word)) & 1;
+        return present;
+    }
+
+    double LookupFilter::falsePositiveRate() const {
+        // An absent value lands in a uniformly chosen block and needs all eight of its bits set there
+        double total = 0;
+        for (const Block& block : blocks) {
+            double pass = 1;
+            for (std::uint64_t word : block.words) pass *= popCount(word) / 64.0;
+            total += pass;
+        }
+        return total / static_cast<double>(blocks.size());
+    }
+
+    double LookupFilter::observedFalsePositiveRate() const {
+        std::uint64_t passed = falsePositives.load(std::memory_order_relaxed);
+        std::uint64_t misses = passed + rejections.load(std::memory_order_relaxed);
+        return misses == 0 ? 0.0 : static_cast<double>(passed) / static_cast<double>(misses);
+    }
+
+}
@@ -0,0 +1,109 @@
+#ifndef LOOKUP_FILTER_H
+#define LOOKUP_FILTER_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+namespace AVLProject {
+
+    /**
+     * @brief A blocked Bloom filter that rules out absent values without touching the tree.
+     *
+     * Every value sets one bit in each of the eight words of a single 64-byte block,
+     * so a probe reads one cache line and never says no to a value that was added.
+     * Bits cannot be cleared, so removed values keep passing the filter until it is
+     * rebuilt; AVLTree rebuilds it when the tree outgrows it or shrinks well below it.
+     */
+    class LookupFilter {
+    public:
+        static constexpr std::size_t kMinimumCapacity = 1024;  ///< Values the smallest filter has room for.
+        static constexpr std::size_t kValuesPerBlock = 32;     ///< Sixteen bits per value when full.
+
+        /**
+         * @brief Constructs an empty filter with room for twice @p values, and at least kMinimumCapacity.
+         * @param values The number of values about to be added.
+         */
+        explicit LookupFilter(std::size_t values);
+
+        /**
+         * @brief Copies the bits and the probe counts of another filter.
+         * @param other The filter to copy.
+         */
+        LookupFilter(const LookupFilter& other);
+
+        LookupFilter& operator=(const LookupFilter&) = delete;
+
+        /**
+         * @brief Adds a value; it passes mayContain() from now on.
+         * @param val The value to add.
+         */
+        void add(double val);
+
+        /**
+         * @brief Checks whether a value may have been added.
+         * @param val The value to look up.
+         * @return False only if @p val was never added; NaN always passes.
+         */
+        bool mayContain(double val) const;
+
+        /**
+         * @brief Counts a search that mayContain() answered on its own.
+         */
+        void recordRejection() const { rejections.fetch_add(1, std::memory_order_relaxed); }
+
+        /**
+         * @brief Counts a search that passed mayContain() but found nothing in the tree.
+         */
+        void recordFalsePositive() const { falsePositives.fetch_add(1, std::memory_order_relaxed); }
+
+        /**
+         * @brief Returns how many values were added, removed ones included.
+         * @return The number of add() calls since construction.
+         */
+        std::size_t keyCount() const { return keys; }
+
+        /**
+         * @brief Returns how many values fit before the false-positive rate exceeds its target.
+         * @return The capacity in values.
+         */
+        std::size_t capacity() const { return blocks.size() * kValuesPerBlock; }
+
+        /**
+         * @brief Returns the bytes held for the bit array.
+         * @return The size of the blocks in bytes.
+         */
+        std::size_t memoryBytes() const { return blocks.size() * sizeof(Block); }
+
+        /**
+         * @brief Computes the chance that a value which was never added passes mayContain().
+         *
+         * Exact for the current bits, assuming uniformly hashed values; runs in O(capacity).
+         * @return The false-positive rate, between 0 and 1.
+         */
+        double falsePositiveRate() const;
+
+        /**
+         * @brief Returns the share of absent values that got past the filter so far.
+         * @return False positives over all absent values searched for, or 0 before the first miss.
+         */
+        double observedFalsePositiveRate() const;
+
+    private:
+        /// One cache line of bits; a value sets one bit in each word.
+        struct alignas(64) Block {
+            std::uint64_t words[8];
+        };
+
+        std::vector<Block> blocks;                                ///< The bit array.
+        std::size_t keys = 0;                                     ///< Values added.
+        mutable std::atomic<std::uint64_t> rejections{0};         ///< Absent values the filter answered.
+        mutable std::atomic<std::uint64_t> falsePositives{0};     ///< Absent values that passed it.
+
+        static std::uint64_t hash(double val);
+        std::size_t blockIndex(std::uint64_t hash) const;
+    };
+
+}
+#endif // LOOKUP_FILTER_H
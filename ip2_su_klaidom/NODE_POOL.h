@@ -0,0 +1,195 @@
+#ifndef NODE_POOL_H
+#define NODE_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace AVLProject {
+
+    /**
+     * @brief Slab allocator handing out fixed-size nodes of type T.
+     *
+     * Nodes are carved out of geometrically growing slabs and recycled through an
+     * intrusive freelist, so insert/remove churn never reaches the global heap once
+     * the pool is warm. Because T must be trivially destructible, the whole pool can
+     * be dropped in O(#slabs) without visiting individual nodes.
+     */
+    template <typename T>
+    class NodePool {
+        static_assert(std::is_trivially_destructible<T>::value,
+                      "NodePool releases slabs without running node destructors");
+
+    private:
+        union Slot {
+            Slot* next;                                    ///< Link on the freelist, or from a slab to the next slab.
+            alignas(T) unsigned char storage[sizeof(T)];   ///< Storage for a live node.
+        };
+
+        static constexpr std::size_t kFirstSlabNodes = 32;    ///< Size of the first slab.
+        static constexpr std::size_t kMaxSlabNodes = 4096;    ///< Upper bound on the slab growth.
+
+        Slot* slabs = nullptr;                       ///< Every slab owned by the pool, linked through their first slot.
+        Slot* lastSlab = nullptr;                    ///< Tail of the slab list.
+        Slot* freeList = nullptr;                    ///< Recycled slots, most recently freed first.
+        Slot* freeTail = nullptr;                    ///< Last slot of the freelist; stale while the freelist is empty.
+        Slot* cursor = nullptr;                      ///< Next never-used slot.
+        Slot* cursorEnd = nullptr;                   ///< One past the never-used slots at cursor.
+        Slot* spare = nullptr;                       ///< A second never-used range, taken over by adopt().
+        Slot* spareEnd = nullptr;                    ///< One past the spare range.
+        std::size_t nextSlabNodes = kFirstSlabNodes; ///< Capacity of the next slab to allocate.
+        std::size_t slotCount = 0;                   ///< Slots in all slabs, live, free or linking.
+
+        /**
+         * Allocates a slab for @p nodes nodes, after a first slot that links it into the slab list.
+         */
+        Slot* addSlab(std::size_t nodes) {
+            Slot* slab = new Slot[nodes + 1];
+            slab->next = nullptr;
+            if (lastSlab)
+                lastSlab->next = slab;
+            else
+                slabs = slab;
+            lastSlab = slab;
+            slotCount += nodes + 1;
+            return slab + 1;
+        }
+
+        void grow() {
+            if (spare != spareEnd) {
+                cursor = spare;
+                cursorEnd = spareEnd;
+                spare = spareEnd = nullptr;
+                return;
+            }
+            cursor = addSlab(nextSlabNodes);
+            cursorEnd = cursor + nextSlabNodes;
+            if (nextSlabNodes < kMaxSlabNodes)
+                nextSlabNodes *= 2;
+        }
+
+        /**
+         * Keeps a never-used range in place of the shorter of the two held, if it is longer.
+         */
+        void keepRange(Slot* begin, Slot* end) {
+            if (spareEnd - spare < cursorEnd - cursor) {
+                if (end - begin > spareEnd - spare) {
+                    spare = begin;
+                    spareEnd = end;
+                }
+            } else if (end - begin > cursorEnd - cursor) {
+                cursor = begin;
+                cursorEnd = end;
+            }
+        }
+
+        /**
+         * Forgets every slab without freeing it, after adopt() handed them to another pool.
+         */
+        void forget() {
+            slabs = lastSlab = nullptr;
+            freeList = freeTail = nullptr;
+            cursor = cursorEnd = nullptr;
+            spare = spareEnd = nullptr;
+            nextSlabNodes = kFirstSlabNodes;
+            slotCount = 0;
+        }
+
+    public:
+        NodePool() = default;
+        NodePool(const NodePool&) = delete;
+        NodePool& operator=(const NodePool&) = delete;
+        ~NodePool() { releaseAll(); }
+
+        /**
+         * @brief Constructs a node in a pooled slot.
+         * @param args Arguments forwarded to the constructor of T.
+         * @return Pointer to the new node.
+         */
+        template <typename... Args>
+        T* create(Args&&... args) {
+            Slot* slot;
+            if (freeList) {
+                slot = freeList;
+                freeList = freeList->next;
+            } else {
+                if (cursor == cursorEnd)
+                    grow();
+                slot = cursor++;
+            }
+            return ::new (static_cast<void*>(slot->storage)) T(std::forward<Args>(args)...);
+        }
+
+        /**
+         * @brief Constructs @p count nodes in one dedicated, contiguous slab.
+         * @param count Number of nodes to construct.
+         * @param args Arguments forwarded to the constructor of every node.
+         * @return Pointer to the first node; the rest follow it as a plain array.
+         */
+        template <typename... Args>
+        T* createBlock(std::size_t count, const Args&... args) {
+            static_assert(sizeof(Slot) == sizeof(T), "block nodes must be addressable as a T array");
+            T* block = reinterpret_cast<T*>(addSlab(count));
+            for (std::size_t i = 0; i < count; ++i)
+                ::new (static_cast<void*>(block + i)) T(args...);
+            return block;
+        }
+
+        /**
+         * @brief Returns a node to the freelist for reuse.
+         * @param node Node previously obtained from create().
+         */
+        void destroy(T* node) {
+            Slot* slot = reinterpret_cast<Slot*>(node);
+            if (!freeList) freeTail = slot;
+            slot->next = freeList;
+            freeList = slot;
+        }
+
+        /**
+         * @brief Takes over every slab of another pool in O(1), so its nodes now belong to this one.
+         *
+         * The slab lists and the freelists are spliced at their tails. Of the never-used
+         * ranges of both pools, the two longest stay available to create(); the others are
+         * only freed with their slabs.
+         * @param other The pool to empty.
+         */
+        void adopt(NodePool& other) {
+            if (&other == this || !other.slabs) return;
+            if (lastSlab)
+                lastSlab->next = other.slabs;
+            else
+                slabs = other.slabs;
+            lastSlab = other.lastSlab;
+            if (other.freeList) {
+                other.freeTail->next = freeList;
+                if (!freeList) freeTail = other.freeTail;
+                freeList = other.freeList;
+            }
+            keepRange(other.cursor, other.cursorEnd);
+            keepRange(other.spare, other.spareEnd);
+            slotCount += other.slotCount;
+            other.forget();
+        }
+
+        /**
+         * @brief Releases every slab at once, invalidating all nodes of the pool.
+         */
+        void releaseAll() {
+            while (slabs) {
+                Slot* next = slabs->next;
+                delete[] slabs;
+                slabs = next;
+            }
+            forget();
+        }
+
+        /**
+         * @brief Returns the bytes held in slabs, free slots included.
+         * @return The size of all slabs together.
+         */
+        std::size_t capacityBytes() const { return slotCount * sizeof(Slot); }
+    };
+}
+#endif // NODE_POOL_H
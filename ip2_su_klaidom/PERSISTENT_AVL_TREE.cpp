@@ -0,0 +1,302 @@
+#include "PERSISTENT_AVL_TREE.h"
+#include "AVL_TREE.h"
+#include <algorithm>
+#include <vector>
+
+namespace AVLProject {
+
+    /**
+     * @brief Node of a PersistentAVLTree. Once published it is never modified.
+     */
+    struct PersistentNode {
+        double value;                  ///< The value stored in the node.
+        const PersistentNode* left;    ///< Pointer to the left child.
+        const PersistentNode* right;   ///< Pointer to the right child.
+        std::size_t size;              ///< Number of nodes in the subtree rooted here.
+        std::uint64_t version;         ///< The write that created the node, the only one allowed to change it.
+        int height;                    ///< Height of the node in the tree.
+    };
+
+    namespace {
+
+        constexpr int kMaxHeight = 96;  ///< AVL height bound for any tree that fits in memory.
+
+        /**
+         * Tracks the nodes one write creates and the published nodes it replaces.
+         * If the write fails, the new nodes are freed. Otherwise the replaced nodes
+         * are retired once the new root is visible.
+         */
+        class PathCopy {
+        private:
+            std::uint64_t version;
+            std::vector<PersistentNode*> created;
+            std::vector<const PersistentNode*> replaced;
+            bool committed = false;
+
+            /// Grows the vectors before a node is allocated, so that recording it cannot throw.
+            void makeRoom() {
+                if (created.size() == created.capacity()) created.reserve(2 * created.size());
+                if (replaced.size() == replaced.capacity()) replaced.reserve(2 * replaced.size());
+            }
+
+        public:
+            explicit PathCopy(std::uint64_t version) : version(version) {
+                // Enough for a path and its rotations, so that most writes allocate no more
+                created.reserve(2 * kMaxHeight);
+                replaced.reserve(2 * kMaxHeight);
+            }
+
+            ~PathCopy() {
+                if (!committed)
+                    for (PersistentNode* node : created) delete node;
+            }
+
+            PersistentNode* create(double val) {
+                makeRoom();
+                PersistentNode* node = new PersistentNode{val, nullptr, nullptr, 1, version, 1};
+                created.push_back(node);
+                return node;
+            }
+
+            /**
+             * Returns a node this write may modify: the node itself if the write created
+             * it, otherwise a copy that replaces it.
+             */
+            PersistentNode* own(const PersistentNode* node) {
+                if (node->version == version)
+                    return const_cast<PersistentNode*>(node);
+                makeRoom();
+                PersistentNode* copy = new PersistentNode(*node);
+                copy->version = version;
+                created.push_back(copy);
+                replaced.push_back(node);
+                return copy;
+            }
+
+            void discard(const PersistentNode* node) { replaced.push_back(node); }
+
+            void commit(EpochReclaimer& reclaimer) {
+                committed = true;
+                for (const PersistentNode* node : replaced) reclaimer.retire(node);
+            }
+        };
+
+        int getHeight(const PersistentNode* node) { return node ? node->height : 0; }
+
+        std::size_t getSize(const PersistentNode* node) { return node ? node->size : 0; }
+
+        int getBalanceFactor(const PersistentNode* node) {
+            return node ? getHeight(node->left) - getHeight(node->right) : 0;
+        }
+
+        void updateNode(PersistentNode* node) {
+            node->height = 1 + std::max(getHeight(node->left), getHeight(node->right));
+            node->size = 1 + getSize(node->left) + getSize(node->right);
+        }
+
+        PersistentNode* rotateRight(PersistentNode* y, PathCopy& copies) {
+            PersistentNode* x = copies.own(y->left);
+            y->left = x->right;
+            x->right = y;
+            updateNode(y);
+            updateNode(x);
+            return x;
+        }
+
+        PersistentNode* rotateLeft(PersistentNode* x, PathCopy& copies) {
+            PersistentNode* y = copies.own(x->right);
+            x->right = y->left;
+            y->left = x;
+            updateNode(x);
+            updateNode(y);
+            return y;
+        }
+
+        PersistentNode* rebalance(PersistentNode* node, PathCopy& copies) {
+            int balance = getBalanceFactor(node);
+            if (balance > 1) {
+                PersistentNode* left = copies.own(node->left);
+                node->left = getBalanceFactor(left) < 0 ? rotateLeft(left, copies) : left;
+                return rotateRight(node, copies);
+            }
+            if (balance < -1) {
+                PersistentNode* right = copies.own(node->right);
+                node->right = getBalanceFactor(right) > 0 ? rotateRight(right, copies) : right;
+                return rotateLeft(node, copies);
+            }
+            return node;
+        }
+
+        PersistentNode* insertInto(const PersistentNode* node, double val, PathCopy& copies) {
+            if (!node)
+                return copies.create(val);
+
+            PersistentNode* copy;
+            if (val < node->value) {
+                PersistentNode* child = insertInto(node->left, val, copies);
+                copy = copies.own(node);
+                copy->left = child;
+            } else if (val > node->value) {
+                PersistentNode* child = insertInto(node->right, val, copies);
+                copy = copies.own(node);
+                copy->right = child;
+            } else {
+                throw DuplicateValueException(val);
+            }
+            updateNode(copy);
+            return rebalance(copy, copies);
+        }
+
+        const PersistentNode* eraseFrom(const PersistentNode* node, double val, PathCopy& copies, bool& removed) {
+            if (!node)
+                return nullptr;
+
+            PersistentNode* copy;
+            if (val < node->value) {
+                const PersistentNode* child = eraseFrom(node->left, val, copies, removed);
+                if (!removed) return node;
+                copy = copies.own(node);
+                copy->left = child;
+            } else if (val > node->value) {
+                const PersistentNode* child = eraseFrom(node->right, val, copies, removed);
+                if (!removed) return node;
+                copy = copies.own(node);
+                copy->right = child;
+            } else {
+                removed = true;
+                if (!node->left || !node->right) {
+                    copies.discard(node);
+                    return node->left ? node->left : node->right;
+                }
+                // Replace the value with its successor's, which is removed from the right subtree
+                const PersistentNode* next = node->right;
+                while (next->left) next = next->left;
+                double nextValue = next->value;
+                bool removedNext = false;
+                const PersistentNode* right = eraseFrom(node->right, nextValue, copies, removedNext);
+                copy = copies.own(node);
+                copy->value = nextValue;
+                copy->right = right;
+            }
+            updateNode(copy);
+            return rebalance(copy, copies);
+        }
+
+        PersistentNode* linkBalanced(const std::vector<double>& values, std::size_t lo, std::size_t hi, PathCopy& copies) {
+            if (lo >= hi) return nullptr;
+            std::size_t mid = lo + (hi - lo) / 2;
+            PersistentNode* node = copies.create(values[mid]);
+            node->left = linkBalanced(values, lo, mid, copies);
+            node->right = linkBalanced(values, mid + 1, hi, copies);
+            updateNode(node);
+            return node;
+        }
+
+        void freeNodes(const PersistentNode* node) {
+            // Recurses left only, so the depth stays within the height and the destructor allocates nothing
+            while (node) {
+                freeNodes(node->left);
+                const PersistentNode* right = node->right;
+                delete node;
+                node = right;
+            }
+        }
+
+        bool searchFrom(const PersistentNode* node, double val) {
+            while (node) {
+                if (val < node->value)
+                    node = node->left;
+                else if (val > node->value)
+                    node = node->right;
+                else
+                    return true;
+            }
+            return false;
+        }
+
+    }
+
+    PersistentAVLTree::Snapshot::Snapshot(EpochReclaimer::Guard guard, const PersistentNode* root)
+        : guard(std::move(guard)), root(root) {}
+
+    bool PersistentAVLTree::Snapshot::search(double val) const {
+        return searchFrom(root, val);
+    }
+
+    std::size_t PersistentAVLTree::Snapshot::size() const {
+        return getSize(root);
+    }
+
+    std::string PersistentAVLTree::Snapshot::toString(const FormatOptions& options) const {
+        std::string text;
+        StringSink sink(text);
+        write(sink, options);
+        return text;
+    }
+
+    void PersistentAVLTree::Snapshot::write(OutputSink& sink, const FormatOptions& options) const {
+        // Nodes have no parent links, so the in-order walk keeps its path on a stack
+        const PersistentNode* path[kMaxHeight];
+        int depth = 0;
+        ValueFormatter formatter(sink, options);
+        const PersistentNode* node = root;
+        while (node || depth > 0) {
+            while (node) {
+                path[depth++] = node;
+                node = node->left;
+            }
+            node = path[--depth];
+            formatter.append(node->value);
+            node = node->right;
+        }
+        formatter.finish();
+    }
+
+    PersistentAVLTree::PersistentAVLTree(const AVLTree& tree) {
+        // Built as write 0, so that a failed allocation frees the nodes made so far
+        std::vector<double> values(tree.begin(), tree.end());
+        PathCopy copies(version);
+        root.store(linkBalanced(values, 0, values.size(), copies), std::memory_order_seq_cst);
+        copies.commit(reclaimer);
+    }
+
+    PersistentAVLTree::~PersistentAVLTree() {
+        freeNodes(root.load(std::memory_order_relaxed));
+    }
+
+    PersistentAVLTree::Snapshot PersistentAVLTree::snapshot() const {
+        EpochReclaimer::Guard guard = reclaimer.pin();
+        const PersistentNode* current = root.load(std::memory_order_seq_cst);
+        return Snapshot(std::move(guard), current);
+    }
+
+    void PersistentAVLTree::insert(double val) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        PathCopy copies(++version);
+        const PersistentNode* updated = insertInto(root.load(std::memory_order_relaxed), val, copies);
+        root.store(updated, std::memory_order_seq_cst);
+        copies.commit(reclaimer);
+    }
+
+    bool PersistentAVLTree::remove(double val) {
+        std::lock_guard<std::mutex> lock(writerMutex);
+        PathCopy copies(++version);
+        bool removed = false;
+        const PersistentNode* updated = eraseFrom(root.load(std::memory_order_relaxed), val, copies, removed);
+        if (!removed) return false;
+        root.store(updated, std::memory_order_seq_cst);
+        copies.commit(reclaimer);
+        return true;
+    }
+
+    bool PersistentAVLTree::search(double val) const {
+        EpochReclaimer::Guard guard = reclaimer.pin();
+        return searchFrom(root.load(std::memory_order_seq_cst), val);
+    }
+
+    std::size_t PersistentAVLTree::size() const {
+        EpochReclaimer::Guard guard = reclaimer.pin();
+        return getSize(root.load(std::memory_order_seq_cst));
+    }
+
+}
@@ -0,0 +1,165 @@
+#ifndef PERSISTENT_AVL_TREE_H
+#define PERSISTENT_AVL_TREE_H
+
+#include "AVL_OUTPUT.h"
+#include "EPOCH_RECLAIMER.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <string>
+
+namespace AVLProject {
+
+    class AVLTree;
+    struct PersistentNode;
+
+    /**
+     * @brief AVL tree whose versions are immutable, for readers that never block.
+     *
+     * insert() and remove() copy only the O(log n) nodes on the search path, plus the
+     * nodes a rotation touches. Every other node is shared with the previous version.
+     * The new root is then published with one atomic store. Writers are serialized by
+     * a mutex. Readers take no lock: they pin an epoch, load the root, and walk
+     * nodes that no writer will change.
+     *
+     * Replaced nodes are handed to an EpochReclaimer. They are freed once no pinned
+     * reader can still reach them.
+     */
+    class PersistentAVLTree {
+    public:
+        /**
+         * @brief A consistent, read-only version of the tree.
+         *
+         * The snapshot pins the reclaimer's epoch, so keep it short-lived. While any
+         * snapshot is held, no node retired after it was taken can be freed. The
+         * snapshot must not outlive its tree.
+         */
+        class Snapshot {
+        private:
+            friend class PersistentAVLTree;
+
+            EpochReclaimer::Guard guard;         ///< Keeps the version's nodes alive.
+            const PersistentNode* root = nullptr;  ///< Root of the version.
+
+            Snapshot(EpochReclaimer::Guard guard, const PersistentNode* root);
+
+        public:
+            Snapshot() = default;
+            Snapshot(Snapshot&&) noexcept = default;
+            Snapshot& operator=(Snapshot&&) noexcept = default;
+
+            /**
+             * @brief Searches the version for a value.
+             * @param val The value to search for.
+             * @return True if the value is stored, false otherwise.
+             */
+            bool search(double val) const;
+
+            /**
+             * @brief Returns the number of values in the version.
+             * @return The number of values.
+             */
+            std::size_t size() const;
+
+            /**
+             * @brief Checks whether the version holds no values.
+             * @return True if it is empty, false otherwise.
+             */
+            bool empty() const { return root == nullptr; }
+
+            /**
+             * @brief Returns the values in order, formatted like AVLTree::toString().
+             * @param options Separator, precision and notation to use.
+             * @return A string containing the in-order traversal.
+             */
+            std::string toString(const FormatOptions& options = FormatOptions()) const;
+
+            /**
+             * @brief Streams the values in order to a sink.
+             * @param sink The destination.
+             * @param options Separator, precision and notation to use.
+             */
+            void write(OutputSink& sink, const FormatOptions& options = FormatOptions()) const;
+
+            bool operator[](double val) const { return search(val); }
+        };
+
+        /**
+         * @brief Constructs an empty tree.
+         */
+        PersistentAVLTree() = default;
+
+        /**
+         * @brief Constructs a tree holding the values of an AVLTree, built bottom-up in O(n).
+         * @param tree The tree to copy.
+         */
+        explicit PersistentAVLTree(const AVLTree& tree);
+
+        /**
+         * @brief Frees every version. No snapshot of this tree may still be held.
+         */
+        ~PersistentAVLTree();
+
+        PersistentAVLTree(const PersistentAVLTree&) = delete;
+        PersistentAVLTree& operator=(const PersistentAVLTree&) = delete;
+
+        /**
+         * @brief Takes a snapshot of the current version without blocking.
+         * @return The snapshot.
+         */
+        Snapshot snapshot() const;
+
+        /**
+         * @brief Publishes a new version containing a value.
+         * @param val The value to insert.
+         * @throws DuplicateValueException If the value is already stored.
+         */
+        void insert(double val);
+
+        /**
+         * @brief Publishes a new version without a value.
+         * @param val The value to remove.
+         * @return True if the value was stored, false otherwise.
+         */
+        bool remove(double val);
+
+        /**
+         * @brief Searches the current version for a value without blocking.
+         * @param val The value to search for.
+         * @return True if the value is stored, false otherwise.
+         */
+        bool search(double val) const;
+
+        /**
+         * @brief Returns the number of values in the current version.
+         * @return The number of values.
+         */
+        std::size_t size() const;
+
+        /**
+         * @brief Frees retired nodes that no reader can reach any more.
+         */
+        void collect() { reclaimer.collect(); }
+
+        bool operator[](double val) const { return search(val); }
+
+        PersistentAVLTree& operator+=(double val) {
+            insert(val);
+            return *this;
+        }
+
+        PersistentAVLTree& operator-=(double val) {
+            remove(val);
+            return *this;
+        }
+
+    private:
+        std::atomic<const PersistentNode*> root{nullptr};  ///< Current version.
+        std::mutex writerMutex;                            ///< Serializes insert() and remove().
+        std::uint64_t version = 0;                         ///< Number of the write in progress.
+        mutable EpochReclaimer reclaimer;                  ///< Frees replaced nodes.
+    };
+
+}
+#endif // PERSISTENT_AVL_TREE_H
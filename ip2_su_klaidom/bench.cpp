@@ -0,0 +1,420 @@
+#include "AVL_TREE.h"
+#include "BASIC_AVL_TREE.h"
+#include "CONCURRENT_AVL_TREE.h"
+#include "DURABLE_AVL_TREE.h"
+#include "FROZEN_AVL_TREE.h"
+#include "PERSISTENT_AVL_TREE.h"
+#include <cstdio>
+#include <sstream>
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <filesystem>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+using namespace std;
+using namespace AVLProject;
+
+using Clock = chrono::steady_clock;
+
+template <typename Body>
+double nanosPerOp(size_t ops, Body body) {
+    auto start = Clock::now();
+    body();
+    auto elapsed = chrono::duration_cast<chrono::nanoseconds>(Clock::now() - start).count();
+    return static_cast<double>(elapsed) / static_cast<double>(ops);
+}
+
+void report(const string& name, double nanos) {
+    cout << left << setw(28) << name << right << setw(10) << fixed << setprecision(1) << nanos << " ns/op" << endl;
+}
+
+// Runs ops operations split over threads: 90% search, 5% insert, 5% remove on keys below range
+template <typename Search, typename Insert, typename Remove>
+double mixedNanosPerOp(size_t ops, unsigned threads, size_t range, Search search, Insert insert, Remove remove) {
+    return nanosPerOp(ops, [&] {
+        vector<thread> workers;
+        for (unsigned t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t] {
+                mt19937_64 rng(t + 1);
+                for (size_t i = t; i < ops; i += threads) {
+                    double key = static_cast<double>(rng() % range);
+                    unsigned roll = static_cast<unsigned>(rng() % 100);
+                    if (roll < 90)
+                        search(key);
+                    else if (roll < 95)
+                        insert(key);
+                    else
+                        remove(key);
+                }
+            });
+        }
+        for (thread& worker : workers) worker.join();
+    });
+}
+
+int main(int argc, char* argv[]) {
+    size_t n = argc > 1 ? strtoull(argv[1], nullptr, 10) : 1000000;
+
+    mt19937_64 rng(42);
+    vector<double> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = static_cast<double>(2 * i);  // Even keys hit, odd keys miss
+    shuffle(keys.begin(), keys.end(), rng);
+    vector<double> misses(keys);
+    for (double& key : misses) key += 1;
+
+    cout << "n = " << n << endl;
+
+    AVLTree tree;
+    report("insert (random)", nanosPerOp(n, [&] {
+        for (double key : keys) tree.insert(key);
+    }));
+
+    // Sorted input, as from a timestamped feed: a full descent per value, then the finger, then hints
+    vector<double> ascending(keys);
+    sort(ascending.begin(), ascending.end());
+    {
+        AVLTree fromRoot;
+        report("insert (ascending)", nanosPerOp(n, [&] {
+            for (double key : ascending) fromRoot.insert(key);
+        }));
+        AVLTree fromFinger;
+        fromFinger.set_insert_mode(InsertMode::Finger);
+        report("insert (ascending, finger)", nanosPerOp(n, [&] {
+            for (double key : ascending) fromFinger.insert(key);
+        }));
+        AVLTree fromHint;
+        report("insert (ascending, hinted)", nanosPerOp(n, [&] {
+            AVLTree::const_iterator hint = fromHint.end();
+            for (double key : ascending) hint = fromHint.insert(hint, key);
+        }));
+    }
+
+    size_t found = 0;
+    report("search hit", nanosPerOp(n, [&] {
+        for (double key : keys) found += tree.search(key);
+    }));
+    report("search miss", nanosPerOp(n, [&] {
+        for (double key : misses) found += tree.search(key);
+    }));
+    unique_ptr<bool[]> batch(new bool[n]);
+    report("search hit (batch)", nanosPerOp(n, [&] {
+        tree.search_many(keys.data(), n, batch.get());
+    }));
+    found += static_cast<size_t>(count(batch.get(), batch.get() + n, true));
+    report("search miss (batch)", nanosPerOp(n, [&] {
+        tree.search_many(misses.data(), n, batch.get());
+    }));
+    found += static_cast<size_t>(count(batch.get(), batch.get() + n, true));
+
+    // A copy shares the nodes; only the filter in front of them is new
+    AVLTree filtered(tree);
+    filtered.set_lookup_filter(true);
+    report("search hit (filtered)", nanosPerOp(n, [&] {
+        for (double key : keys) found += filtered.search(key);
+    }));
+    report("search miss (filtered)", nanosPerOp(n, [&] {
+        for (double key : misses) found += filtered.search(key);
+    }));
+
+    // The same tree with 24-byte index-linked nodes, grown by inserts and then bulk-loaded
+    AVLTree compact(StorageEngine::Compact);
+    report("insert (compact)", nanosPerOp(n, [&] {
+        for (double key : keys) compact.insert(key);
+    }));
+    report("search hit (compact)", nanosPerOp(n, [&] {
+        for (double key : keys) found += compact.search(key);
+    }));
+    report("search miss (compact)", nanosPerOp(n, [&] {
+        for (double key : misses) found += compact.search(key);
+    }));
+    AVLTree compactLoaded(keys.begin(), keys.end(), DuplicatePolicy::Reject, StorageEngine::Compact);
+    report("search hit (compact, loaded)", nanosPerOp(n, [&] {
+        for (double key : keys) found += compactLoaded.search(key);
+    }));
+    report("search hit (compact, batch)", nanosPerOp(n, [&] {
+        compactLoaded.search_many(keys.data(), n, batch.get());
+    }));
+    found += static_cast<size_t>(count(batch.get(), batch.get() + n, true));
+
+    // A B+-tree with 16-way inner nodes and 29-value leaves, about a quarter of the levels
+    AVLTree bplus(StorageEngine::BPlus);
+    report("insert (b+)", nanosPerOp(n, [&] {
+        for (double key : keys) bplus.insert(key);
+    }));
+    report("search hit (b+)", nanosPerOp(n, [&] {
+        for (double key : keys) found += bplus.search(key);
+    }));
+    report("search miss (b+)", nanosPerOp(n, [&] {
+        for (double key : misses) found += bplus.search(key);
+    }));
+    report("in-order scan (b+)", nanosPerOp(n, [&] {
+        for (double value : bplus) found += value >= 0;
+    }));
+    found -= 7 * n;
+    cout << left << setw(28) << "memory (linked)" << right << setw(10)
+         << static_cast<double>(tree.stats().memoryBytes) / static_cast<double>(n) << " bytes/value" << endl;
+    cout << left << setw(28) << "memory (compact)" << right << setw(10)
+         << static_cast<double>(compact.stats().memoryBytes) / static_cast<double>(n) << " bytes/value" << endl;
+    cout << left << setw(28) << "memory (b+)" << right << setw(10)
+         << static_cast<double>(bplus.stats().memoryBytes) / static_cast<double>(n) << " bytes/value" << endl;
+
+    // Sixteen copies of every value on average: counted copies against copies made distinct by a tiny offset
+    {
+        vector<double> repeated(n);
+        for (size_t i = 0; i < n; ++i) repeated[i] = static_cast<double>(rng() % (n / 16 + 1));
+        AVLTree counted(StorageEngine::Linked, DuplicatePolicy::Count);
+        report("insert (repeated, counted)", nanosPerOp(n, [&] {
+            for (double value : repeated) counted.insert(value);
+        }));
+        AVLTree jittered;
+        report("insert (repeated, jittered)", nanosPerOp(n, [&] {
+            for (size_t i = 0; i < n; ++i) jittered.insert(repeated[i] + static_cast<double>(i) / static_cast<double>(n));
+        }));
+        cout << left << setw(28) << "memory (counted)" << right << setw(10)
+             << static_cast<double>(counted.stats().memoryBytes) / static_cast<double>(n) << " bytes/value" << endl;
+        cout << left << setw(28) << "memory (jittered)" << right << setw(10)
+             << static_cast<double>(jittered.stats().memoryBytes) / static_cast<double>(n) << " bytes/value" << endl;
+    }
+
+    BasicAVLTree<double> inlined(keys.begin(), keys.end());
+    report("search hit (template)", nanosPerOp(n, [&] {
+        for (double key : keys) found += inlined.search(key);
+    }));
+    vector<int64_t> integerKeys(keys.begin(), keys.end());
+    BasicAVLTree<int64_t> integers(integerKeys.begin(), integerKeys.end());
+    report("search hit (int64 keys)", nanosPerOp(n, [&] {
+        for (int64_t key : integerKeys) found += integers.search(key);
+    }));
+    found -= 2 * n;
+
+    FrozenAVLTree frozen = tree.freeze();
+    report("search hit (frozen)", nanosPerOp(n, [&] {
+        for (double key : keys) found += frozen.search(key);
+    }));
+    unique_ptr<bool[]> results(new bool[n]);
+    report("search hit (frozen batch)", nanosPerOp(n, [&] {
+        frozen.search_many(keys.data(), n, results.get());
+    }));
+    found += static_cast<size_t>(count(results.get(), results.get() + n, true));
+    found -= 2 * n;
+
+    double copyNanos = nanosPerOp(n, [&] {
+        AVLTree copy(tree);
+        found += copy[keys[0]];
+    });
+    report("copy (per node)", copyNanos);
+    report("copy + first write", nanosPerOp(n, [&] {
+        AVLTree copy(tree);
+        copy -= keys[0];  // Detaches the copy from the shared nodes
+        found += copy[keys[0]];
+    }));
+
+    // Same values in another shape, then one value changed: the hash rejects the latter without a walk
+    {
+        AVLTree reshaped(keys.begin(), keys.end());
+        AVLTree changed(reshaped);
+        changed -= keys[0];
+        changed += -1;
+        report("equality (equal, per node)", nanosPerOp(n, [&] {
+            found += tree == reshaped;
+        }));
+        report("equality (unequal)", nanosPerOp(n, [&] {
+            for (size_t i = 0; i < n; ++i) found += tree == changed;
+        }));
+        found -= 1;
+    }
+
+    report("export (toString)", nanosPerOp(n, [&] {
+        found += tree.toString().empty();
+    }));
+    FILE* devNull = fopen("/dev/null", "w");
+    if (devNull) {
+        FileDescriptorSink sink(fileno(devNull));
+        report("export (fd sink)", nanosPerOp(n, [&] {
+            tree.write(sink);
+        }));
+        fclose(devNull);
+    }
+    double exported = 0;
+    report("export (iterators)", nanosPerOp(n, [&] {
+        for (double val : tree) exported += val;
+    }));
+    found += exported < 0;
+
+    // Time spent on the calling thread to drop a tree of n nodes
+    AVLTree dropped(tree);
+    dropped -= keys[0];
+    report("clear (per node)", nanosPerOp(n, [&] {
+        !dropped;
+    }));
+    dropped = tree;
+    dropped -= keys[0];
+    report("clear_async (per node)", nanosPerOp(n, [&] {
+        dropped.clear_async();
+    }));
+    AVLTree::wait_for_reclamation();
+
+    const string snapshotPath = "bench_snapshot.bin";
+    report("snapshot save", nanosPerOp(n, [&] {
+        tree.save(snapshotPath);
+    }));
+    report("snapshot load", nanosPerOp(n, [&] {
+        found += AVLTree::load(snapshotPath)[keys[0]] - 1;
+    }));
+    remove(snapshotPath.c_str());
+    ostringstream dump;
+    dump.precision(17);
+    for (double val : tree) dump << val << " ";
+    report("reload from text", nanosPerOp(n, [&] {
+        istringstream text(dump.str());
+        AVLTree reloaded;
+        for (double val; text >> val;) reloaded.insert(val);
+        found += reloaded[keys[0]] - 1;
+    }));
+
+    PersistentAVLTree persistent;
+    report("insert (persistent)", nanosPerOp(n, [&] {
+        for (double key : keys) persistent.insert(key);
+    }));
+    report("search hit (persistent)", nanosPerOp(n, [&] {
+        for (double key : keys) found += persistent.search(key);
+    }));
+    report("search hit (snapshot)", nanosPerOp(n, [&] {
+        PersistentAVLTree::Snapshot view = persistent.snapshot();
+        for (double key : keys) found += view.search(key);
+    }));
+    report("remove (persistent)", nanosPerOp(n, [&] {
+        for (double key : keys) persistent.remove(key);
+    }));
+    found -= 2 * n;
+
+    // Merging a day's partition into the main tree: one insert per value against one join-based union
+    size_t partition = min(n, n / 10 + 1);
+    AVLTree daily(misses.begin(), misses.begin() + static_cast<ptrdiff_t>(partition));
+    AVLTree reinserted(tree);
+    report("union (insert loop)", nanosPerOp(partition, [&] {
+        for (double val : daily) reinserted.insert(val);
+    }));
+    AVLTree joined(tree);
+    report("union (join-based)", nanosPerOp(partition, [&] {
+        joined.set_union(daily);
+    }));
+    report("difference (join-based)", nanosPerOp(partition, [&] {
+        joined.set_difference(daily);
+    }));
+    found += reinserted.size() != n + partition || joined.size() != n;
+    vector<double> later(partition);
+    for (size_t i = 0; i < partition; ++i) later[i] = static_cast<double>(2 * n + i);  // Beyond every stored key
+    AVLTree nextDay(later.begin(), later.end());
+    report("union (insert loop, later)", nanosPerOp(partition, [&] {
+        for (double val : later) reinserted.insert(val);
+    }));
+    report("union (join-based, later)", nanosPerOp(partition, [&] {
+        joined.set_union(nextDay);
+    }));
+    found += reinserted.size() != n + 2 * partition || joined.size() != n + partition;
+
+    report("remove (random)", nanosPerOp(n, [&] {
+        for (double key : keys) tree.remove(key);
+    }));
+
+    AVLTree sequential;
+    report("insert (ascending)", nanosPerOp(n, [&] {
+        for (size_t i = 0; i < n; ++i) sequential.insert(static_cast<double>(i));
+    }));
+
+    // Mixed workload over a half-full key range: concurrent tree against a mutex-guarded AVLTree
+    size_t range = 2 * min<size_t>(n, 100000);
+    ConcurrentAVLTree concurrent;
+    AVLTree guarded;
+    mutex guard;
+    for (size_t i = 0; i < range; i += 2) {
+        concurrent.insert(static_cast<double>(i));
+        guarded.insert(static_cast<double>(i));
+    }
+    for (unsigned threads = 1; threads <= 64; threads *= 2) {
+        report("mixed concurrent x" + to_string(threads), mixedNanosPerOp(n, threads, range,
+            [&](double key) { return concurrent.search(key); },
+            [&](double key) { concurrent.tryInsert(key); },
+            [&](double key) { concurrent.remove(key); }));
+        report("mixed mutex x" + to_string(threads), mixedNanosPerOp(n, threads, range,
+            [&](double key) {
+                lock_guard<mutex> lock(guard);
+                return guarded.search(key);
+            },
+            [&](double key) {
+                lock_guard<mutex> lock(guard);
+                if (!guarded.search(key)) guarded.insert(key);
+            },
+            [&](double key) {
+                lock_guard<mutex> lock(guard);
+                guarded.remove(key);
+            }));
+    }
+
+    // Journaled inserts of the same keys, to set against "insert (random)"; a sync per write is capped
+    const string durableDirectory = "bench_durable";
+    size_t synced = min<size_t>(n, 20000);
+    filesystem::remove_all(durableDirectory);
+    {
+        DurableAVLTree durable(durableDirectory);
+        report("insert (durable, synced)", nanosPerOp(synced, [&] {
+            for (size_t i = 0; i < synced; ++i) durable.insert(keys[i]);
+        }));
+    }
+    filesystem::remove_all(durableDirectory);
+    {
+        DurableAVLTree durable(durableDirectory);
+        const unsigned writers = 8;
+        report("insert (durable, 8 writers)", nanosPerOp(synced, [&] {
+            vector<thread> workers;
+            for (unsigned t = 0; t < writers; ++t) {
+                workers.emplace_back([&, t] {
+                    for (size_t i = t; i < synced; i += writers) durable.insert(keys[i]);
+                });
+            }
+            for (thread& worker : workers) worker.join();
+        }));
+    }
+    filesystem::remove_all(durableDirectory);
+    {
+        DurabilityOptions options;
+        options.sync = SyncMode::Interval;
+        DurableAVLTree durable(durableDirectory, options);
+        report("insert (durable, interval)", nanosPerOp(n, [&] {
+            for (double key : keys) durable.insert(key);
+            durable.flush();
+        }));
+    }
+    filesystem::remove_all(durableDirectory);
+    {
+        // The slowest single insert while checkpoints start every n / 4 records, which a writer must not pay for
+        DurabilityOptions options;
+        options.sync = SyncMode::Interval;
+        options.checkpointEvery = max<size_t>(n / 4, 1);
+        DurableAVLTree durable(durableDirectory, options);
+        Clock::duration slowest{};
+        for (double key : keys) {
+            auto start = Clock::now();
+            durable.insert(key);
+            slowest = max(slowest, Clock::now() - start);
+        }
+        durable.wait_for_checkpoint();
+        report("insert (durable, max stall)", static_cast<double>(chrono::duration_cast<chrono::nanoseconds>(slowest).count()));
+    }
+    filesystem::remove_all(durableDirectory);
+
+    if (found != n + 1) {
+        cerr << "Unexpected search results: " << found << endl;
+        return 1;
+    }
+    return 0;
+}
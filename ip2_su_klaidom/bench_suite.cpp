@@ -0,0 +1,453 @@
+// Benchmark suite: runs the same workloads against AVLTree, BasicAVLTree<double> and
+// std::set<double> and writes the results as JSON for regression tracking.
+//
+//   ./bench_suite [--sizes 1000,10000,100000,1000000] [--json bench_results.json]
+//
+// Every result row holds:
+// - ops_per_sec: throughput of the whole run;
+// - p50_ns, p99_ns: latency of individually timed operations, sampled;
+// - bytes_per_element: heap bytes requested per stored value, malloc's own overhead not included;
+// - cache_misses: a hardware counter, or null off Linux and where perf_event_open is unavailable.
+// The whole-tree workloads (copy, copy_then_write, to_string, compare) count one
+// op per element. Their latency is that of the whole operation.
+#include "AVL_TREE.h"
+#include "BASIC_AVL_TREE.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+using namespace AVLProject;
+
+using Clock = chrono::steady_clock;
+
+// Live heap bytes, counted by the replaced global allocation functions below
+static atomic<size_t> liveBytes{0};
+
+// Every block is preceded by its requested size and by the address malloc returned, so that
+// delete can subtract the one and free the other whatever alignment the block was given
+static constexpr size_t kBlockHeader = sizeof(size_t) + sizeof(void*);
+
+static void* countedAllocate(size_t size, size_t alignment) {
+    alignment = max(alignment, alignof(max_align_t));
+    unsigned char* raw = static_cast<unsigned char*>(malloc(kBlockHeader + alignment - 1 + size));
+    if (!raw) throw bad_alloc();
+    uintptr_t start = (reinterpret_cast<uintptr_t>(raw) + kBlockHeader + alignment - 1) & ~(uintptr_t(alignment) - 1);
+    unsigned char* block = reinterpret_cast<unsigned char*>(start);
+    memcpy(block - kBlockHeader, &size, sizeof size);
+    memcpy(block - sizeof(void*), &raw, sizeof raw);
+    liveBytes.fetch_add(size, memory_order_relaxed);
+    return block;
+}
+
+static void countedRelease(void* block) noexcept {
+    if (!block) return;
+    unsigned char* header = static_cast<unsigned char*>(block) - kBlockHeader;
+    size_t size;
+    void* raw;
+    memcpy(&size, header, sizeof size);
+    memcpy(&raw, header + sizeof size, sizeof raw);
+    liveBytes.fetch_sub(size, memory_order_relaxed);
+    free(raw);
+}
+
+// The aligned forms matter: the B+ tree's nodes are cache-line aligned, so their slabs come from them
+
+void* operator new(size_t size) { return countedAllocate(size, alignof(max_align_t)); }
+void* operator new[](size_t size) { return countedAllocate(size, alignof(max_align_t)); }
+void* operator new(size_t size, align_val_t alignment) { return countedAllocate(size, static_cast<size_t>(alignment)); }
+void* operator new[](size_t size, align_val_t alignment) { return countedAllocate(size, static_cast<size_t>(alignment)); }
+
+void operator delete(void* block) noexcept { countedRelease(block); }
+void operator delete[](void* block) noexcept { countedRelease(block); }
+void operator delete(void* block, size_t) noexcept { countedRelease(block); }
+void operator delete[](void* block, size_t) noexcept { countedRelease(block); }
+void operator delete(void* block, align_val_t) noexcept { countedRelease(block); }
+void operator delete[](void* block, align_val_t) noexcept { countedRelease(block); }
+void operator delete(void* block, size_t, align_val_t) noexcept { countedRelease(block); }
+void operator delete[](void* block, size_t, align_val_t) noexcept { countedRelease(block); }
+
+#ifdef __linux__
+/**
+ * Counts last-level cache misses of this thread through perf_event_open, if the
+ * kernel allows it.
+ */
+class CacheMissCounter {
+private:
+    int fd = -1;
+
+public:
+    CacheMissCounter() {
+        perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.size = sizeof(attr);
+        attr.config = PERF_COUNT_HW_CACHE_MISSES;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        fd = static_cast<int>(syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    ~CacheMissCounter() {
+        if (fd >= 0) close(fd);
+    }
+
+    CacheMissCounter(const CacheMissCounter&) = delete;
+    CacheMissCounter& operator=(const CacheMissCounter&) = delete;
+
+    bool available() const { return fd >= 0; }
+
+    void start() {
+        if (fd < 0) return;
+        ioctl(fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+
+    long long stop() {
+        if (fd < 0) return -1;
+        ioctl(fd, PERF_EVENT_IOC_DISABLE, 0);
+        long long count = 0;
+        if (read(fd, &count, sizeof(count)) != static_cast<ssize_t>(sizeof(count))) return -1;
+        return count;
+    }
+};
+#else
+/**
+ * Stands in for the perf_event_open counter where there is none; every count is
+ * reported as null.
+ */
+class CacheMissCounter {
+public:
+    bool available() const { return false; }
+    void start() {}
+    long long stop() { return -1; }
+};
+#endif
+
+/**
+ * Zipfian ranks in [0, n) with skew theta, after Gray et al., "Quickly generating
+ * billion-record synthetic databases" (the generator YCSB uses). It needs O(1) memory.
+ */
+class ZipfGenerator {
+private:
+    double n, theta, alpha, zetan, eta;
+    uniform_real_distribution<double> uniform{0.0, 1.0};
+
+public:
+    ZipfGenerator(size_t count, double theta) : n(static_cast<double>(count)), theta(theta) {
+        zetan = 0;
+        for (size_t i = 1; i <= count; ++i) zetan += 1.0 / pow(static_cast<double>(i), theta);
+        double zeta2 = 1.0 + 1.0 / pow(2.0, theta);
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta2 / zetan);
+    }
+
+    template <typename Rng>
+    size_t operator()(Rng& rng) {
+        double u = uniform(rng);
+        double uz = u * zetan;
+        if (uz < 1.0) return 0;
+        if (uz < 1.0 + pow(0.5, theta)) return 1;
+        size_t rank = static_cast<size_t>(n * pow(eta * u - eta + 1.0, alpha));
+        return min(rank, static_cast<size_t>(n) - 1);
+    }
+};
+
+struct AVLTreeEngine {
+    static constexpr const char* name = "AVLTree";
+    AVLTree tree;
+    void insert(double val) { tree.insert(val); }
+    void remove(double val) { tree.remove(val); }
+    bool search(double val) const { return tree.search(val); }
+    size_t size() const { return tree.size(); }
+    string toString() const { return tree.toString(); }
+    bool operator==(const AVLTreeEngine& other) const { return tree == other.tree; }
+};
+
+struct CompactAVLTreeEngine {
+    static constexpr const char* name = "AVLTree(compact)";
+    AVLTree tree{StorageEngine::Compact};
+    void insert(double val) { tree.insert(val); }
+    void remove(double val) { tree.remove(val); }
+    bool search(double val) const { return tree.search(val); }
+    size_t size() const { return tree.size(); }
+    string toString() const { return tree.toString(); }
+    bool operator==(const CompactAVLTreeEngine& other) const { return tree == other.tree; }
+};
+
+struct BPlusTreeEngine {
+    static constexpr const char* name = "AVLTree(b+)";
+    AVLTree tree{StorageEngine::BPlus};
+    void insert(double val) { tree.insert(val); }
+    void remove(double val) { tree.remove(val); }
+    bool search(double val) const { return tree.search(val); }
+    size_t size() const { return tree.size(); }
+    string toString() const { return tree.toString(); }
+    bool operator==(const BPlusTreeEngine& other) const { return tree == other.tree; }
+};
+
+struct BasicAVLTreeEngine {
+    static constexpr const char* name = "BasicAVLTree<double>";
+    BasicAVLTree<double> tree;
+    void insert(double val) { tree.insert(val); }
+    void remove(double val) { tree.remove(val); }
+    bool search(double val) const { return tree.search(val); }
+    size_t size() const { return tree.size(); }
+    string toString() const {
+        ostringstream text;
+        text << tree;
+        return text.str();
+    }
+    bool operator==(const BasicAVLTreeEngine& other) const { return tree == other.tree; }
+};
+
+struct StdSetEngine {
+    static constexpr const char* name = "std::set<double>";
+    set<double> tree;
+    void insert(double val) { tree.insert(val); }
+    void remove(double val) { tree.erase(val); }
+    bool search(double val) const { return tree.count(val) != 0; }
+    size_t size() const { return tree.size(); }
+    string toString() const {
+        ostringstream text;
+        for (double val : tree) text << val << " ";
+        return text.str();
+    }
+    bool operator==(const StdSetEngine& other) const { return tree == other.tree; }
+};
+
+struct Result {
+    string engine;
+    string workload;
+    size_t size;
+    size_t ops;
+    double opsPerSec;
+    double p50;
+    double p99;
+    double bytesPerElement;  ///< Negative if not measured.
+    long long cacheMisses;   ///< Negative if not available.
+};
+
+/**
+ * Runs one workload: ops operations, every stride-th one timed on its own for the
+ * latency percentiles.
+ */
+class Runner {
+private:
+    CacheMissCounter misses;
+    vector<Result>& results;
+
+public:
+    explicit Runner(vector<Result>& results) : results(results) {}
+
+    bool countersAvailable() const { return misses.available(); }
+
+    template <typename Op>
+    Result& run(const char* engine, const char* workload, size_t size, size_t ops, Op op) {
+        size_t stride = max<size_t>(8, ops / 65536);
+        vector<double> latencies;
+        latencies.reserve(ops / stride + 1);
+
+        misses.start();
+        auto start = Clock::now();
+        for (size_t i = 0; i < ops; ++i) {
+            if (i % stride == 0) {
+                auto before = Clock::now();
+                op(i);
+                latencies.push_back(chrono::duration<double, nano>(Clock::now() - before).count());
+            } else {
+                op(i);
+            }
+        }
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+        long long missCount = misses.stop();
+        return record(engine, workload, size, ops, seconds, latencies, missCount);
+    }
+
+    /**
+     * Times an operation over the whole tree a few times; it counts as @p size ops.
+     */
+    template <typename Op>
+    Result& runWhole(const char* engine, const char* workload, size_t size, Op op) {
+        const int repeats = 5;
+        vector<double> latencies;
+        misses.start();
+        auto start = Clock::now();
+        for (int i = 0; i < repeats; ++i) {
+            auto before = Clock::now();
+            op();
+            latencies.push_back(chrono::duration<double, nano>(Clock::now() - before).count());
+        }
+        double seconds = chrono::duration<double>(Clock::now() - start).count();
+        long long missCount = misses.stop();
+        return record(engine, workload, size, size * repeats, seconds, latencies, missCount);
+    }
+
+private:
+    Result& record(const char* engine, const char* workload, size_t size, size_t ops, double seconds,
+                   vector<double>& latencies, long long missCount) {
+        sort(latencies.begin(), latencies.end());
+        auto percentile = [&](double p) {
+            if (latencies.empty()) return 0.0;
+            size_t index = static_cast<size_t>(p * static_cast<double>(latencies.size() - 1) + 0.5);
+            return latencies[index];
+        };
+        results.push_back({engine, workload, size, ops, static_cast<double>(ops) / max(seconds, 1e-9),
+                           percentile(0.50), percentile(0.99), -1, missCount});
+        const Result& row = results.back();
+        cout << left << setw(22) << engine << setw(18) << workload << right << setw(11) << size
+             << setw(14) << fixed << setprecision(0) << row.opsPerSec << " ops/s"
+             << setw(14) << setprecision(1) << row.p50 << setw(14) << row.p99 << " ns" << endl;
+        return results.back();
+    }
+};
+
+// Keeps search results observable so the optimizer cannot drop the lookups
+static size_t sink = 0;
+
+template <typename Engine>
+void runEngine(Runner& runner, size_t n, uint64_t seed) {
+    const char* name = Engine::name;
+    mt19937_64 rng(seed);
+
+    // Stored keys are even; odd keys never hit
+    vector<double> keys(n);
+    for (size_t i = 0; i < n; ++i) keys[i] = static_cast<double>(2 * i);
+    vector<double> shuffled(keys);
+    shuffle(shuffled.begin(), shuffled.end(), rng);
+
+    {
+        Engine ascending;
+        runner.run(name, "insert_sequential", n, n, [&](size_t i) { ascending.insert(keys[i]); });
+    }
+
+    size_t bytesBefore = liveBytes.load();
+    Engine engine;
+    Result& inserted = runner.run(name, "insert_random", n, n, [&](size_t i) { engine.insert(shuffled[i]); });
+    inserted.bytesPerElement = static_cast<double>(liveBytes.load() - bytesBefore) / static_cast<double>(n);
+
+    vector<size_t> uniformIndex(n);
+    for (size_t& index : uniformIndex) index = rng() % n;
+    runner.run(name, "search_random", n, n, [&](size_t i) { sink += engine.search(keys[uniformIndex[i]]); });
+
+    // Hot ranks map to scattered keys, so the hot set is not one subtree
+    ZipfGenerator zipf(n, 0.99);
+    vector<size_t> zipfIndex(n);
+    for (size_t& index : zipfIndex) index = zipf(rng);
+    runner.run(name, "search_zipf", n, n, [&](size_t i) { sink += engine.search(shuffled[zipfIndex[i]]); });
+
+    runner.runWhole(name, "copy", n, [&] {
+        Engine copy(engine);
+        sink += copy.size();
+    });
+    runner.runWhole(name, "copy_then_write", n, [&] {
+        Engine copy(engine);
+        copy.insert(-1);
+        sink += copy.size();
+    });
+    runner.runWhole(name, "to_string", n, [&] { sink += engine.toString().size(); });
+    Engine twin;
+    for (double key : shuffled) twin.insert(key);
+    runner.runWhole(name, "compare", n, [&] { sink += engine == twin; });
+
+    // 80% Zipfian searches, 10% inserts and 10% removes of random keys, odd ones included
+    vector<uint32_t> rolls(n);
+    for (uint32_t& roll : rolls) roll = static_cast<uint32_t>(rng() % 100);
+    runner.run(name, "mixed", n, n, [&](size_t i) {
+        if (rolls[i] < 80) {
+            sink += engine.search(shuffled[zipfIndex[i]]);
+        } else {
+            double key = static_cast<double>(uniformIndex[i] * 2 + (rolls[i] & 1));
+            if (rolls[i] < 90) {
+                if (!engine.search(key)) engine.insert(key);
+            } else {
+                engine.remove(key);
+            }
+        }
+    });
+
+    runner.run(name, "remove_random", n, n, [&](size_t i) { engine.remove(shuffled[i]); });
+}
+
+void writeJson(const string& path, const vector<Result>& results, bool countersAvailable) {
+    ofstream out(path);
+    if (!out) {
+        cerr << "Cannot write " << path << endl;
+        return;
+    }
+    out << "{\n  \"benchmark\": \"avl_tree\",\n  \"cache_counters\": " << (countersAvailable ? "true" : "false")
+        << ",\n  \"results\": [\n";
+    out << setprecision(17);
+    for (size_t i = 0; i < results.size(); ++i) {
+        const Result& row = results[i];
+        out << "    {\"engine\": \"" << row.engine << "\", \"workload\": \"" << row.workload
+            << "\", \"size\": " << row.size << ", \"ops\": " << row.ops
+            << ", \"ops_per_sec\": " << row.opsPerSec << ", \"p50_ns\": " << row.p50 << ", \"p99_ns\": " << row.p99
+            << ", \"bytes_per_element\": ";
+        if (row.bytesPerElement < 0) out << "null";
+        else out << row.bytesPerElement;
+        out << ", \"cache_misses\": ";
+        if (row.cacheMisses < 0) out << "null";
+        else out << row.cacheMisses;
+        out << "}" << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    out << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    vector<size_t> sizes = {1000, 10000, 100000, 1000000};
+    string jsonPath = "bench_results.json";
+    for (int i = 1; i < argc; ++i) {
+        string arg = argv[i];
+        if (arg == "--sizes" && i + 1 < argc) {
+            sizes.clear();
+            stringstream list(argv[++i]);
+            for (string item; getline(list, item, ',');)
+                if (!item.empty()) sizes.push_back(strtoull(item.c_str(), nullptr, 10));
+        } else if (arg == "--json" && i + 1 < argc) {
+            jsonPath = argv[++i];
+        } else {
+            cerr << "Usage: " << argv[0] << " [--sizes n1,n2,...] [--json path]" << endl;
+            return 1;
+        }
+    }
+
+    vector<Result> results;
+    Runner runner(results);
+    if (!runner.countersAvailable())
+        cout << "perf_event_open is unavailable; cache misses are reported as null" << endl;
+    for (size_t n : sizes) {
+        if (n == 0) continue;
+        runEngine<AVLTreeEngine>(runner, n, n);
+        runEngine<CompactAVLTreeEngine>(runner, n, n);
+        runEngine<BPlusTreeEngine>(runner, n, n);
+        runEngine<BasicAVLTreeEngine>(runner, n, n);
+        runEngine<StdSetEngine>(runner, n, n);
+    }
+    writeJson(jsonPath, results, runner.countersAvailable());
+    cout << "Wrote " << results.size() << " results to " << jsonPath << " (checksum " << sink << ")" << endl;
+    return 0;
+}
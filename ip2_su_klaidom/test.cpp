@@ -1,13 +1,91 @@
 #include "AVL_TREE.h"
+#include "AVL_SNAPSHOT.h"
+#include "BASIC_AVL_TREE.h"
+#include "FROZEN_AVL_TREE.h"
+#include "PERSISTENT_AVL_TREE.h"
+#include "CONCURRENT_AVL_TREE.h"
+#include "DURABLE_AVL_TREE.h"
+#include <algorithm>
 #include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <functional>
 #include <iostream>
+#include <cstdio>
+#include <filesystem>
 #include <fstream>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <numeric>
+#include <vector>
+#include <random>
+#include <set>
+#include <sstream>
+#include <thread>
+#include <atomic>
 
 using namespace std;
 using namespace AVLProject;
 
 ofstream logFile("log.txt");
 
+// Allocation failure injection: once armed, the allocation that brings the countdown to zero throws
+atomic<long> allocationsUntilFailure{-1};
+atomic<long> liveAllocations{0};
+
+void* allocate(size_t bytes) {
+    if (allocationsUntilFailure.load(memory_order_relaxed) >= 0 && allocationsUntilFailure.fetch_sub(1) == 0)
+        throw bad_alloc();
+    void* address = malloc(bytes ? bytes : 1);
+    if (!address) throw bad_alloc();
+    liveAllocations.fetch_add(1, memory_order_relaxed);
+    return address;
+}
+
+void release(void* address) noexcept {
+    if (!address) return;
+    liveAllocations.fetch_sub(1, memory_order_relaxed);
+    free(address);
+}
+
+void* operator new(size_t bytes) { return allocate(bytes); }
+void* operator new[](size_t bytes) { return allocate(bytes); }
+void* operator new(size_t bytes, const nothrow_t&) noexcept {
+    try {
+        return allocate(bytes);
+    } catch (const bad_alloc&) {
+        return nullptr;
+    }
+}
+void* operator new[](size_t bytes, const nothrow_t& tag) noexcept { return operator new(bytes, tag); }
+void operator delete(void* address) noexcept { release(address); }
+void operator delete[](void* address) noexcept { release(address); }
+void operator delete(void* address, size_t) noexcept { release(address); }
+void operator delete[](void* address, size_t) noexcept { release(address); }
+void operator delete(void* address, const nothrow_t&) noexcept { release(address); }
+void operator delete[](void* address, const nothrow_t&) noexcept { release(address); }
+
+// Runs body with allocation number k failing, for k = 0, 1, ... until body gets through;
+// after every failure, check() must hold and no allocation made by the attempt may be left
+template <typename Body, typename Check>
+void failEachAllocation(Body body, Check check) {
+    for (long k = 0;; ++k) {
+        long live = liveAllocations.load();
+        allocationsUntilFailure = k;
+        try {
+            body();
+            allocationsUntilFailure = -1;
+            return;
+        } catch (const bad_alloc&) {
+            allocationsUntilFailure = -1;
+        }
+        assert(liveAllocations.load() == live);
+        check();
+    }
+}
+
 void log(const string& message) {
     cout << message << endl;
     logFile << message << endl;
@@ -83,6 +161,17 @@ void testEqualityAndInequalityOperators() {
     assert(tree1 == tree2);
     tree2 += 30;
     assert(tree1 != tree2);
+
+    // Equality ignores the order of insertion, and so the shape
+    AVLTree ascending, descending;
+    for (int i = 0; i < 100; ++i) {
+        ascending += i;
+        descending += 99 - i;
+    }
+    assert(ascending == descending);
+    descending.remove(50);
+    descending += 50.5;
+    assert(ascending != descending);
     log("Test 7: Equality and Inequality Operators - PASSED");
 }
 
@@ -139,6 +228,1178 @@ void testDuplicateValue() {
     log("Test 11: Duplicate Value - PASSED");
 }
 
+void testNodeReuseAfterChurn() {
+    AVLTree tree;
+    for (int round = 0; round < 3; ++round) {
+        for (int i = 0; i < 500; ++i) tree += i;
+        for (int i = 0; i < 500; i += 2) tree -= i;
+        for (int i = 1; i < 500; i += 2) assert(tree[i]);
+        assert(!tree[250]);
+        !tree;
+        assert(tree.toString() == "");
+    }
+    tree += 1;
+    tree += 2;
+    assert(tree.toString() == "1 2 ");
+    log("Test 12: Node Reuse After Churn - PASSED");
+}
+
+void testBulkLoad() {
+    AVLTree fromList{30, 10, 20};
+    assert(fromList.toString() == "10 20 30 ");
+
+    vector<double> values;
+    for (int i = 999; i >= 0; --i) values.push_back(i);
+    AVLTree tree(values.begin(), values.end());
+    for (int i = 0; i < 1000; ++i) assert(tree[i]);
+    tree -= 500;
+    tree += 1000.5;
+    assert(!tree[500] && tree[1000.5]);
+
+    vector<double> repeated = {3, 1, 2, 3, 1};
+    try {
+        tree.assign(repeated);
+        assert(false);
+    } catch (const DuplicateValueException&) {
+        assert(tree[999] && !tree[500]);  // Unchanged after a rejected load
+    }
+    tree.assign(repeated, DuplicatePolicy::Ignore);
+    assert(tree.toString() == "1 2 3 ");
+    log("Test 13: Bulk Load - PASSED");
+}
+
+void testRandomOperationsMatchSet() {
+    AVLTree tree;
+    set<double> reference;
+    mt19937 rng(7);
+    for (int i = 0; i < 20000; ++i) {
+        double val = rng() % 2000;
+        if (rng() % 3) {
+            if (!reference.count(val)) {
+                tree += val;
+                reference.insert(val);
+            }
+        } else {
+            tree -= val;
+            reference.erase(val);
+        }
+        assert(tree[val] == (reference.count(val) > 0));
+    }
+
+    ostringstream expected;
+    for (double val : reference) expected << val << " ";
+    assert(tree.toString() == expected.str());
+
+    AVLTree copy(tree);
+    assert(copy == tree);
+    assert(copy.toString() == expected.str());
+    log("Test 14: Random Operations Match std::set - PASSED");
+}
+
+void testOrderStatistics() {
+    AVLTree tree;
+    assert(tree.size() == 0 && tree.empty());
+    try {
+        tree.median();
+        assert(false);
+    } catch (const out_of_range&) {
+    }
+
+    for (int val : {50, 20, 80, 10, 30, 70, 90}) tree += val;
+    assert(tree.size() == 7);
+    assert(tree.rank(10) == 0);
+    assert(tree.rank(55) == 4);
+    assert(tree.rank(1000) == 7);
+    assert(tree.select(0) == 10);
+    assert(tree.select(6) == 90);
+    assert(tree.median() == 50);
+    tree -= 90;
+    assert(tree.median() == 40);
+    try {
+        tree.select(6);
+        assert(false);
+    } catch (const out_of_range&) {
+    }
+    log("Test 15: Size, Rank, Select and Median - PASSED");
+}
+
+void testIteratorsAndBounds() {
+    AVLTree tree;
+    assert(tree.begin() == tree.end());
+    for (int val : {40, 10, 30, 20, 50}) tree += val;
+
+    vector<double> forward(tree.begin(), tree.end());
+    assert((forward == vector<double>{10, 20, 30, 40, 50}));
+    vector<double> backward(tree.rbegin(), tree.rend());
+    assert((backward == vector<double>{50, 40, 30, 20, 10}));
+    assert(*--tree.end() == 50);
+
+    assert(*tree.find(30) == 30);
+    assert(tree.find(35) == tree.end());
+    assert(*tree.lower_bound(30) == 30);
+    assert(*tree.lower_bound(31) == 40);
+    assert(*tree.upper_bound(30) == 40);
+    assert(tree.upper_bound(50) == tree.end());
+    assert(distance(tree.lower_bound(15), tree.upper_bound(45)) == 3);
+
+    auto range = tree.equal_range(20);
+    assert(distance(range.first, range.second) == 1 && *range.first == 20);
+
+    AVLTree::const_iterator kept = tree.find(40);
+    tree -= 30;  // Removing another value leaves existing iterators valid
+    assert(*kept == 40 && *--kept == 20);
+    log("Test 16: Iterators and Bounds - PASSED");
+}
+
+void testRangeAggregates() {
+    AVLTree tree;
+    assert(tree.range_count(0, 100) == 0 && !tree.range_minmax(0, 100));
+    for (int val = 1; val <= 100; ++val) tree += val;
+
+    assert(tree.range_count(10, 20) == 11);
+    assert(tree.range_sum(10, 20) == 165);
+    assert(tree.range_count(0.5, 1000) == 100);
+    assert(tree.range_sum(0.5, 1000) == 5050);
+    assert(tree.range_count(20.5, 20.7) == 0 && tree.range_sum(20.5, 20.7) == 0);
+    assert(tree.range_count(30, 10) == 0);
+
+    auto minmax = tree.range_minmax(9.5, 42.5);
+    assert(minmax && minmax->first == 10 && minmax->second == 42);
+    assert(!tree.range_minmax(100.5, 200));
+
+    mt19937 rng(11);
+    for (int i = 0; i < 200; ++i) {
+        double lo = rng() % 110, hi = rng() % 110;
+        size_t count = 0;
+        double sum = 0;
+        for (double val : tree) {
+            if (val >= lo && val <= hi) {
+                ++count;
+                sum += val;
+            }
+        }
+        assert(tree.range_count(lo, hi) == count && tree.range_sum(lo, hi) == sum);
+    }
+    log("Test 17: Range Aggregates - PASSED");
+}
+
+void testSnapshotSaveAndLoad() {
+    const string path = "snapshot_test.bin";
+    AVLTree tree;
+    for (int i = 0; i < 5000; ++i) tree += (i * 37) % 5000 + 0.25;
+    tree.save(path);
+
+    AVLTree loaded = AVLTree::load(path);
+    assert(loaded.size() == 5000);
+    assert(loaded.toString() == tree.toString());
+    loaded += 10000;  // A loaded tree is an ordinary tree
+    assert(loaded[10000] && loaded.size() == 5001);
+
+    {
+        MappedSnapshot mapped(path);
+        assert(mapped.size() == 5000);
+        assert(mapped.search(42.25) && !mapped.search(42));
+        assert(mapped.rank(100) == 100);
+        assert(mapped.range_count(10, 19.5) == 10);
+    }
+
+    AVLTree().save(path);
+    assert(AVLTree::load(path).empty());
+
+    tree.save(path);
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        file.seekp(sizeof(SnapshotHeader) + 100);
+        file.put('\x7f');
+    }
+    try {
+        AVLTree::load(path);
+        assert(false);
+    } catch (const SnapshotException&) {
+    }
+
+    // A count whose byte size wraps around to the real payload size must not get past the header
+    AVLTree{1.5}.save(path);
+    {
+        fstream file(path, ios::in | ios::out | ios::binary);
+        uint64_t wrapping = (uint64_t(1) << 61) + 1;
+        file.seekp(offsetof(SnapshotHeader, count));
+        file.write(reinterpret_cast<const char*>(&wrapping), sizeof wrapping);
+    }
+    try {
+        MappedSnapshot mapped(path);
+        assert(false);
+    } catch (const SnapshotException&) {
+    }
+    try {
+        AVLTree::load(path);
+        assert(false);
+    } catch (const SnapshotException&) {
+    }
+    remove(path.c_str());
+
+    try {
+        AVLTree::load(path);
+        assert(false);
+    } catch (const SnapshotException&) {
+    }
+    log("Test 18: Snapshot Save and Load - PASSED");
+}
+
+void testFormattedOutput() {
+    AVLTree tree{0.1, 2.5, 1000001, -3};
+    assert(tree.toString() == "-3 0.1 2.5 1e+06 ");
+
+    FormatOptions exact;
+    exact.separator = ",";
+    exact.precision = -1;
+    exact.trailingSeparator = false;
+    assert(tree.toString(exact) == "-3,0.1,2.5,1000001");
+
+    FormatOptions fixed;
+    fixed.precision = 2;
+    fixed.format = chars_format::fixed;
+    fixed.separator = "\n";
+    assert(tree.toString(fixed) == "-3.00\n0.10\n2.50\n1000001.00\n");
+
+    ostringstream os;
+    os.precision(8);
+    os << tree;
+    assert(os.str() == "-3 0.1 2.5 1000001 ");
+
+    string chunked;
+    StringSink stringSink(chunked);
+    AVLTree large;
+    for (int i = 0; i < 20000; ++i) large += i;
+    large.write(stringSink, exact);
+    assert(chunked.size() == large.toString(exact).size() && chunked.substr(0, 6) == "0,1,2,");
+
+    FILE* file = tmpfile();
+    assert(file);
+    FileDescriptorSink fdSink(fileno(file));
+    tree.write(fdSink);
+    rewind(file);
+    char text[64] = {};
+    size_t read = fread(text, 1, sizeof(text) - 1, file);
+    fclose(file);
+    assert(string(text, read) == "-3 0.1 2.5 1e+06 ");
+    log("Test 19: Formatted Output and Sinks - PASSED");
+}
+
+void testBasicTreeKeyTypes() {
+    BasicAVLTree<int64_t> integers;
+    set<int64_t> reference;
+    mt19937 rng(11);
+    for (int i = 0; i < 5000; ++i) {
+        int64_t key = static_cast<int64_t>(rng() % 2000) - 1000;
+        if (rng() % 3 == 0) {
+            assert(integers.remove(key) == (reference.erase(key) == 1));
+        } else if (reference.insert(key).second) {
+            integers += key;
+        } else {
+            try {
+                integers.insert(key);
+                assert(false);
+            } catch (const DuplicateValueException&) {
+            }
+        }
+    }
+    assert(integers.size() == reference.size());
+    assert(equal(integers.begin(), integers.end(), reference.begin(), reference.end()));
+    assert(integers.height() <= 15);
+    assert(*integers.lower_bound(0) == *reference.lower_bound(0));
+
+    BasicAVLTree<int64_t> copy(integers);
+    assert(copy == integers);
+    --copy;
+    assert(copy != integers && copy.size() + 1 == integers.size());
+
+    BasicAVLTree<uint32_t, greater<uint32_t>> descending{3, 1, 4, 5, 9, 2, 6};
+    ostringstream os;
+    os << descending;
+    assert(os.str() == "9 6 5 4 3 2 1 ");
+    assert(*descending.upper_bound(4) == 3 && descending[9] && !descending[7]);
+
+    BasicAVLTree<string> words{"pear", "apple", "fig"};
+    assert(*words.begin() == "apple" && *words.rbegin() == "pear");
+    try {
+        words += "fig";
+        assert(false);
+    } catch (const DuplicateValueException&) {
+    }
+    !words;
+    assert(words.empty() && words.begin() == words.end());
+    log("Test 20: Templated Tree Key Types - PASSED");
+}
+
+void testFrozenTree() {
+    FrozenAVLTree empty = AVLTree().freeze();
+    assert(empty.empty() && !empty.search(0) && !empty.lower_bound(0));
+
+    for (int n = 1; n <= 70; ++n) {
+        AVLTree tree;
+        for (int i = 0; i < n; ++i) tree += 2 * i;
+        FrozenAVLTree frozen = tree.freeze();
+        assert(frozen.size() == static_cast<size_t>(n));
+
+        vector<double> keys;
+        for (int i = -2; i <= 2 * n; ++i) keys.push_back(i);
+        vector<char> batch(keys.size());
+        frozen.search_many(keys.data(), keys.size(), reinterpret_cast<bool*>(batch.data()));
+        for (size_t i = 0; i < keys.size(); ++i) {
+            double key = keys[i];
+            bool stored = key >= 0 && key < 2 * n && static_cast<int>(key) % 2 == 0;
+            assert(frozen.search(key) == stored && frozen[key] == stored);
+            assert(static_cast<bool>(batch[i]) == stored);
+            optional<double> bound = frozen.lower_bound(key);
+            auto expected = tree.lower_bound(key);
+            assert(bound ? expected != tree.end() && *expected == *bound : expected == tree.end());
+        }
+    }
+
+    vector<double> sorted{-1.5, 0, 2.25, 1e9};
+    FrozenAVLTree fromArray(sorted.data(), sorted.size());
+    FrozenAVLTree shared = fromArray;
+    assert(shared[2.25] && !shared[2.5] && *shared.lower_bound(3) == 1e9);
+    try {
+        vector<double> unsorted{1, 3, 2};
+        FrozenAVLTree rejected(unsorted.data(), unsorted.size());
+        assert(false);
+    } catch (const invalid_argument&) {
+    }
+    log("Test 21: Frozen Tree Search - PASSED");
+}
+
+void testPersistentTree() {
+    PersistentAVLTree tree;
+    set<double> reference;
+    mt19937 rng(5);
+    for (int i = 0; i < 3000; ++i) {
+        double key = rng() % 500;
+        if (rng() % 2) {
+            assert(tree.remove(key) == (reference.erase(key) == 1));
+        } else if (reference.insert(key).second) {
+            tree += key;
+        } else {
+            try {
+                tree.insert(key);
+                assert(false);
+            } catch (const DuplicateValueException&) {
+            }
+        }
+    }
+    assert(tree.size() == reference.size());
+    for (double key = 0; key < 500; ++key) assert(tree[key] == (reference.count(key) == 1));
+
+    {
+        PersistentAVLTree::Snapshot before = tree.snapshot();
+        string text = before.toString();
+        tree += 1000;
+        tree -= *reference.begin();
+        assert(before.toString() == text && !before[1000] && before[*reference.begin()]);
+        assert(tree.snapshot().size() == before.size());
+    }
+
+    AVLTree source{3, 1, 2};
+    PersistentAVLTree copied(source);
+    assert(copied.snapshot().toString() == "1 2 3 ");
+
+    // Keys 0..999 stay put while a writer churns the keys above them
+    PersistentAVLTree shared;
+    for (int i = 0; i < 1000; ++i) shared += i;
+    atomic<bool> done{false};
+    atomic<int> failures{0};
+    vector<thread> readers;
+    for (int r = 0; r < 3; ++r) {
+        readers.emplace_back([&] {
+            while (!done.load()) {
+                PersistentAVLTree::Snapshot view = shared.snapshot();
+                if (!view[0] || !view[999] || view.size() < 1000) ++failures;
+                for (int i = 0; i < 1000; i += 37) {
+                    if (!shared.search(i)) ++failures;
+                }
+            }
+        });
+    }
+    for (int round = 0; round < 20; ++round) {
+        for (int i = 1000; i < 1500; ++i) shared += i;
+        for (int i = 1000; i < 1500; ++i) shared -= i;
+    }
+    done = true;
+    for (thread& reader : readers) reader.join();
+    assert(failures == 0 && shared.size() == 1000);
+    log("Test 22: Persistent Tree Versions - PASSED");
+}
+
+void testConcurrentTree() {
+    ConcurrentAVLTree tree;
+    set<double> reference;
+    mt19937 rng(17);
+    for (int i = 0; i < 5000; ++i) {
+        double key = rng() % 400;
+        if (rng() % 2) {
+            assert(tree.remove(key) == (reference.erase(key) == 1));
+        } else if (reference.insert(key).second) {
+            tree += key;
+        } else {
+            try {
+                tree.insert(key);
+                assert(false);
+            } catch (const DuplicateValueException&) {
+            }
+        }
+    }
+    assert(tree.size() == reference.size());
+    for (double key = 0; key < 400; ++key) assert(tree[key] == (reference.count(key) == 1));
+
+    // Writers own interleaved key classes; readers check that keys 0..499 never disappear
+    ConcurrentAVLTree shared;
+    for (int i = 0; i < 500; ++i) shared += i;
+    const int writers = 4;
+    atomic<bool> done{false};
+    atomic<int> failures{0};
+    vector<thread> threads;
+    for (int r = 0; r < 2; ++r) {
+        threads.emplace_back([&] {
+            while (!done.load()) {
+                for (int i = 0; i < 500; i += 7) {
+                    if (!shared.search(i)) ++failures;
+                }
+            }
+        });
+    }
+    vector<thread> writerThreads;
+    for (int w = 0; w < writers; ++w) {
+        writerThreads.emplace_back([&, w] {
+            for (int round = 0; round < 5; ++round) {
+                for (int i = 500 + w; i < 4500; i += writers) {
+                    if (!shared.tryInsert(i)) ++failures;
+                }
+                for (int i = 500 + w; i < 4500; i += writers) {
+                    if (round < 4 || i % 2 == 0) {
+                        if (!shared.remove(i)) ++failures;
+                    }
+                }
+            }
+        });
+    }
+    for (thread& writer : writerThreads) writer.join();
+    done = true;
+    for (thread& reader : threads) reader.join();
+    assert(failures == 0);
+    assert(shared.size() == 500 + 2000);
+    for (int i = 0; i < 4500; ++i) assert(shared[i] == (i < 500 || i % 2 == 1));
+
+    ConcurrentAVLTree small;
+    small += 2;
+    small += 1;
+    small += 3;
+    small -= 2;
+    assert(small.toString() == "1 3 ");
+    log("Test 23: Concurrent Tree Operations - PASSED");
+}
+
+void testSetOperations() {
+    AVLTree evens, thirds;
+    set<double> evenSet, thirdSet;
+    for (int i = 0; i < 30000; i += 2) {
+        evens += i;
+        evenSet.insert(i);
+    }
+    for (int i = 0; i < 30000; i += 3) {
+        thirds += i;
+        thirdSet.insert(i);
+    }
+
+    // Four threads take the parallel path; the operators run with one thread per core
+    AVLTree united(evens);
+    united.set_union(thirds, 4);
+    set<double> expected(evenSet);
+    expected.insert(thirdSet.begin(), thirdSet.end());
+    assert(united.size() == expected.size());
+    assert(equal(united.begin(), united.end(), expected.begin()));
+    assert(united == evens + thirds);
+
+    AVLTree common(evens);
+    common.set_intersection(thirds, 4);
+    assert(common.size() == 5000);
+    for (double val : common) assert(static_cast<int>(val) % 6 == 0);
+    assert((evens & thirds).size() == 5000);
+
+    AVLTree onlyEven(evens);
+    onlyEven.set_difference(thirds, 4);
+    assert(onlyEven.size() == 10000);
+    assert(onlyEven.range_sum(0, 30000) == evens.range_sum(0, 30000) - common.range_sum(0, 30000));
+    assert((evens - thirds).toString() == onlyEven.toString());
+    onlyEven -= onlyEven;
+    assert(onlyEven.empty());
+
+    AVLTree upper = united.split(15000);
+    assert(united.size() == united.rank(15000) && *united.rbegin() < 15000);
+    assert(*upper.begin() == 15000 && upper.size() + united.size() == expected.size());
+    upper.insert(-1);  // Both halves stay usable after the split
+    upper.remove(-1);
+    united.join(upper);
+    assert(upper.empty());
+    assert(equal(united.begin(), united.end(), expected.begin()));
+
+    AVLTree low{1, 2}, high{3, 4};
+    high.join(low);
+    assert(high.toString() == "1 2 3 4 " && low.empty());
+    AVLTree overlapping{2.5};
+    try {
+        high.join(overlapping);
+        assert(false);
+    } catch (const invalid_argument&) {
+    }
+    assert(overlapping.size() == 1);
+
+    AVLTree small, large;
+    for (int i = 0; i < 40; ++i) {
+        small.insert(i);
+        large.insert(100 + i);
+    }
+    small.remove(5);  // Leaves a free slot behind
+    large.join(small);
+    for (int i = 200; i < 400; ++i) large.insert(i);  // The adopted free and never-used slots go first
+    assert(large.size() == 279 && large.rank(100) == 39 && small.empty());
+    assert(large.select(5) == 6 && large.select(278) == 399);
+    log("Test 24: Join, Split and Set Operations - PASSED");
+}
+
+void testCopyOnWrite() {
+    AVLTree original{1, 2, 3, 4, 5};
+    AVLTree copy(original);
+    AVLTree assigned;
+    assigned = original;
+    assert(copy == original && assigned == original);
+
+    // Each write copies only the tree that is written to
+    copy += 6;
+    assigned -= 1;
+    assert(original.toString() == "1 2 3 4 5 ");
+    assert(copy.toString() == "1 2 3 4 5 6 ");
+    assert(assigned.toString() == "2 3 4 5 ");
+    AVLTree cleared(original);
+    !cleared;
+    --copy;
+    assert(cleared.empty() && original.size() == 5 && copy.size() == 5);
+
+    AVLTree shared(original);
+    shared -= 42;  // Removing a missing value leaves the trees shared
+    shared.set_union(original);
+    assert(shared == original);
+    shared.set_difference(original);
+    assert(shared.empty() && original.size() == 5);
+
+    // Copies handed to workers by value can be changed on their own threads
+    AVLTree base;
+    for (int i = 0; i < 1000; ++i) base += i;
+    vector<thread> workers;
+    vector<size_t> sizes(4);
+    for (int w = 0; w < 4; ++w) {
+        workers.emplace_back([base, w, &sizes]() mutable {
+            for (int i = w; i < 1000; i += 4) base -= i;
+            for (int i = 0; i < 1000; ++i) assert(base[i] == (i % 4 != w));
+            sizes[w] = base.size();
+        });
+    }
+    for (thread& worker : workers) worker.join();
+    assert(base.size() == 1000 && sizes == vector<size_t>(4, 750));
+    log("Test 25: Copy-On-Write Sharing - PASSED");
+}
+
+void testBackgroundReclamation() {
+    AVLTree big;
+    for (int i = 0; i < 20000; ++i) big += i;
+    AVLTree keep(big);
+    big.clear_async();
+    assert(big.empty() && keep.size() == 20000);  // Shared nodes are not queued while a copy holds them
+
+    keep.clear_async();
+    assert(keep.empty());
+    AVLTree::wait_for_reclamation();
+    assert(AVLTree::pending_reclamation_bytes() == 0);
+
+    {
+        AVLTree dropped;
+        dropped.set_reclaim_mode(ReclaimMode::Background);
+        for (int i = 0; i < 20000; ++i) dropped += i;
+        AVLTree copy(dropped);
+        assert(copy.reclaim_mode() == ReclaimMode::Background);
+        copy += -1;
+        copy = AVLTree{1, 2};  // The detached copy's nodes go to the background thread
+        assert(copy.toString() == "1 2 " && copy.reclaim_mode() == ReclaimMode::Background);
+        !dropped;
+        assert(dropped.empty());
+        dropped += 5;
+        assert(dropped.toString() == "5 ");
+    }
+    AVLTree::wait_for_reclamation();
+    assert(AVLTree::pending_reclamation_bytes() == 0);
+
+    AVLTree::set_reclamation_limit(0);
+    AVLTree bounded{1, 2, 3};
+    bounded.clear_async();  // Over the bound, so it is freed right here
+    assert(bounded.empty() && AVLTree::pending_reclamation_bytes() == 0);
+    AVLTree::set_reclamation_limit(static_cast<size_t>(-1));
+    log("Test 26: Background Reclamation - PASSED");
+}
+
+void testStatistics() {
+    AVLTree empty;
+    TreeStats none = empty.stats();
+    assert(none.nodeCount == 0 && none.height == 0 && none.depthHistogram.empty());
+
+    AVLTree::reset_operation_counters();
+    AVLTree tree;
+    for (int i = 1; i <= 7; ++i) tree += i;  // Ascending inserts end in a perfect tree
+    TreeStats shape = tree.stats();
+    assert(shape.nodeCount == 7 && shape.height == 3);
+    assert(shape.depthHistogram == vector<size_t>({1, 2, 4}));
+    assert(shape.memoryBytes >= 7 * sizeof(double));
+
+    tree -= 1;
+    tree -= 2;
+    OperationCounters counters = AVLTree::operation_counters();
+#ifdef AVL_ENABLE_STATS
+    assert(counters.inserts == 7 && counters.erases == 2);
+    assert(counters.allocations == 7 && counters.frees == 2);
+    assert(counters.leftRotations == 4 && counters.rightRotations == 0 && counters.doubleRotations == 0);
+    assert(counters.comparisons > 0 && counters.insertRetraceSteps > 0 && counters.eraseRetraceSteps > 0);
+
+    // Counts from exited threads stay in the totals
+    thread([] {
+        AVLTree local{1, 2, 3};
+        local += 4;
+    }).join();
+    assert(AVLTree::operation_counters().inserts == 8);
+#else
+    assert(counters.inserts == 0 && counters.comparisons == 0);
+#endif
+    AVLTree::reset_operation_counters();
+    assert(AVLTree::operation_counters().inserts == 0);
+    log("Test 27: Tree Statistics - PASSED");
+}
+
+void testCompactStorage() {
+    AVLTree compact(StorageEngine::Compact);
+    assert(compact.storage_engine() == StorageEngine::Compact && compact.empty());
+
+    set<double> reference;
+    mt19937 rng(28);
+    for (int i = 0; i < 4000; ++i) {
+        double value = static_cast<double>(rng() % 1500);
+        if (rng() % 3 == 0) {
+            compact -= value;
+            reference.erase(value);
+        } else if (reference.insert(value).second) {
+            compact += value;
+        }
+    }
+    assert(compact.size() == reference.size());
+    assert(equal(compact.begin(), compact.end(), reference.begin(), reference.end()));
+    assert(*--compact.end() == *reference.rbegin());
+    assert(compact.rank(700) == static_cast<size_t>(distance(reference.begin(), reference.lower_bound(700))));
+    assert(compact.select(10) == *next(reference.begin(), 10));
+    assert(compact.range_count(100, 200) == static_cast<size_t>(distance(reference.lower_bound(100), reference.upper_bound(200))));
+
+    // Same values as a linked tree, in a fraction of the memory
+    AVLTree linked(reference.begin(), reference.end());
+    assert(compact == linked && !(compact < linked) && !(compact > linked));
+    assert(compact.toString() == linked.toString());
+    assert(compact.stats().memoryBytes < linked.stats().memoryBytes);
+
+    // Copies keep the engine and stay independent
+    AVLTree copy(compact);
+    copy += -1;
+    assert(copy.storage_engine() == StorageEngine::Compact && !compact.search(-1));
+    AVLTree upper = copy.split(750);
+    assert(upper.storage_engine() == StorageEngine::Compact);
+    assert(copy.size() + upper.size() == compact.size() + 1);
+    copy.join(upper);
+    assert(copy.size() == compact.size() + 1 && upper.empty());
+    assert((copy - compact).size() == 1 && (compact & linked).size() == compact.size());
+
+    // Bulk loads build a complete tree
+    vector<double> values(1000);
+    iota(values.begin(), values.end(), 0.0);
+    AVLTree loaded(values.begin(), values.end(), DuplicatePolicy::Reject, StorageEngine::Compact);
+    assert(loaded.stats().height == 10 && loaded.median() == 499.5);
+    log("Test 28: Compact Storage Engine - PASSED");
+}
+
+void testBPlusStorage() {
+    AVLTree bplus(StorageEngine::BPlus);
+    assert(bplus.storage_engine() == StorageEngine::BPlus && bplus.empty());
+
+    set<double> reference;
+    mt19937 rng(29);
+    for (int i = 0; i < 6000; ++i) {
+        double value = static_cast<double>(rng() % 2000);
+        if (rng() % 3 == 0) {
+            bplus -= value;
+            reference.erase(value);
+        } else if (reference.insert(value).second) {
+            bplus += value;
+        }
+    }
+    assert(bplus.size() == reference.size());
+    assert(equal(bplus.begin(), bplus.end(), reference.begin(), reference.end()));
+    assert(equal(bplus.rbegin(), bplus.rend(), reference.rbegin(), reference.rend()));
+    assert(bplus.rank(900) == static_cast<size_t>(distance(reference.begin(), reference.lower_bound(900))));
+    assert(bplus.select(10) == *next(reference.begin(), 10));
+    assert(bplus.range_count(100, 200) == static_cast<size_t>(distance(reference.lower_bound(100), reference.upper_bound(200))));
+    assert(bplus.range_sum(100, 200) == accumulate(reference.lower_bound(100), reference.upper_bound(200), 0.0));
+
+    // Same values as a linked tree, in fewer and wider levels
+    AVLTree linked(reference.begin(), reference.end());
+    assert(bplus == linked && bplus.toString() == linked.toString());
+    assert(bplus.stats().height < linked.stats().height);
+
+    // The singular delete removes one value and keeps the tree ordered
+    AVLTree copy(bplus);
+    --copy;
+    assert(copy.size() + 1 == bplus.size() && is_sorted(copy.begin(), copy.end()));
+    assert(copy.storage_engine() == StorageEngine::BPlus && bplus.size() == reference.size());
+    AVLTree upper = copy.split(1000);
+    assert(upper.storage_engine() == StorageEngine::BPlus && copy.size() + upper.size() + 1 == bplus.size());
+
+    // Draining the tree merges its nodes back down to an empty root
+    for (double value : reference) {
+        bplus -= value;
+    }
+    assert(bplus.empty() && bplus.stats().height == 0);
+    log("Test 29: B+ Tree Storage Engine - PASSED");
+}
+
+void testLookupFilter() {
+    AVLTree tree;
+    assert(!tree.lookup_filter() && tree.stats().filterBytes == 0);
+    for (int i = 0; i < 5000; ++i) tree += 2 * i;
+    tree.set_lookup_filter(true);
+    assert(tree.lookup_filter());
+
+    // Stored values always pass; nearly every absent one is answered by the filter alone
+    for (int i = 0; i < 5000; ++i) assert(tree.search(2 * i) && tree[2 * i]);
+    for (int i = 0; i < 5000; ++i) assert(!tree.search(2 * i + 1));
+    TreeStats stats = tree.stats();
+    assert(stats.filterBytes > 0 && stats.filterFalsePositiveRate < 0.01);
+    assert(stats.filterObservedFalsePositiveRate < 0.01);
+
+    // The filter grows with the tree and forgets removed values once it is rebuilt
+    for (int i = 5000; i < 50000; ++i) tree += 2 * i;
+    assert(tree.search(99998) && !tree.search(99999) && tree.stats().filterBytes > stats.filterBytes);
+    for (int i = 0; i < 49000; ++i) tree -= 2 * i;
+    assert(tree.size() == 1000 && !tree.search(0) && tree.search(98000));
+    assert(tree.stats().filterBytes <= stats.filterBytes);
+
+    // Copies, splits and bulk loads keep the filter in step with their own values
+    AVLTree copy(tree);
+    copy += 1;
+    assert(copy.lookup_filter() && copy.search(1) && !tree.search(1));
+    AVLTree upper = copy.split(99000);
+    assert(upper.lookup_filter() && upper.search(99000) && !copy.search(99000) && copy.search(1));
+    copy.join(upper);
+    assert(copy.search(99000) && copy.size() == 1001);
+    copy.assign(vector<double>{-1, -2});
+    assert(copy.search(-1) && !copy.search(1) && copy.size() == 2);
+
+    tree.set_lookup_filter(false);
+    assert(!tree.lookup_filter() && tree.stats().filterBytes == 0 && tree.search(98000));
+    log("Test 30: Lookup Filter - PASSED");
+}
+
+void testHintedInsert() {
+    // Ascending input through the finger: each value hangs off the previous one
+    AVLTree ascending;
+    ascending.set_insert_mode(InsertMode::Finger);
+    AVLTree::reset_operation_counters();
+    for (int i = 0; i < 10000; ++i) ascending += i;
+    assert(ascending.size() == 10000 && ascending.stats().height <= 14);
+    assert(ascending.select(1234) == 1234 && ascending.range_sum(0, 9999) == 49995000.0);
+#ifdef AVL_ENABLE_STATS
+    assert(AVLTree::operation_counters().comparisons <= 2 * 10000);
+#endif
+
+    // Descending input through the returned iterator
+    AVLTree descending;
+    AVLTree::const_iterator hint = descending.end();
+    for (int i = 0; i < 1000; ++i) {
+        hint = descending.insert(hint, -i);
+        assert(*hint == -i);
+    }
+    assert(descending.size() == 1000 && *descending.begin() == -999);
+
+    // A hint far from the value still finds the right place, and duplicates are caught
+    set<double> reference(ascending.begin(), ascending.end());
+    mt19937 rng(31);
+    for (int i = 0; i < 2000; ++i) {
+        double value = static_cast<double>(rng() % 20000) + 0.5;
+        AVLTree::const_iterator near = ascending.lower_bound(static_cast<double>(rng() % 10000));
+        if (reference.insert(value).second) assert(*ascending.insert(near, value) == value);
+    }
+    assert(equal(ascending.begin(), ascending.end(), reference.begin(), reference.end()));
+    bool thrown = false;
+    try {
+        ascending.insert(ascending.begin(), 5000);
+    } catch (const DuplicateValueException&) {
+        thrown = true;
+    }
+    assert(thrown && ascending.size() == reference.size());
+
+    // The finger is dropped when its node is removed, and hints into shared nodes are ignored
+    ascending -= 19999.5;
+    ascending += 30000;
+    AVLTree copy(ascending);
+    assert(*copy.insert(copy.begin(), -1) == -1 && copy.size() == ascending.size() + 1);
+
+    // Other engines accept hints and insert from the root
+    AVLTree compact(StorageEngine::Compact);
+    compact.set_insert_mode(InsertMode::Finger);
+    for (int i = 0; i < 100; ++i) compact += i;
+    assert(*compact.insert(compact.end(), 100) == 100 && compact.size() == 101);
+    log("Test 31: Hinted and Finger Insertion - PASSED");
+}
+
+void testSearchMany() {
+    vector<double> keys;
+    for (int i = 0; i < 3000; ++i) keys.push_back(static_cast<double>(i % 700));  // More keys than fit in one group
+    set<double> stored;
+    mt19937 rng(32);
+    for (int i = 0; i < 300; ++i) stored.insert(static_cast<double>(rng() % 700));
+
+    for (StorageEngine engine : {StorageEngine::Linked, StorageEngine::Compact, StorageEngine::BPlus}) {
+        AVLTree tree(engine);
+        unique_ptr<bool[]> results(new bool[keys.size()]);
+        tree.search_many(keys.data(), keys.size(), results.get());
+        assert(none_of(results.get(), results.get() + keys.size(), [](bool found) { return found; }));
+
+        tree.assign(stored);
+        for (int filtered = 0; filtered < 2; ++filtered) {
+            tree.set_lookup_filter(filtered == 1);
+            fill(results.get(), results.get() + keys.size(), false);
+            tree.search_many(keys.data(), keys.size(), results.get());
+            for (size_t i = 0; i < keys.size(); ++i)
+                assert(results[i] == (stored.count(keys[i]) == 1));
+        }
+        tree.search_many(keys.data(), 0, results.get());
+    }
+    log("Test 32: Batched Search - PASSED");
+}
+
+void testMultiset() {
+    AVLTree tree(StorageEngine::Linked, DuplicatePolicy::Count);
+    assert(tree.duplicate_policy() == DuplicatePolicy::Count);
+    for (double value : {5.0, 3.0, 5.0, 8.0, 5.0, 3.0}) tree.insert(value);
+    assert(tree.size() == 6 && tree.count(5) == 3 && tree.count(3) == 2 && tree.count(4) == 0);
+    assert(tree.toString() == "3 3 5 5 5 8 ");
+    assert(tree.stats().height == 2);  // Three nodes, however many copies
+    assert(vector<double>(tree.rbegin(), tree.rend()) == vector<double>({8, 5, 5, 5, 3, 3}));
+    assert(tree.rank(5) == 2 && tree.rank(8) == 5 && tree.select(4) == 5 && tree.select(5) == 8);
+    assert(tree.median() == 5 && tree.range_count(3, 5) == 5 && tree.range_sum(4, 9) == 23);
+    assert(distance(tree.lower_bound(5), tree.upper_bound(5)) == 3);
+
+    tree.remove(5);
+    assert(tree.count(5) == 2 && tree.search(5) && tree.size() == 5);
+    tree.remove(5);
+    tree.remove(5);
+    assert(!tree.search(5) && tree.toString() == "3 3 8 ");
+
+    // The copy and the bulk-loaded tree hold the same copies in different shapes
+    AVLTree copy = tree;
+    copy += 3;
+    assert(tree.count(3) == 2 && copy.count(3) == 3 && copy != tree);
+    vector<double> repeated = {3, 8, 3, 3};
+    AVLTree loaded(repeated.begin(), repeated.end(), DuplicatePolicy::Count);
+    assert(loaded.duplicate_policy() == DuplicatePolicy::Count && loaded == copy);
+
+    try {
+        AVLTree(StorageEngine::Compact, DuplicatePolicy::Count);
+        assert(false);
+    } catch (const invalid_argument&) {
+    }
+    AVLTree set;
+    try {
+        set.assign(vector<double>{1, 1}, DuplicatePolicy::Count);
+        assert(false);
+    } catch (const invalid_argument&) {
+    }
+    AVLTree ignoring(StorageEngine::Linked, DuplicatePolicy::Ignore);
+    ignoring += 1;
+    ignoring += 1;
+    assert(ignoring.size() == 1);
+
+    // Random inserts and removals against std::multiset, with few distinct values
+    multiset<double> expected;
+    AVLTree counted(StorageEngine::Linked, DuplicatePolicy::Count);
+    mt19937 rng(33);
+    for (int i = 0; i < 20000; ++i) {
+        double value = static_cast<double>(rng() % 50);
+        if (rng() % 3 == 0) {
+            auto found = expected.find(value);
+            if (found != expected.end()) expected.erase(found);
+            counted.remove(value);
+        } else {
+            expected.insert(value);
+            counted.insert(value);
+        }
+    }
+    assert(counted.size() == expected.size() && equal(counted.begin(), counted.end(), expected.begin()));
+    assert(counted.range_sum(10, 20) == accumulate(expected.lower_bound(10), expected.upper_bound(20), 0.0));
+    for (size_t k = 0; k < expected.size(); k += 97)
+        assert(counted.select(k) == *next(expected.begin(), static_cast<ptrdiff_t>(k)));
+
+    // Multiset union keeps the larger count, and a set tree keeps one copy
+    AVLTree pair(StorageEngine::Linked, DuplicatePolicy::Count);
+    pair.assign(vector<double>{3, 3, 9});
+    assert((copy + pair).toString() == "3 3 3 8 9 " && (copy & pair).toString() == "3 3 ");
+    AVLTree distinct{3, 4};
+    distinct += pair;
+    assert(distinct.toString() == "3 4 9 ");
+
+    AVLTree split = counted.split(25);
+    assert(split.duplicate_policy() == DuplicatePolicy::Count && counted.size() + split.size() == expected.size());
+    counted.join(split);
+    assert(counted == AVLTree(expected.begin(), expected.end(), DuplicatePolicy::Count));
+    try {
+        counted.save("multiset_test.bin");
+        assert(false);
+    } catch (const SnapshotException&) {
+    }
+    log("Test 33: Counted Duplicates - PASSED");
+}
+
+void testContentEquality() {
+    // Trees reach the same contents by different routes; each must still compare equal to a fresh build
+    for (StorageEngine engine : {StorageEngine::Linked, StorageEngine::Compact, StorageEngine::BPlus}) {
+        set<double> expected;
+        AVLTree tree(engine);
+        mt19937 rng(34);
+        for (int i = 0; i < 5000; ++i) {
+            double value = static_cast<double>(rng() % 2000);
+            if (rng() % 4 == 0) {
+                expected.erase(value);
+                tree.remove(value);
+            } else if (expected.insert(value).second) {
+                tree.insert(value);
+            }
+        }
+        AVLTree rebuilt(expected.begin(), expected.end());
+        assert(tree == rebuilt && rebuilt == tree);
+
+        --tree;
+        assert(tree != rebuilt && tree.size() + 1 == rebuilt.size());
+
+        AVLTree upper = rebuilt.split(1000);
+        assert(rebuilt == AVLTree(expected.begin(), expected.lower_bound(1000)));
+        assert(upper == AVLTree(expected.lower_bound(1000), expected.end(), DuplicatePolicy::Reject, engine));
+        rebuilt.join(upper);
+        assert(rebuilt == AVLTree(expected.begin(), expected.end()) && upper == AVLTree());
+
+        AVLTree evens(engine), odds(engine);
+        for (int i = 0; i < 40000; ++i) (i % 2 ? odds : evens) += i;  // Large enough to merge on several threads
+        AVLTree all(engine);
+        for (int i = 39999; i >= 0; --i) all += i;
+        assert(evens + odds == all && all - odds == evens && (all & evens) == evens);
+        assert(evens + odds != all - AVLTree{0});
+    }
+
+    // Zeroes of either sign compare equal, so they must hash alike
+    AVLTree positive{0.0, 1.0}, negative{-0.0, 1.0};
+    assert(positive == negative);
+    log("Test 34: Content Equality - PASSED");
+}
+
+void testDurableTree() {
+    const string directory = "durable_test_dir";
+    filesystem::remove_all(directory);
+    AVLTree expected;
+    {
+        DurableAVLTree tree(directory);
+        for (int i = 0; i < 200; ++i) tree += i * 0.5;
+        for (int i = 0; i < 200; i += 3) assert(tree.remove(i * 0.5));
+        assert(!tree.remove(-1));  // Not stored, so not journaled
+        try {
+            tree.insert(1);
+            assert(false);
+        } catch (const DuplicateValueException&) {
+        }
+        assert(tree.sequence() == 200 + 67);
+        expected = tree.tree();
+    }
+    {
+        DurableAVLTree reopened(directory);
+        assert(reopened.tree() == expected && reopened.sequence() == 267);
+        !reopened;
+        reopened += 7;
+    }
+    {
+        DurableAVLTree reopened(directory);
+        assert(reopened.size() == 1 && reopened[7] && reopened.sequence() == 269);
+    }
+    filesystem::remove_all(directory);
+
+    // Checkpoints cover the journal, so only the segment after the newest one is left
+    DurabilityOptions options;
+    options.sync = SyncMode::Interval;
+    options.syncInterval = chrono::milliseconds(1);
+    options.checkpointEvery = 1000;
+    set<double> reference;
+    {
+        DurableAVLTree tree(directory, options);
+        mt19937 rng(35);
+        for (int i = 0; i < 5500; ++i) {
+            double key = rng() % 2000;
+            if (reference.insert(key).second) {
+                tree += key;
+            } else {
+                reference.erase(key);
+                tree -= key;
+            }
+        }
+        tree.wait_for_checkpoint();
+        tree.flush();
+    }
+    auto countFiles = [&](const string& prefix) {
+        return count_if(filesystem::directory_iterator(directory), filesystem::directory_iterator(),
+                        [&](const filesystem::directory_entry& entry) {
+                            return entry.path().filename().string().rfind(prefix, 0) == 0;
+                        });
+    };
+    assert(countFiles("checkpoint-") == 1 && countFiles("journal-") <= 2);
+    for (StorageEngine engine : {StorageEngine::Linked, StorageEngine::Compact, StorageEngine::BPlus}) {
+        options.engine = engine;
+        DurableAVLTree reopened(directory, options);
+        AVLTree contents = reopened.tree();
+        assert(reopened.sequence() == 5500 && contents.storage_engine() == engine);
+        assert(equal(contents.begin(), contents.end(), reference.begin(), reference.end()));
+    }
+    options.engine = StorageEngine::Linked;
+
+    // A checkpoint after reopening builds on the last one and the records replayed since
+    {
+        DurableAVLTree reopened(directory, options);
+        reopened.checkpoint();
+        reopened.wait_for_checkpoint();
+    }
+    AVLTree checkpointed = AVLTree::load((filesystem::path(directory) / "checkpoint-5500").string());
+    assert(countFiles("checkpoint-") == 1);
+    assert(equal(checkpointed.begin(), checkpointed.end(), reference.begin(), reference.end()));
+
+    // A torn last record is cut off; the records before it survive
+    {
+        DurableAVLTree tree(directory, options);
+        tree += 5000;
+        tree.flush();
+    }
+    string newest;
+    uint64_t newestFirst = 0;
+    for (const filesystem::directory_entry& entry : filesystem::directory_iterator(directory)) {
+        string name = entry.path().filename().string();
+        if (name.rfind("journal-", 0) == 0 && stoull(name.substr(8)) >= newestFirst) {
+            newestFirst = stoull(name.substr(8));
+            newest = entry.path().string();
+        }
+    }
+    {
+        ofstream torn(newest, ios::binary | ios::app);
+        torn.write("\x01\x02\x03\x04\x05\x06\x07", 7);
+    }
+    {
+        DurableAVLTree reopened(directory, options);
+        assert(reopened.sequence() == 5501 && reopened[5000] && reopened.size() == reference.size() + 1);
+        reopened -= 5000;
+    }
+    {
+        DurableAVLTree reopened(directory, options);
+        assert(reopened.sequence() == 5502 && !reopened[5000]);
+    }
+    filesystem::remove_all(directory);
+
+    // Writers that overlap share batches; every acknowledged insert is recovered
+    {
+        DurableAVLTree tree(directory);
+        vector<thread> writers;
+        for (int w = 0; w < 4; ++w) {
+            writers.emplace_back([&, w] {
+                for (int i = 0; i < 50; ++i) tree += w * 1000 + i;
+            });
+        }
+        for (thread& writer : writers) writer.join();
+        assert(tree.size() == 200);
+    }
+    {
+        DurableAVLTree reopened(directory);
+        assert(reopened.size() == 200 && reopened.sequence() == 200 && reopened[3049] && !reopened[3050]);
+    }
+    filesystem::remove_all(directory);
+    log("Test 35: Durable Tree - PASSED");
+}
+
+void testAllocationFailures() {
+    // The first write after a copy clones the nodes; a failed clone leaves both trees as they were
+    AVLTree original;
+    for (int i = 0; i < 300; ++i) original += (i * 7) % 300;
+    const string contents = original.toString();
+    failEachAllocation([&] {
+        AVLTree copy(original);
+        copy += 1000;
+        assert(copy.size() == 301 && copy.rank(1000) == 300);
+    }, [&] {
+        assert(original.toString() == contents);
+    });
+    AVLTree shared(original);
+    failEachAllocation([&] {
+        shared -= 7;
+    }, [&] {
+        assert(shared == original && shared.toString() == contents);
+    });
+    assert(!shared[7] && shared.size() == 299 && original[7]);
+    failEachAllocation([&] {
+        PersistentAVLTree persistent(original);
+        assert(persistent.size() == 300 && persistent.search(299));
+    }, [] {});
+
+    // A failed insert leaves the content hash alone, so equal trees stay equal
+    AVLTree left, right;
+    for (int i = 0; i < 32; ++i) {
+        left += i;
+        right += i;
+    }
+    failEachAllocation([&] {
+        left += 32;
+    }, [&] {
+        assert(left.size() == 32 && !left[32] && left == right);
+    });
+    assert(left != right && left.size() == 33);
+
+    // A bulk load builds the new nodes before it frees the old ones
+    BasicAVLTree<int64_t> integers{5, 3, 8};
+    vector<int64_t> loaded(200);
+    iota(loaded.begin(), loaded.end(), 100);
+    failEachAllocation([&] {
+        integers.assign(loaded.begin(), loaded.end());
+    }, [&] {
+        assert(integers.size() == 3 && *integers.begin() == 3 && *integers.rbegin() == 8 && integers.height() == 2);
+    });
+    assert(equal(integers.begin(), integers.end(), loaded.begin(), loaded.end()));
+    vector<double> reloaded(loaded.begin(), loaded.end());
+    for (StorageEngine engine : {StorageEngine::Linked, StorageEngine::Compact, StorageEngine::BPlus}) {
+        AVLTree tree(engine);
+        tree += 5;
+        tree += 3;
+        tree += 8;
+        failEachAllocation([&] {
+            tree.assign(reloaded.begin(), reloaded.end());
+        }, [&] {
+            assert(tree.toString() == "3 5 8 ");
+        });
+        assert(tree.size() == 200 && *tree.begin() == 100);
+    }
+    log("Test 36: Allocation Failures - PASSED");
+}
+
 void runTests() {
     testConstructor();
     testInsertAndPlusEquals();
@@ -151,6 +1412,31 @@ void runTests() {
     testComparisonOperators();
     testMoveConstructorAndAssignment();
     testDuplicateValue();
+    testNodeReuseAfterChurn();
+    testBulkLoad();
+    testRandomOperationsMatchSet();
+    testOrderStatistics();
+    testIteratorsAndBounds();
+    testRangeAggregates();
+    testSnapshotSaveAndLoad();
+    testFormattedOutput();
+    testBasicTreeKeyTypes();
+    testFrozenTree();
+    testPersistentTree();
+    testConcurrentTree();
+    testSetOperations();
+    testCopyOnWrite();
+    testBackgroundReclamation();
+    testStatistics();
+    testCompactStorage();
+    testBPlusStorage();
+    testLookupFilter();
+    testHintedInsert();
+    testSearchMany();
+    testMultiset();
+    testContentEquality();
+    testDurableTree();
+    testAllocationFailures();
     log("All tests completed successfully.");
 }
 